@@ -0,0 +1,341 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "AlarmRules.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <limits>
+
+enum class AlarmKind { Below, Above, Drops, Rises };
+
+struct AlarmRule
+{
+  std::string Name;
+  std::string Signal;
+  AlarmKind   Kind;
+  double      Value;// Threshold, or the fraction of change for trends
+  double      Window_s = 0;
+  double      Hold_s = 0;
+};
+
+// Running max (or min) over the last Window_s of a signal
+struct TrendWindow
+{
+  size_t                            Signal;
+  double                            Window_s;
+  bool                              Max;
+  std::deque<std::pair<double,double>> Samples;// (time, value), values are monotonic from the front
+
+  void Push(double time_s, double v)
+  {
+    if (std::isnan(v))
+      return;
+    if (Max)
+      while (!Samples.empty() && Samples.back().second <= v) Samples.pop_back();
+    else
+      while (!Samples.empty() && Samples.back().second >= v) Samples.pop_back();
+    Samples.push_back(std::make_pair(time_s, v));
+    while (Samples.front().first < time_s - Window_s)
+      Samples.pop_front();
+  }
+};
+
+static const double NotSince = std::numeric_limits<double>::infinity();
+
+static std::string Trim(const std::string& s)
+{
+  size_t b = s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos)
+    return "";
+  size_t e = s.find_last_not_of(" \t\r\n");
+  return s.substr(b, e - b + 1);
+}
+
+// A number with an optional unit suffix (s or %)
+static bool ParseNumber(const std::string& text, const char* suffix, double& v)
+{
+  std::string s = Trim(text);
+  size_t n = std::strlen(suffix);
+  if (n > 0 && s.size() > n && s.compare(s.size() - n, n, suffix) == 0)
+    s = Trim(s.substr(0, s.size() - n));
+  if (s.empty())
+    return false;
+  char* end;
+  v = std::strtod(s.c_str(), &end);
+  return *end == '\0' && std::isfinite(v);
+}
+
+class AlarmRules::Data
+{
+public:
+  std::vector<AlarmRule>     Rules;
+
+  // Compiled, one entry per rule being evaluated
+  // A rule is active when (value - reference) * Sign > 0 has held for Hold_s,
+  // with reference = base + Sign * Fraction * |base|, where base is the threshold or the window extreme
+  std::vector<size_t>        Rule;
+  std::vector<size_t>        Signal;
+  std::vector<int>           Window;// -1 for thresholds
+  std::vector<double>        Threshold;
+  std::vector<double>        Fraction;
+  std::vector<double>        Sign;
+  std::vector<double>        Hold_s;
+  std::vector<double>        Base;
+  std::vector<unsigned char> Condition;
+  std::vector<double>        Since_s;
+  std::vector<unsigned char> Active;
+  std::vector<TrendWindow>   Windows;
+  std::vector<double>        Extremes;
+
+  std::vector<unsigned char> RuleActive;
+  size_t                     NumActive = 0;
+  std::vector<AlarmEvent>    Events;
+};
+
+AlarmRules::AlarmRules()
+{
+  m_Data = new AlarmRules::Data();
+}
+
+AlarmRules::~AlarmRules()
+{
+  delete m_Data;
+}
+
+bool AlarmRules::AddRule(const std::string& definition, std::string* error)
+{
+  AlarmRule r;
+  size_t colon = definition.find(':');
+  if (colon == std::string::npos)
+  {
+    if (error) *error = "Expected <name> : <condition> in '" + definition + "'";
+    return false;
+  }
+  r.Name = Trim(definition.substr(0, colon));
+  std::string condition = Trim(definition.substr(colon + 1));
+
+  size_t hold = condition.rfind(" for ");
+  if (hold != std::string::npos)
+  {
+    if (!ParseNumber(condition.substr(hold + 5), "s", r.Hold_s) || r.Hold_s < 0)
+    {
+      if (error) *error = "Bad hold time in '" + definition + "'";
+      return false;
+    }
+    condition = Trim(condition.substr(0, hold));
+  }
+
+  size_t op;
+  if ((op = condition.find(" drops ")) != std::string::npos || (op = condition.find(" rises ")) != std::string::npos)
+  {
+    r.Kind = condition.compare(op, 7, " drops ") == 0 ? AlarmKind::Drops : AlarmKind::Rises;
+    std::string change = condition.substr(op + 7);
+    size_t in = change.find(" in ");
+    if (in == std::string::npos || !ParseNumber(change.substr(0, in), "%", r.Value) ||
+        !ParseNumber(change.substr(in + 4), "s", r.Window_s) || r.Window_s <= 0)
+    {
+      if (error) *error = "Expected <percent>% in <seconds>s in '" + definition + "'";
+      return false;
+    }
+    r.Value /= 100;
+  }
+  else
+  {
+    size_t below = condition.rfind(" < ");
+    size_t above = condition.rfind(" > ");
+    if (below == std::string::npos && above == std::string::npos)
+    {
+      if (error) *error = "Expected <, >, drops or rises in '" + definition + "'";
+      return false;
+    }
+    op = below == std::string::npos ? above : (above == std::string::npos ? below : std::max(below, above));
+    r.Kind = op == below ? AlarmKind::Below : AlarmKind::Above;
+    if (!ParseNumber(condition.substr(op + 3), "", r.Value))
+    {
+      if (error) *error = "Bad threshold in '" + definition + "'";
+      return false;
+    }
+  }
+  r.Signal = Trim(condition.substr(0, op));
+  if (r.Name.empty() || r.Signal.empty())
+  {
+    if (error) *error = "Missing name or signal in '" + definition + "'";
+    return false;
+  }
+  m_Data->Rules.push_back(r);
+  return true;
+}
+
+size_t AlarmRules::LoadFile(const std::string& filename, std::vector<std::string>* errors)
+{
+  std::ifstream in(filename);
+  size_t added = 0;
+  std::string line;
+  std::string error;
+  while (std::getline(in, line))
+  {
+    size_t comment = line.find('#');
+    if (comment != std::string::npos)
+      line = line.substr(0, comment);
+    if (Trim(line).empty())
+      continue;
+    if (AddRule(line, &error))
+      added++;
+    else if (errors != nullptr)
+      errors->push_back(error);
+  }
+  return added;
+}
+
+void AlarmRules::LoadDefaults()
+{
+  AddRule("Low SpO2 : OxygenSaturation < 0.9 for 10s");
+  AddRule("Tachycardia : HeartRate(1/min) > 120 for 5s");
+  AddRule("Bradycardia : HeartRate(1/min) < 50 for 5s");
+  AddRule("Hypotension : MeanArterialPressure(mmHg) < 65 for 10s");
+  AddRule("MAP falling : MeanArterialPressure(mmHg) drops 20% in 120s");
+  AddRule("Hypertension : SystolicArterialPressure(mmHg) > 180 for 10s");
+  AddRule("Tachypnea : RespirationRate(1/min) > 30 for 10s");
+  AddRule("Bradypnea : RespirationRate(1/min) < 8 for 10s");
+  AddRule("Hypercapnia : EndTidalCarbonDioxidePressure(mmHg) > 50 for 10s");
+  AddRule("Fever : CoreTemperature(degC) > 38.5");
+  AddRule("Hypothermia : CoreTemperature(degC) < 35");
+}
+
+void AlarmRules::Clear()
+{
+  m_Data->Rules.clear();
+  Compile(std::vector<std::string>());
+}
+
+size_t AlarmRules::GetNumberOfRules() const
+{
+  return m_Data->Rules.size();
+}
+
+const std::string& AlarmRules::GetRuleName(size_t rule) const
+{
+  return m_Data->Rules[rule].Name;
+}
+
+const std::string& AlarmRules::GetRuleSignal(size_t rule) const
+{
+  return m_Data->Rules[rule].Signal;
+}
+
+size_t AlarmRules::Compile(const std::vector<std::string>& signals)
+{
+  Data& d = *m_Data;
+  d.Rule.clear();
+  d.Signal.clear();
+  d.Window.clear();
+  d.Threshold.clear();
+  d.Fraction.clear();
+  d.Sign.clear();
+  d.Hold_s.clear();
+  d.Windows.clear();
+  for (size_t r = 0; r < d.Rules.size(); r++)
+  {
+    const AlarmRule& rule = d.Rules[r];
+    size_t s = 0;
+    while (s < signals.size() && signals[s] != rule.Signal)
+      s++;
+    if (s == signals.size())
+      continue;
+
+    int window = -1;
+    if (rule.Kind == AlarmKind::Drops || rule.Kind == AlarmKind::Rises)
+    {// Share windows between rules watching the same thing
+      bool max = rule.Kind == AlarmKind::Drops;
+      for (size_t w = 0; w < d.Windows.size() && window < 0; w++)
+        if (d.Windows[w].Signal == s && d.Windows[w].Window_s == rule.Window_s && d.Windows[w].Max == max)
+          window = int(w);
+      if (window < 0)
+      {
+        TrendWindow tw;
+        tw.Signal = s;
+        tw.Window_s = rule.Window_s;
+        tw.Max = max;
+        d.Windows.push_back(tw);
+        window = int(d.Windows.size() - 1);
+      }
+    }
+    d.Rule.push_back(r);
+    d.Signal.push_back(s);
+    d.Window.push_back(window);
+    d.Threshold.push_back(window < 0 ? rule.Value : 0);
+    d.Fraction.push_back(window < 0 ? 0 : rule.Value);
+    d.Sign.push_back(rule.Kind == AlarmKind::Below || rule.Kind == AlarmKind::Drops ? -1 : 1);
+    d.Hold_s.push_back(rule.Hold_s);
+  }
+  d.Extremes.resize(d.Windows.size());
+  d.Base.resize(d.Rule.size());
+  d.Condition.resize(d.Rule.size());
+  Reset();
+  return d.Rule.size();
+}
+
+void AlarmRules::Reset()
+{
+  Data& d = *m_Data;
+  d.Since_s.assign(d.Rule.size(), NotSince);
+  d.Active.assign(d.Rule.size(), 0);
+  d.RuleActive.assign(d.Rules.size(), 0);
+  d.NumActive = 0;
+  d.Events.clear();
+  for (TrendWindow& w : d.Windows)
+    w.Samples.clear();
+  for (double& e : d.Extremes)
+    e = std::numeric_limits<double>::quiet_NaN();
+}
+
+void AlarmRules::Evaluate(double time_s, const double* values)
+{
+  Data& d = *m_Data;
+  size_t n = d.Rule.size();
+  for (size_t w = 0; w < d.Windows.size(); w++)
+  {
+    d.Windows[w].Push(time_s, values[d.Windows[w].Signal]);
+    d.Extremes[w] = d.Windows[w].Samples.empty() ? std::numeric_limits<double>::quiet_NaN() : d.Windows[w].Samples.front().second;
+  }
+  for (size_t i = 0; i < n; i++)
+    d.Base[i] = d.Window[i] < 0 ? d.Threshold[i] : d.Extremes[d.Window[i]];
+  // NaN never compares greater, so missing values never raise anything
+  for (size_t i = 0; i < n; i++)
+    d.Condition[i] = (values[d.Signal[i]] - (d.Base[i] + d.Sign[i] * d.Fraction[i] * std::fabs(d.Base[i]))) * d.Sign[i] > 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    d.Since_s[i] = d.Condition[i] ? std::min(d.Since_s[i], time_s) : NotSince;
+    unsigned char on = time_s - d.Since_s[i] >= d.Hold_s[i];
+    if (on == d.Active[i])
+      continue;
+    d.Active[i] = on;
+    d.RuleActive[d.Rule[i]] = on;
+    d.NumActive += on ? 1 : -1;
+    AlarmEvent e;
+    e.Rule = d.Rule[i];
+    e.Time_s = time_s;
+    e.Raised = on != 0;
+    d.Events.push_back(e);
+  }
+}
+
+bool AlarmRules::IsActive(size_t rule) const
+{
+  return rule < m_Data->RuleActive.size() && m_Data->RuleActive[rule] != 0;
+}
+
+size_t AlarmRules::GetNumberOfActiveAlarms() const
+{
+  return m_Data->NumActive;
+}
+
+void AlarmRules::PopEvents(std::vector<AlarmEvent>& events)
+{
+  events.insert(events.end(), m_Data->Events.begin(), m_Data->Events.end());
+  m_Data->Events.clear();
+}
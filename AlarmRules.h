@@ -0,0 +1,57 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct AlarmEvent
+{
+  size_t Rule;
+  double Time_s;
+  bool   Raised;// false when the alarm clears
+};
+
+// Threshold, trend and duration alarms over named signals.
+// Rules are written one per line, with an optional hold time the condition must last for :
+//   <name> : <signal> < <value> [for <seconds>s]
+//   <name> : <signal> > <value> [for <seconds>s]
+//   <name> : <signal> drops <percent>% in <seconds>s [for <seconds>s]  (from the highest value in the window)
+//   <name> : <signal> rises <percent>% in <seconds>s [for <seconds>s]  (from the lowest value in the window)
+// Compile binds the rules to a signal list and flattens them into arrays that Evaluate sweeps once per sample.
+// Trend windows are kept as monotonic queues, shared by all rules on the same signal and window.
+class AlarmRules
+{
+public:
+  AlarmRules();
+  virtual ~AlarmRules();
+
+  // Parse a rule, returns false (and why in error) if it is not understood
+  bool AddRule(const std::string& definition, std::string* error=nullptr);
+  // Add every rule in a file, # starts a comment, returns the number of rules added
+  size_t LoadFile(const std::string& filename, std::vector<std::string>* errors=nullptr);
+  void LoadDefaults();
+  void Clear();
+
+  size_t GetNumberOfRules() const;
+  const std::string& GetRuleName(size_t rule) const;
+  const std::string& GetRuleSignal(size_t rule) const;
+
+  // Bind rules to the values that will be given to Evaluate, rules on signals not in the list are skipped
+  // Returns the number of rules that will be evaluated
+  size_t Compile(const std::vector<std::string>& signals);
+  // Drop all window state and active alarms, keeps the compiled rules
+  void Reset();
+
+  // values holds a value for each compiled signal
+  void Evaluate(double time_s, const double* values);
+
+  bool IsActive(size_t rule) const;
+  size_t GetNumberOfActiveAlarms() const;
+  // Raised and cleared alarms since the last call
+  void PopEvents(std::vector<AlarmEvent>& events);
+
+private:
+  class Data;
+  Data* m_Data;
+};
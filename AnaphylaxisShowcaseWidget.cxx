@@ -58,13 +58,13 @@ void AnaphylaxisShowcaseWidget::ConfigurePulse(PhysiologyEngine& pulse, SEDataRe
 
   if (!pulse.LoadStateFile("./states/StandardMale@0s.pba"))
     throw CommonDataModelException("Unable to load state file");
-  m_Controls->Pulse.GetLogBox().append("Anaphylaxis is a serious, potentially life threatening allergic reaction with facial and airway swelling.");
-  m_Controls->Pulse.GetLogBox().append("It is an immune response that can occur quickly in response to exposure to an allergen.");
-  m_Controls->Pulse.GetLogBox().append("The immune system releases chemicals into the body that cause the blood pressure to drop and the airways to narrow, blocking breathing.");
-  m_Controls->Pulse.GetLogBox().append("Anaphylaxis is treated with an injection of epinephrine.");
-  m_Controls->Pulse.GetLogBox().append("The anaphylaxis is rapidly reversed by the drug, allowing patient vital signs to return to normal.");
-  m_Controls->Pulse.GetLogBox().append("");
-  m_Controls->Pulse.GetLogBox().append("To introduce the anaphylaxis state, select a severity and click the 'Apply' Button.");
+  m_Controls->Pulse.GetLogBox().Append("Anaphylaxis is a serious, potentially life threatening allergic reaction with facial and airway swelling.");
+  m_Controls->Pulse.GetLogBox().Append("It is an immune response that can occur quickly in response to exposure to an allergen.");
+  m_Controls->Pulse.GetLogBox().Append("The immune system releases chemicals into the body that cause the blood pressure to drop and the airways to narrow, blocking breathing.");
+  m_Controls->Pulse.GetLogBox().Append("Anaphylaxis is treated with an injection of epinephrine.");
+  m_Controls->Pulse.GetLogBox().Append("The anaphylaxis is rapidly reversed by the drug, allowing patient vital signs to return to normal.");
+  m_Controls->Pulse.GetLogBox().Append("");
+  m_Controls->Pulse.GetLogBox().Append("To introduce the anaphylaxis state, select a severity and click the 'Apply' Button.");
   m_Controls->Pulse.ScrollLogBox();
 
   m_Controls->Epinephrine = pulse.GetSubstanceManager().GetSubstance("Epinephrine");
@@ -122,6 +122,13 @@ void AnaphylaxisShowcaseWidget::ProcessPhysiology(PhysiologyEngine& pulse)
   m_Controls->Mutex.unlock();
 }
 
+void AnaphylaxisShowcaseWidget::PulseStateLoaded(PhysiologyEngine& pulse)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Epinephrine = pulse.GetSubstanceManager().GetSubstance("Epinephrine");
+  m_Controls->Mutex.unlock();
+}
+
 void AnaphylaxisShowcaseWidget::ApplyAirwayObstruction()
 {
   m_Controls->Mutex.lock();
@@ -129,7 +136,7 @@ void AnaphylaxisShowcaseWidget::ApplyAirwayObstruction()
   m_Controls->SeveritySlider->setEnabled(false);
   m_Controls->ObsButton->setEnabled(false);
   m_Controls->EpiButton->setEnabled(true);
-  m_Controls->Pulse.GetLogBox().append("Applying anaphylaxis");
+  m_Controls->Pulse.GetLogBox().Append("Applying anaphylaxis");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -139,7 +146,7 @@ void AnaphylaxisShowcaseWidget::InjectEpinephrine()
   m_Controls->Mutex.lock();
   m_Controls->InjectEpinephrine = true;
   m_Controls->EpiButton->setEnabled(false);
-  m_Controls->Pulse.GetLogBox().append("Injecting a bolus of epinephrine");
+  m_Controls->Pulse.GetLogBox().Append("Injecting a bolus of epinephrine");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
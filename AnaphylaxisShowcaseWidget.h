@@ -19,6 +19,8 @@ public:
 
   void ConfigurePulse(PhysiologyEngine& pulse, SEDataRequestManager& drMgr);
   void ProcessPhysiology(PhysiologyEngine& pulse);
+  void PulseStateLoaded(PhysiologyEngine& pulse);
+  bool IsPulseDriver() const { return true; }
 
 signals:
 protected slots:
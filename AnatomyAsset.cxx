@@ -0,0 +1,350 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "AnatomyAsset.h"
+
+#include <QFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+static const char   Magic[8] = { 'P','X','A','N','A','T','0','1' };
+static const size_t HeaderSize = 8 + 2 * sizeof(uint32_t) + 6 * sizeof(float);
+
+// Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation"
+static const int    CacheSize = 32;
+static const float  CacheDecayPower = 1.5f;
+static const float  LastTriangleScore = 0.75f;
+static const float  ValenceBoostScale = 2.0f;
+static const float  ValenceBoostPower = 0.5f;
+
+static float VertexScore(int cache_position, uint32_t remaining)
+{
+  if (remaining == 0)
+    return -1;// Nothing left to draw with it
+  float score = 0;
+  if (cache_position >= 0)
+  {
+    if (cache_position < 3)
+      score = LastTriangleScore;// Just used, so the next triangle should not lean on it too much
+    else
+      score = std::pow(1.0f - float(cache_position - 3) / (CacheSize - 3), CacheDecayPower);
+  }
+  // Favor finishing off vertices with few triangles left, so they leave the cache for good
+  return score + ValenceBoostScale * std::pow(float(remaining), -ValenceBoostPower);
+}
+
+static size_t Padded(size_t bytes)
+{
+  return (bytes + 3) & ~size_t(3);
+}
+
+static void EncodeNormal(const float* n, int16_t* q)
+{
+  float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+  float x = l1 > 0 ? n[0] / l1 : 0;
+  float y = l1 > 0 ? n[1] / l1 : 0;
+  if (l1 > 0 && n[2] < 0)
+  {// Fold the lower half of the octahedron over the upper
+    float fx = (1 - std::fabs(y)) * (x < 0 ? -1 : 1);
+    float fy = (1 - std::fabs(x)) * (y < 0 ? -1 : 1);
+    x = fx;
+    y = fy;
+  }
+  q[0] = int16_t(std::lround(std::max(-1.0f, std::min(1.0f, x)) * 32767));
+  q[1] = int16_t(std::lround(std::max(-1.0f, std::min(1.0f, y)) * 32767));
+}
+
+class AnatomyAsset::Data
+{
+public:
+  QFile           File;
+  const uint8_t*  Map = nullptr;
+  uint32_t        NumPoints = 0;
+  uint32_t        NumTriangles = 0;
+  float           Min[3];
+  float           Scale[3];
+  const uint16_t* Positions = nullptr;
+  const int16_t*  Normals = nullptr;
+  const uint32_t* Triangles = nullptr;
+};
+
+AnatomyAsset::AnatomyAsset()
+{
+  m_Data = new AnatomyAsset::Data();
+}
+
+AnatomyAsset::~AnatomyAsset()
+{
+  Close();
+  delete m_Data;
+}
+
+bool AnatomyAsset::Open(const std::string& filename)
+{
+  Close();
+  m_Data->File.setFileName(QString::fromStdString(filename));
+  if (!m_Data->File.open(QIODevice::ReadOnly) || size_t(m_Data->File.size()) < HeaderSize)
+  {
+    Close();
+    return false;
+  }
+  m_Data->Map = m_Data->File.map(0, m_Data->File.size());
+  if (m_Data->Map == nullptr || std::memcmp(m_Data->Map, Magic, 8) != 0)
+  {
+    Close();
+    return false;
+  }
+  const uint8_t* c = m_Data->Map + 8;
+  std::memcpy(&m_Data->NumPoints, c, sizeof(uint32_t));
+  std::memcpy(&m_Data->NumTriangles, c + 4, sizeof(uint32_t));
+  std::memcpy(m_Data->Min, c + 8, 3 * sizeof(float));
+  std::memcpy(m_Data->Scale, c + 20, 3 * sizeof(float));
+  size_t positions = HeaderSize;
+  size_t normals = positions + Padded(6 * size_t(m_Data->NumPoints));
+  size_t triangles = normals + 4 * size_t(m_Data->NumPoints);
+  size_t end = triangles + 12 * size_t(m_Data->NumTriangles);
+  if (size_t(m_Data->File.size()) < end)
+  {
+    Close();
+    return false;
+  }
+  // Every section starts 4 byte aligned, and the map is page aligned
+  m_Data->Positions = reinterpret_cast<const uint16_t*>(m_Data->Map + positions);
+  m_Data->Normals = reinterpret_cast<const int16_t*>(m_Data->Map + normals);
+  m_Data->Triangles = reinterpret_cast<const uint32_t*>(m_Data->Map + triangles);
+  // Do not trust the ids to be in range
+  for (size_t i = 0; i < 3 * size_t(m_Data->NumTriangles); i++)
+  {
+    if (m_Data->Triangles[i] >= m_Data->NumPoints)
+    {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void AnatomyAsset::Close()
+{
+  m_Data->File.close();// Also unmaps
+  m_Data->Map = nullptr;
+  m_Data->NumPoints = 0;
+  m_Data->NumTriangles = 0;
+  m_Data->Positions = nullptr;
+  m_Data->Normals = nullptr;
+  m_Data->Triangles = nullptr;
+}
+
+size_t AnatomyAsset::GetNumberOfPoints() const { return m_Data->NumPoints; }
+size_t AnatomyAsset::GetNumberOfTriangles() const { return m_Data->NumTriangles; }
+const uint32_t* AnatomyAsset::GetTriangles() const { return m_Data->Triangles; }
+
+void AnatomyAsset::ReadPoints(float* xyz) const
+{
+  const uint16_t* q = m_Data->Positions;
+  const float* min = m_Data->Min;
+  const float* scale = m_Data->Scale;
+  for (size_t i = 0; i < m_Data->NumPoints; i++, q += 3, xyz += 3)
+  {
+    xyz[0] = min[0] + scale[0] * q[0];
+    xyz[1] = min[1] + scale[1] * q[1];
+    xyz[2] = min[2] + scale[2] * q[2];
+  }
+}
+
+void AnatomyAsset::ReadNormals(float* xyz) const
+{
+  const int16_t* q = m_Data->Normals;
+  for (size_t i = 0; i < m_Data->NumPoints; i++, q += 2, xyz += 3)
+  {
+    float x = q[0] / 32767.0f;
+    float y = q[1] / 32767.0f;
+    float z = 1 - std::fabs(x) - std::fabs(y);
+    if (z < 0)
+    {// Unfold the lower half
+      float ux = (1 - std::fabs(y)) * (x < 0 ? -1 : 1);
+      float uy = (1 - std::fabs(x)) * (y < 0 ? -1 : 1);
+      x = ux;
+      y = uy;
+    }
+    float l = std::sqrt(x * x + y * y + z * z);
+    xyz[0] = x / l;
+    xyz[1] = y / l;
+    xyz[2] = z / l;
+  }
+}
+
+std::vector<uint32_t> AnatomyAsset::OptimizeVertexCache(const std::vector<uint32_t>& triangles, size_t num_points)
+{
+  size_t num_triangles = triangles.size() / 3;
+  std::vector<uint32_t> ordered;
+  ordered.reserve(3 * num_triangles);
+
+  // The triangles using each point, the first Remaining of them are not drawn yet
+  std::vector<uint32_t> offsets(num_points + 1, 0);
+  for (size_t i = 0; i < 3 * num_triangles; i++)
+    offsets[triangles[i] + 1]++;
+  for (size_t v = 0; v < num_points; v++)
+    offsets[v + 1] += offsets[v];
+  std::vector<uint32_t> adjacency(3 * num_triangles);
+  std::vector<uint32_t> remaining(num_points, 0);
+  for (size_t i = 0; i < 3 * num_triangles; i++)
+  {
+    uint32_t v = triangles[i];
+    adjacency[offsets[v] + remaining[v]++] = uint32_t(i / 3);
+  }
+
+  std::vector<int>   cache_position(num_points, -1);
+  std::vector<float> vertex_score(num_points);
+  for (size_t v = 0; v < num_points; v++)
+    vertex_score[v] = VertexScore(-1, remaining[v]);
+  std::vector<float> triangle_score(num_triangles);
+  std::vector<bool>  drawn(num_triangles, false);
+  size_t best = num_triangles;
+  for (size_t t = 0; t < num_triangles; t++)
+  {
+    const uint32_t* tri = &triangles[3 * t];
+    triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    if (best == num_triangles || triangle_score[t] > triangle_score[best])
+      best = t;
+  }
+
+  std::vector<uint32_t> cache, next_cache;
+  size_t next_undrawn = 0;
+  for (size_t n = 0; n < num_triangles; n++)
+  {
+    if (best == num_triangles)
+    {// Nothing in the cache leads anywhere, start on the next piece of the mesh
+      while (drawn[next_undrawn])
+        next_undrawn++;
+      best = next_undrawn;
+    }
+    const uint32_t* tri = &triangles[3 * best];
+    drawn[best] = true;
+    next_cache.assign(tri, tri + 3);
+    for (int k = 0; k < 3; k++)
+    {
+      uint32_t v = tri[k];
+      ordered.push_back(v);
+      uint32_t* used = &adjacency[offsets[v]];
+      uint32_t* last = used + --remaining[v];
+      std::swap(*std::find(used, last + 1, uint32_t(best)), *last);
+    }
+    for (uint32_t v : cache)
+      if (v != tri[0] && v != tri[1] && v != tri[2])
+        next_cache.push_back(v);
+    cache.swap(next_cache);
+
+    // Rescore what is in (or just fell out of) the cache, and the triangles using it
+    for (size_t c = 0; c < cache.size(); c++)
+    {
+      uint32_t v = cache[c];
+      cache_position[v] = c < size_t(CacheSize) ? int(c) : -1;
+      vertex_score[v] = VertexScore(cache_position[v], remaining[v]);
+    }
+    best = num_triangles;
+    for (uint32_t v : cache)
+    {
+      for (uint32_t i = 0; i < remaining[v]; i++)
+      {
+        uint32_t t = adjacency[offsets[v] + i];
+        const uint32_t* u = &triangles[3 * t];
+        triangle_score[t] = vertex_score[u[0]] + vertex_score[u[1]] + vertex_score[u[2]];
+        if (best == num_triangles || triangle_score[t] > triangle_score[best])
+          best = t;
+      }
+    }
+    if (cache.size() > size_t(CacheSize))
+      cache.resize(CacheSize);
+  }
+  return ordered;
+}
+
+void AnatomyAsset::ReorderPoints(std::vector<float>& points, std::vector<float>& normals, std::vector<uint32_t>& triangles)
+{
+  size_t num_points = points.size() / 3;
+  std::vector<uint32_t> remap(num_points, uint32_t(-1));
+  std::vector<float> reordered_points, reordered_normals;
+  reordered_points.reserve(points.size());
+  reordered_normals.reserve(normals.size());
+  uint32_t next = 0;
+  for (uint32_t& v : triangles)
+  {
+    if (remap[v] == uint32_t(-1))
+    {
+      remap[v] = next++;
+      reordered_points.insert(reordered_points.end(), &points[3 * v], &points[3 * v] + 3);
+      if (normals.size() == points.size())
+        reordered_normals.insert(reordered_normals.end(), &normals[3 * v], &normals[3 * v] + 3);
+    }
+    v = remap[v];
+  }
+  points.swap(reordered_points);
+  normals.swap(reordered_normals);
+}
+
+double AnatomyAsset::GetACMR(const std::vector<uint32_t>& triangles, size_t num_points, size_t cache_size)
+{
+  if (triangles.size() < 3)
+    return 0;
+  // When each point went into the FIFO, a point is in it if fewer than cache_size others went in since
+  std::vector<size_t> inserted(num_points, size_t(-1));
+  size_t fifo = 0;
+  size_t misses = 0;
+  for (uint32_t v : triangles)
+  {
+    if (inserted[v] == size_t(-1) || fifo - inserted[v] >= cache_size)
+    {
+      inserted[v] = fifo++;
+      misses++;
+    }
+  }
+  return double(misses) / (triangles.size() / 3);
+}
+
+bool AnatomyAsset::Write(const std::string& filename, const std::vector<float>& points, const std::vector<float>& normals, const std::vector<uint32_t>& triangles)
+{
+  uint32_t num_points = uint32_t(points.size() / 3);
+  uint32_t num_triangles = uint32_t(triangles.size() / 3);
+  if (num_points == 0 || normals.size() != points.size())
+    return false;
+  float min[3], max[3], scale[3];
+  for (int a = 0; a < 3; a++)
+  {
+    min[a] = max[a] = points[a];
+    for (size_t i = a; i < points.size(); i += 3)
+    {
+      min[a] = std::min(min[a], points[i]);
+      max[a] = std::max(max[a], points[i]);
+    }
+    scale[a] = (max[a] - min[a]) / 65535;
+  }
+
+  std::ofstream out(filename, std::ios::binary);
+  if (!out)
+    return false;
+  out.write(Magic, 8);
+  out.write((const char*)&num_points, sizeof(uint32_t));
+  out.write((const char*)&num_triangles, sizeof(uint32_t));
+  out.write((const char*)min, 3 * sizeof(float));
+  out.write((const char*)scale, 3 * sizeof(float));
+
+  std::vector<uint16_t> positions(3 * size_t(num_points));
+  for (size_t i = 0; i < positions.size(); i++)
+  {
+    int a = i % 3;
+    positions[i] = scale[a] > 0 ? uint16_t(std::lround((points[i] - min[a]) / scale[a])) : 0;
+  }
+  out.write((const char*)positions.data(), positions.size() * sizeof(uint16_t));
+  static const char pad[4] = { 0,0,0,0 };
+  size_t bytes = positions.size() * sizeof(uint16_t);
+  out.write(pad, Padded(bytes) - bytes);
+
+  std::vector<int16_t> encoded(2 * size_t(num_points));
+  for (size_t i = 0; i < num_points; i++)
+    EncodeNormal(&normals[3 * i], &encoded[2 * i]);
+  out.write((const char*)encoded.data(), encoded.size() * sizeof(int16_t));
+  out.write((const char*)triangles.data(), 3 * size_t(num_triangles) * sizeof(uint32_t));
+  return out.good();
+}
@@ -0,0 +1,61 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A triangle mesh prebuilt for loading and drawing, made from the anatomy vtp files by AnatomyAssetBuilder.
+// Triangles are ordered for the GPU vertex cache (Forsyth's linear speed optimization) and points are
+// ordered by first use, so fetching them walks memory forward. Positions are quantized to 16 bits in the
+// bounding box of the mesh and normals are octahedral encoded into two 16 bit values.
+// Reading maps the file and decodes each array in one pass straight into the caller's memory, there is nothing to parse.
+//
+// File layout (little endian) :
+//   "PXANAT01", uint32 number of points, uint32 number of triangles
+//   float min[3], float scale[3] (position = min + scale * quantized)
+//   uint16 positions[3 * points], padded to 4 bytes
+//   int16 normals[2 * points]
+//   uint32 triangles[3 * triangles]
+class AnatomyAsset
+{
+public:
+  AnatomyAsset();
+  virtual ~AnatomyAsset();
+
+  bool Open(const std::string& filename);// Maps the file and checks its header
+  void Close();
+
+  size_t GetNumberOfPoints() const;
+  size_t GetNumberOfTriangles() const;
+  void ReadPoints(float* xyz) const;
+  void ReadNormals(float* xyz) const;
+  // Valid until Close
+  const uint32_t* GetTriangles() const;
+  // Triangles as cells of a count and 3 point ids, i.e. the legacy vtkCellArray layout
+  template<typename Id> void ReadCells(Id* cells) const
+  {
+    const uint32_t* t = GetTriangles();
+    for (size_t i = 0; i < GetNumberOfTriangles(); i++, t += 3)
+    {
+      *cells++ = 3;
+      *cells++ = Id(t[0]);
+      *cells++ = Id(t[1]);
+      *cells++ = Id(t[2]);
+    }
+  }
+
+  // Building an asset, points and normals are xyz per point, triangles are 3 point ids each
+  // Returns the triangles in vertex cache friendly order
+  static std::vector<uint32_t> OptimizeVertexCache(const std::vector<uint32_t>& triangles, size_t num_points);
+  // Renumbers points in the order the triangles first use them, points no triangle uses are dropped
+  static void ReorderPoints(std::vector<float>& points, std::vector<float>& normals, std::vector<uint32_t>& triangles);
+  // Average cache misses per triangle with a FIFO cache, 0.5 is about as good as it gets and 3 is as bad
+  static double GetACMR(const std::vector<uint32_t>& triangles, size_t num_points, size_t cache_size = 16);
+  static bool Write(const std::string& filename, const std::vector<float>& points, const std::vector<float>& normals, const std::vector<uint32_t>& triangles);
+
+private:
+  class Data;
+  Data* m_Data;
+};
@@ -0,0 +1,84 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include <iostream>
+#include "AnatomyAsset.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkSmartPointer.h>
+#include <vtkTriangleFilter.h>
+#include <vtkXMLPolyDataReader.h>
+
+// Offline builder of the binary anatomy assets the GeometryView loads instead of the vtp files
+int main(int argc, char* argv[])
+{
+  if (argc != 3)
+  {
+    std::cerr << "Usage : " << argv[0] << " <mesh.vtp> <mesh.pxa>" << std::endl;
+    return 1;
+  }
+  vtkSmartPointer<vtkXMLPolyDataReader> reader = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+  reader->SetFileName(argv[1]);
+  vtkSmartPointer<vtkTriangleFilter> triangles = vtkSmartPointer<vtkTriangleFilter>::New();
+  triangles->SetInputConnection(reader->GetOutputPort());
+  triangles->PassVertsOff();
+  triangles->PassLinesOff();
+  // Splitting would duplicate points along sharp edges, the anatomy is smooth enough without it
+  vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+  normals->SetInputConnection(triangles->GetOutputPort());
+  normals->SplittingOff();
+  normals->ConsistencyOn();
+  normals->ComputePointNormalsOn();
+  normals->ComputeCellNormalsOff();
+  normals->Update();
+  vtkPolyData* mesh = normals->GetOutput();
+  vtkDataArray* meshNormals = mesh->GetPointData()->GetNormals();
+  if (mesh->GetNumberOfPolys() == 0 || meshNormals == nullptr)
+  {
+    std::cerr << "No triangles in " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::vector<float> points(3 * mesh->GetNumberOfPoints());
+  std::vector<float> pointNormals(points.size());
+  for (vtkIdType i = 0; i < mesh->GetNumberOfPoints(); i++)
+  {
+    double p[3], n[3];
+    mesh->GetPoint(i, p);
+    meshNormals->GetTuple(i, n);
+    for (int a = 0; a < 3; a++)
+    {
+      points[3 * i + a] = float(p[a]);
+      pointNormals[3 * i + a] = float(n[a]);
+    }
+  }
+  std::vector<uint32_t> ids;
+  vtkIdType npts;
+  vtkIdType* pts;
+  vtkCellArray* polys = mesh->GetPolys();
+  for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+  {// Degenerate triangles draw nothing
+    if (npts != 3 || pts[0] == pts[1] || pts[1] == pts[2] || pts[0] == pts[2])
+      continue;
+    ids.push_back(uint32_t(pts[0]));
+    ids.push_back(uint32_t(pts[1]));
+    ids.push_back(uint32_t(pts[2]));
+  }
+
+  size_t numPoints = points.size() / 3;
+  double before = AnatomyAsset::GetACMR(ids, numPoints);
+  ids = AnatomyAsset::OptimizeVertexCache(ids, numPoints);
+  double after = AnatomyAsset::GetACMR(ids, numPoints);
+  AnatomyAsset::ReorderPoints(points, pointNormals, ids);
+  if (!AnatomyAsset::Write(argv[2], points, pointNormals, ids))
+  {
+    std::cerr << "Unable to write " << argv[2] << std::endl;
+    return 1;
+  }
+  std::cout << argv[2] << " : " << points.size() / 3 << " points, " << ids.size() / 3 << " triangles, "
+            << "cache misses per triangle " << before << " -> " << after << std::endl;
+  return 0;
+}
@@ -95,6 +95,7 @@ ExternalProject_Add(PhysiologyExplorer
   INSTALL_DIR ${CMAKE_BINARY_DIR}/install
   CMAKE_ARGS
     -DDO_SUPERBUILD:BOOL=OFF
+    -DPULSE_EXPLORER_COUNT_ALLOCATIONS:BOOL=${PULSE_EXPLORER_COUNT_ALLOCATIONS}
     -DCMAKE_BUILD_TYPE:STRING=${CMAKE_BUILD_TYPE}
     -DCMAKE_INSTALL_PREFIX=${CMAKE_BINARY_DIR}/install
     -DParaView_DIR:PATH=${ParaView_DIR}
@@ -0,0 +1,20 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include <iostream>
+#include "DataRequestExporter.h"
+
+// Offline converter for the columnar data request files the Explorer writes
+int main(int argc, char* argv[])
+{
+  if (argc != 3)
+  {
+    std::cerr << "Usage : " << argv[0] << " <DataRequests.pxc> <DataRequests.csv>" << std::endl;
+    return 1;
+  }
+  if (!DataRequestExporter::ConvertToCSV(argv[1], argv[2]))
+  {
+    std::cerr << "Unable to convert " << argv[1] << std::endl;
+    return 1;
+  }
+  return 0;
+}
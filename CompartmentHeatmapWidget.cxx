@@ -0,0 +1,186 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "CompartmentHeatmapWidget.h"
+
+#include <QMutex>
+
+#include "CompartmentSnapshot.h"
+#include "HeatmapWidget.h"
+#include <algorithm>
+#include <cmath>
+
+static const char* DefaultTitle = "Change since the start of the run, hover a cell for its compartment";
+// Changes this big (as a fraction of the starting value) get the full color
+static const double FullScale = 0.5;
+// Starting values closer to zero than this (in their unit) are scaled as if they were this, so a trickle of flow does not light up
+static const double MinimumScale = 1;
+static const QColor LowColor(37, 99, 235);
+static const QColor MiddleColor(Qt::white);
+static const QColor HighColor(220, 38, 38);
+static const QRgb MissingColor = qRgb(200, 200, 200);
+
+static double Change(double value, double baseline)
+{
+  return (value - baseline) / std::max(std::fabs(baseline), MinimumScale);
+}
+
+static QRgb ChangeColor(double value, double baseline)
+{
+  if (std::isnan(value) || std::isnan(baseline))
+    return MissingColor;
+  double t = std::max(-1., std::min(1., Change(value, baseline) / FullScale));
+  const QColor& end = t < 0 ? LowColor : HighColor;
+  double a = std::fabs(t);
+  return qRgb(int(MiddleColor.red() + a * (end.red() - MiddleColor.red())),
+              int(MiddleColor.green() + a * (end.green() - MiddleColor.green())),
+              int(MiddleColor.blue() + a * (end.blue() - MiddleColor.blue())));
+}
+
+class CompartmentHeatmapWidget::Controls
+{
+public:
+  QMutex                   Mutex;
+  // Filled on the engine thread
+  CompartmentSnapshot      Snapshot;
+  std::vector<std::string> Names;
+  std::vector<double>      Latest;
+  std::vector<double>      Baseline;// The first snapshot of the run
+  bool                     Fresh = false;// A snapshot not drawn yet
+  bool                     Rebuild = true;// The compartments changed
+  // Only touched on the GUI thread
+  HeatmapWidget*           Heatmap;
+  std::vector<std::string> ShownNames;
+  std::vector<double>      Shown;
+  std::vector<double>      ShownBaseline;
+  std::vector<QRgb>        Colors;
+  int                      HoverRow = -1;
+  int                      HoverColumn = -1;
+};
+
+CompartmentHeatmapWidget::CompartmentHeatmapWidget(QWidget *parent, Qt::WindowFlags flags) : QDockWidget(parent, flags)
+{
+  m_Controls = new Controls();
+  m_Controls->Heatmap = new HeatmapWidget(this);
+  // Cells are compartments across, quantities down
+  QStringList rows;
+  for (size_t q = 0; q < CompartmentSnapshot::NumQuantities; q++)
+    rows << QString("%1 (%2)").arg(CompartmentSnapshot::GetQuantityName(q)).arg(CompartmentSnapshot::GetQuantityUnit(q));
+  m_Controls->Heatmap->SetRowNames(rows);
+  m_Controls->Heatmap->SetTitle(DefaultTitle);
+  m_Controls->Heatmap->SetLegend(QString("-%1%").arg(100 * FullScale), QString("+%1%").arg(100 * FullScale), LowColor, MiddleColor, HighColor);
+  setWidget(m_Controls->Heatmap);
+
+  connect(m_Controls->Heatmap, SIGNAL(CellHovered(int, int)), SLOT(ShowCell(int, int)));
+}
+
+CompartmentHeatmapWidget::~CompartmentHeatmapWidget()
+{
+  delete m_Controls;
+}
+
+void CompartmentHeatmapWidget::Reset()
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Snapshot.Clear();
+  m_Controls->Names.clear();
+  m_Controls->Latest.clear();
+  m_Controls->Baseline.clear();
+  m_Controls->Fresh = true;
+  m_Controls->Rebuild = true;
+  m_Controls->Mutex.unlock();
+}
+
+void CompartmentHeatmapWidget::ProcessPhysiology(PhysiologyEngine& pulse)
+{
+  // The snapshot is taken every step in PulseStepped
+}
+
+void CompartmentHeatmapWidget::PulseStepped(PhysiologyEngine& pulse)
+{
+  m_Controls->Mutex.lock();
+  if (!m_Controls->Snapshot.IsResolved())
+  {
+    m_Controls->Snapshot.Resolve(pulse);
+    m_Controls->Latest.resize(m_Controls->Snapshot.GetNumberOfValues());
+    if (m_Controls->Snapshot.GetNames() != m_Controls->Names)
+    {// A loaded state from the same run keeps the baseline, anything else starts over
+      m_Controls->Names = m_Controls->Snapshot.GetNames();
+      m_Controls->Baseline.clear();
+      m_Controls->Rebuild = true;
+    }
+  }
+  m_Controls->Snapshot.Take(m_Controls->Latest.data());
+  if (m_Controls->Baseline.empty())
+    m_Controls->Baseline = m_Controls->Latest;
+  m_Controls->Fresh = true;
+  m_Controls->Mutex.unlock();
+}
+
+void CompartmentHeatmapWidget::PulseStateLoaded(PhysiologyEngine& pulse)
+{
+  // The compartments we point to went with the old state
+  m_Controls->Mutex.lock();
+  m_Controls->Snapshot.Clear();
+  m_Controls->Mutex.unlock();
+}
+
+bool CompartmentHeatmapWidget::NeedsRender() const
+{
+  if (!isVisible())
+    return false;
+  m_Controls->Mutex.lock();
+  bool fresh = m_Controls->Fresh;
+  m_Controls->Mutex.unlock();
+  return fresh;
+}
+
+void CompartmentHeatmapWidget::Render()
+{
+  Controls& c = *m_Controls;
+  c.Mutex.lock();
+  c.Fresh = false;
+  if (c.Rebuild)
+  {
+    c.ShownNames = c.Names;
+    c.Rebuild = false;
+  }
+  c.Shown = c.Latest;
+  c.ShownBaseline = c.Baseline;
+  c.Mutex.unlock();
+
+  size_t columns = c.ShownNames.size();
+  const size_t rows = CompartmentSnapshot::NumQuantities;
+  if (c.Shown.size() != rows * columns || c.ShownBaseline.size() != c.Shown.size())
+    columns = 0;
+  c.Heatmap->SetSize(rows, columns);
+  c.Colors.resize(rows * columns);
+  for (size_t r = 0; r < rows; r++)
+    for (size_t col = 0; col < columns; col++)
+      c.Colors[r * columns + col] = ChangeColor(c.Shown[col * rows + r], c.ShownBaseline[col * rows + r]);
+  c.Heatmap->SetColors(c.Colors);
+  ShowCell(c.HoverRow, c.HoverColumn);
+}
+
+void CompartmentHeatmapWidget::ShowCell(int row, int column)
+{
+  Controls& c = *m_Controls;
+  c.HoverRow = row;
+  c.HoverColumn = column;
+  size_t rows = CompartmentSnapshot::NumQuantities;
+  size_t i = size_t(column) * rows + size_t(row);
+  if (row < 0 || column < 0 || size_t(column) >= c.Heatmap->GetNumberOfColumns() || i >= c.Shown.size())
+  {
+    c.Heatmap->SetTitle(DefaultTitle);
+    return;
+  }
+  double value = c.Shown[i];
+  double baseline = c.ShownBaseline[i];
+  QString change = std::isnan(value) || std::isnan(baseline) ? QString("no value") :
+    QString("%1%2% since the start").arg(value >= baseline ? "+" : "").arg(100 * Change(value, baseline), 0, 'f', 1);
+  c.Heatmap->SetTitle(QString("%1 %2 : %3 %4 (%5)")
+    .arg(QString::fromStdString(c.ShownNames[column]))
+    .arg(CompartmentSnapshot::GetQuantityName(row))
+    .arg(value, 0, 'g', 4)
+    .arg(CompartmentSnapshot::GetQuantityUnit(row))
+    .arg(change));
+}
@@ -0,0 +1,33 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QObject>
+#include <QDockWidget>
+#include "QPulse.h"
+
+// Every liquid and gas compartment's pressure, volume and flows at once, as a heatmap
+// colored by how far each value has moved since the start of the run
+class CompartmentHeatmapWidget : public QDockWidget, public PulseListener
+{
+  Q_OBJECT
+public:
+  CompartmentHeatmapWidget(QWidget *parent = Q_NULLPTR, Qt::WindowFlags flags = Qt::WindowFlags());
+  virtual ~CompartmentHeatmapWidget();
+
+  void Reset();
+  void ProcessPhysiology(PhysiologyEngine& pulse);
+  void PulseStepped(PhysiologyEngine& pulse);
+  void PulseStateLoaded(PhysiologyEngine& pulse);
+
+  // For the render scheduler, a new snapshot to show
+  bool NeedsRender() const;
+  void Render();
+
+protected slots:
+  void ShowCell(int row, int column);
+
+private:
+  class Controls;
+  Controls* m_Controls;
+};
@@ -0,0 +1,96 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "CompartmentSnapshot.h"
+
+#include <limits>
+
+#include "cdm/CommonDataModel.h"
+#include "PulsePhysiologyEngine.h"
+#include "cdm/compartment/SECompartmentManager.h"
+#include "cdm/compartment/fluid/SELiquidCompartment.h"
+#include "cdm/compartment/fluid/SEGasCompartment.h"
+#include "cdm/properties/SEScalarPressure.h"
+#include "cdm/properties/SEScalarVolume.h"
+#include "cdm/properties/SEScalarVolumePerTime.h"
+
+// Fills one compartment's values, same layout for liquids and gases
+template<typename Compartment>
+static void TakeCompartment(const Compartment& c, double* values)
+{
+  static const double NaN = std::numeric_limits<double>::quiet_NaN();
+  values[CompartmentSnapshot::Pressure] = c.HasPressure() ? c.GetPressure(PressureUnit::mmHg) : NaN;
+  values[CompartmentSnapshot::Volume] = c.HasVolume() ? c.GetVolume(VolumeUnit::mL) : NaN;
+  values[CompartmentSnapshot::InFlow] = c.HasInFlow() ? c.GetInFlow(VolumePerTimeUnit::mL_Per_s) : NaN;
+  values[CompartmentSnapshot::OutFlow] = c.HasOutFlow() ? c.GetOutFlow(VolumePerTimeUnit::mL_Per_s) : NaN;
+}
+
+void CompartmentSnapshot::Resolve(PhysiologyEngine& pulse)
+{
+  Clear();
+  const SECompartmentManager& cmpts = pulse.GetCompartments();
+  for (SELiquidCompartment* c : cmpts.GetLiquidLeafCompartments())
+  {
+    Liquids.push_back(c);
+    Names.push_back(c->GetName());
+  }
+  for (SEGasCompartment* c : cmpts.GetGasLeafCompartments())
+  {
+    Gases.push_back(c);
+    Names.push_back(c->GetName());
+  }
+  Resolved = true;
+}
+
+bool CompartmentSnapshot::IsResolved() const
+{
+  return Resolved;
+}
+
+void CompartmentSnapshot::Clear()
+{
+  Liquids.clear();
+  Gases.clear();
+  Names.clear();
+  Resolved = false;
+}
+
+size_t CompartmentSnapshot::GetNumberOfCompartments() const
+{
+  return Names.size();
+}
+
+size_t CompartmentSnapshot::GetNumberOfValues() const
+{
+  return Names.size() * NumQuantities;
+}
+
+const std::vector<std::string>& CompartmentSnapshot::GetNames() const
+{
+  return Names;
+}
+
+const char* CompartmentSnapshot::GetQuantityName(size_t quantity)
+{
+  static const char* names[] = { "Pressure", "Volume", "In Flow", "Out Flow" };
+  return quantity < NumQuantities ? names[quantity] : "";
+}
+
+const char* CompartmentSnapshot::GetQuantityUnit(size_t quantity)
+{
+  static const char* units[] = { "mmHg", "mL", "mL/s", "mL/s" };
+  return quantity < NumQuantities ? units[quantity] : "";
+}
+
+void CompartmentSnapshot::Take(double* values) const
+{
+  for (const SELiquidCompartment* c : Liquids)
+  {
+    TakeCompartment(*c, values);
+    values += NumQuantities;
+  }
+  for (const SEGasCompartment* c : Gases)
+  {
+    TakeCompartment(*c, values);
+    values += NumQuantities;
+  }
+}
@@ -0,0 +1,37 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+class PhysiologyEngine;
+class SELiquidCompartment;
+class SEGasCompartment;
+
+// The pressure, volume and flows of every liquid (vascular) and gas (pulmonary) leaf compartment, read in one pass into one flat array.
+// Compartments are looked up once when resolving, after that taking a snapshot only walks a list of pointers.
+// Compartments belong to the engine state, resolve again after a state is loaded.
+class CompartmentSnapshot
+{
+public:
+  enum Quantity { Pressure = 0, Volume, InFlow, OutFlow, NumQuantities };
+
+  void Resolve(PhysiologyEngine& pulse);
+  bool IsResolved() const;
+  void Clear();
+
+  size_t GetNumberOfCompartments() const;
+  size_t GetNumberOfValues() const;// Compartments * NumQuantities
+  const std::vector<std::string>& GetNames() const;
+  static const char* GetQuantityName(size_t quantity);
+  static const char* GetQuantityUnit(size_t quantity);
+
+  // values[compartment * NumQuantities + quantity], NaN where a compartment does not have the quantity
+  void Take(double* values) const;
+
+private:
+  std::vector<SELiquidCompartment*> Liquids;
+  std::vector<SEGasCompartment*>    Gases;
+  std::vector<std::string>          Names;// Liquids, then gases
+  bool                              Resolved = false;
+};
@@ -0,0 +1,259 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "DataRequestExporter.h"
+
+#include <QByteArray>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+static const char Magic[] = "PXCOLS01";
+
+struct ExportChunk
+{
+  std::vector<double> Rows;// Row major, as the engine thread wrote them
+  size_t              NumRows = 0;
+};
+
+class DataRequestExporter::Data
+{
+public:
+  size_t                    RowsPerChunk;
+  size_t                    MaxChunks;
+  size_t                    NumChunks = 0;// Allocated, the active one, the full ones and the free ones
+  std::atomic<size_t>       DroppedRows;
+  size_t                    NumColumns = 0;
+  std::ofstream             File;
+  std::thread               Writer;
+  std::mutex                Mutex;
+  std::condition_variable   Wake;
+  bool                      Closing = false;
+  ExportChunk*              Active = nullptr;
+  std::deque<ExportChunk*>  Full;
+  std::vector<ExportChunk*> Free;
+
+  // nullptr when every chunk we may have is waiting on the writer
+  ExportChunk* NewChunk()
+  {
+    ExportChunk* chunk;
+    if (Free.empty())
+    {
+      if (NumChunks >= MaxChunks)
+        return nullptr;
+      chunk = new ExportChunk();
+      chunk->Rows.resize(RowsPerChunk * NumColumns);
+      NumChunks++;
+    }
+    else
+    {
+      chunk = Free.back();
+      Free.pop_back();
+    }
+    chunk->NumRows = 0;
+    return chunk;
+  }
+
+  void Write(const ExportChunk& chunk, QByteArray& columns)
+  {
+    // Transpose into columns and shuffle the bytes of each column so all the exponents line up
+    size_t rows = chunk.NumRows;
+    columns.resize(int(rows * NumColumns * sizeof(double)));
+    unsigned char* out = (unsigned char*)columns.data();
+    for (size_t c = 0; c < NumColumns; c++)
+    {
+      unsigned char* col = out + c * rows * sizeof(double);
+      for (size_t r = 0; r < rows; r++)
+      {
+        const unsigned char* v = (const unsigned char*)&chunk.Rows[r * NumColumns + c];
+        for (size_t b = 0; b < sizeof(double); b++)
+          col[b * rows + r] = v[b];
+      }
+    }
+    QByteArray compressed = qCompress(columns);
+    uint32_t header[2] = { uint32_t(rows), uint32_t(compressed.size()) };
+    File.write((const char*)header, sizeof(header));
+    File.write(compressed.constData(), compressed.size());
+  }
+
+  void Run()
+  {
+    QByteArray columns;
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (true)
+    {
+      Wake.wait(lock, [this]() { return Closing || !Full.empty(); });
+      while (!Full.empty())
+      {
+        ExportChunk* chunk = Full.front();
+        Full.pop_front();
+        lock.unlock();
+        Write(*chunk, columns);
+        lock.lock();
+        Free.push_back(chunk);
+      }
+      if (Closing)
+        break;
+    }
+    File.flush();
+  }
+};
+
+DataRequestExporter::DataRequestExporter(size_t rows_per_chunk, size_t max_chunks)
+{
+  m_Data = new DataRequestExporter::Data();
+  m_Data->RowsPerChunk = rows_per_chunk < 1 ? 1 : rows_per_chunk;
+  m_Data->MaxChunks = max_chunks < 2 ? 2 : max_chunks;
+  m_Data->DroppedRows = 0;
+}
+
+DataRequestExporter::~DataRequestExporter()
+{
+  Close();
+  delete m_Data;
+}
+
+bool DataRequestExporter::IsOpen() const
+{
+  return m_Data->File.is_open();
+}
+
+bool DataRequestExporter::Open(const std::string& filename, const std::vector<std::string>& columns)
+{
+  Close();
+  m_Data->File.open(filename, std::ios::binary | std::ios::trunc);
+  if (!m_Data->File.is_open())
+    return false;
+
+  std::vector<std::string> names;
+  names.push_back("Time(s)");
+  names.insert(names.end(), columns.begin(), columns.end());
+  m_Data->File.write(Magic, 8);
+  uint32_t n = uint32_t(names.size());
+  m_Data->File.write((const char*)&n, sizeof(n));
+  for (const std::string& name : names)
+  {
+    n = uint32_t(name.size());
+    m_Data->File.write((const char*)&n, sizeof(n));
+    m_Data->File.write(name.c_str(), name.size());
+  }
+
+  m_Data->NumColumns = names.size();
+  m_Data->DroppedRows = 0;
+  m_Data->Closing = false;
+  m_Data->Active = m_Data->NewChunk();
+  m_Data->Writer = std::thread(&DataRequestExporter::Data::Run, m_Data);
+  return true;
+}
+
+void DataRequestExporter::Append(double time_s, const double* values)
+{
+  ExportChunk* chunk = m_Data->Active;
+  if (chunk == nullptr)
+    return;
+  double* row = &chunk->Rows[chunk->NumRows * m_Data->NumColumns];
+  row[0] = time_s;
+  std::memcpy(row + 1, values, (m_Data->NumColumns - 1) * sizeof(double));
+  if (++chunk->NumRows == m_Data->RowsPerChunk)
+  {// Hand it off, and grab a recycled (or new) one so we never wait on the writer
+    std::lock_guard<std::mutex> lock(m_Data->Mutex);
+    ExportChunk* next = m_Data->NewChunk();
+    if (next == nullptr)
+    {// The writer is stalled, drop these rows and keep filling the same chunk
+      m_Data->DroppedRows += chunk->NumRows;
+      chunk->NumRows = 0;
+      return;
+    }
+    m_Data->Full.push_back(chunk);
+    m_Data->Active = next;
+    m_Data->Wake.notify_one();
+  }
+}
+
+void DataRequestExporter::Close()
+{
+  if (!m_Data->File.is_open())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_Data->Mutex);
+    if (m_Data->Active != nullptr && m_Data->Active->NumRows > 0)
+      m_Data->Full.push_back(m_Data->Active);
+    else if (m_Data->Active != nullptr)
+      m_Data->Free.push_back(m_Data->Active);
+    m_Data->Active = nullptr;
+    m_Data->Closing = true;
+    m_Data->Wake.notify_one();
+  }
+  m_Data->Writer.join();
+  m_Data->File.close();
+  for (ExportChunk* chunk : m_Data->Free)
+    delete chunk;
+  m_Data->Free.clear();
+  m_Data->NumChunks = 0;
+}
+
+size_t DataRequestExporter::GetNumberOfDroppedRows() const
+{
+  return m_Data->DroppedRows;
+}
+
+bool DataRequestExporter::ConvertToCSV(const std::string& columnar, const std::string& csv)
+{
+  std::ifstream in(columnar, std::ios::binary);
+  char magic[8];
+  if (!in.read(magic, 8) || std::memcmp(magic, Magic, 8) != 0)
+    return false;
+  uint32_t numColumns;
+  in.read((char*)&numColumns, sizeof(numColumns));
+  std::ofstream out(csv);
+  if (!in || !out.is_open())
+    return false;
+  for (uint32_t c = 0; c < numColumns; c++)
+  {
+    uint32_t len;
+    in.read((char*)&len, sizeof(len));
+    std::string name(len, ' ');
+    in.read(&name[0], len);
+    out << (c > 0 ? "," : "") << name;
+  }
+  out << "\n";
+  out.precision(15);
+
+  uint32_t header[2];
+  QByteArray compressed;
+  std::vector<double> values;
+  while (in.read((char*)header, sizeof(header)))
+  {
+    size_t rows = header[0];
+    compressed.resize(int(header[1]));
+    if (!in.read(compressed.data(), header[1]))
+      return false;
+    QByteArray columns = qUncompress(compressed);
+    if (size_t(columns.size()) != rows * numColumns * sizeof(double))
+      return false;
+    // Unshuffle
+    values.resize(rows * numColumns);
+    const unsigned char* src = (const unsigned char*)columns.constData();
+    for (size_t c = 0; c < numColumns; c++)
+    {
+      const unsigned char* col = src + c * rows * sizeof(double);
+      for (size_t r = 0; r < rows; r++)
+      {
+        unsigned char* v = (unsigned char*)&values[c * rows + r];
+        for (size_t b = 0; b < sizeof(double); b++)
+          v[b] = col[b * rows + r];
+      }
+    }
+    for (size_t r = 0; r < rows; r++)
+    {
+      for (size_t c = 0; c < numColumns; c++)
+        out << (c > 0 ? "," : "") << values[c * rows + r];
+      out << "\n";
+    }
+  }
+  return true;
+}
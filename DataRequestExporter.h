@@ -0,0 +1,40 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Streams rows of data request values to a chunked, columnar binary file.
+// The engine thread only copies each row into the active chunk, full chunks are
+// handed to a background thread that transposes them into columns, compresses and writes them.
+// If the writer falls max_chunks behind (i.e. a stalled disk or network share), new rows are dropped
+// rather than holding more of them in memory.
+//
+// File layout (little endian) :
+//   "PXCOLS01", uint32 number of columns, then per column : uint32 name length + name
+//   then chunks of : uint32 number of rows, uint32 compressed size, compressed column major doubles
+//   Each column in a chunk is byte shuffled before compression to help the compressor with doubles
+class DataRequestExporter
+{
+public:
+  DataRequestExporter(size_t rows_per_chunk=4096, size_t max_chunks=64);
+  virtual ~DataRequestExporter();
+
+  // The first column is always the simulation time, columns are the names of the values that will be appended
+  bool Open(const std::string& filename, const std::vector<std::string>& columns);
+  bool IsOpen() const;
+  // Call from the engine thread, values must hold a value for every column given to Open
+  void Append(double time_s, const double* values);
+  // Writes out any partial chunk and waits for the writer to finish
+  void Close();
+  // Rows dropped since Open as the writer could not keep up, safe to call from any thread
+  size_t GetNumberOfDroppedRows() const;
+
+  // Offline conversion of a columnar file to csv
+  static bool ConvertToCSV(const std::string& columnar, const std::string& csv);
+
+private:
+  class Data;
+  Data* m_Data;
+};
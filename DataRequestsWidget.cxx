@@ -1,10 +1,26 @@
 #include "DataRequestsWidget.h"
 #include "ui_DataRequests.h"
 
+#include <QCoreApplication>
 #include <QMutex>
 #include <QLayout>
+#include <QDateTime>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+
+#include <pqActiveObjects.h>
 
 #include "QPulsePlot.h"
+#include "StripChartWidget.h"
+#include "PhysiologyTableSource.h"
+#include "DataRequestExporter.h"
+#include "ResultsCSVLoader.h"
+#include "RollingStatistics.h"
+#include "RunComparison.h"
+#include "SignalHistory.h"
+#include "WhatIfPredictor.h"
+#include <thread>
 
 #include "cdm/CommonDataModel.h"
 #include "PulsePhysiologyEngine.h"
@@ -12,37 +28,371 @@
 #include "cdm/utils/FileUtils.h"
 #include "cdm/system/equipment/electrocardiogram/SEElectroCardioGramWaveformInterpolator.h"
 #include "cdm/properties/SEScalarTime.h"
+#include <algorithm>
 
-
+// Samples kept (and drawn) per data request
+static const size_t PlotSamples = 1000;
+// Views shared by all data requests, so flipping back and forth between two requests needs no rebind
+static const size_t ViewPoolSize = 2;
+// Points runs are resampled to for comparison, plenty for the width of a chart
+static const size_t ComparisonPoints = 500;
+// Most buckets drawn across the whole session chart, each is a stroke from its min to its max
+static const size_t SessionPoints = 500;
+// Compared runs are drawn in these, in the order they were added
+static const Qt::GlobalColor RunColors[] = { Qt::blue, Qt::red, Qt::magenta, Qt::darkCyan, Qt::darkYellow,
+                                             Qt::darkMagenta, Qt::darkBlue, Qt::darkRed, Qt::cyan, Qt::black };
+static const char* RunColorNames[] = { "blue", "red", "magenta", "dark cyan", "dark yellow",
+                                       "dark magenta", "dark blue", "dark red", "cyan", "black" };
+static const size_t NumRunColors = sizeof(RunColors) / sizeof(RunColors[0]);
 
 class DataRequestsWidget::Controls : public Ui::DataRequestsWidget
 {
 public:
-  Controls(QTextEdit& log) : LogBox(log) {}
-  QTextEdit&                         LogBox;
+  Controls(LogWidget& log) : LogBox(log) {}
+  LogWidget&                         LogBox;
   QMutex                             Mutex;
   size_t                             CurrentPlot=-1;
   std::vector<QPulsePlot*>           Plots;
   std::vector<double>                Values; // New value for the plot
+  DataRequestExporter                Exporter;
+  size_t                             ExportDropped = 0;// Rows the exporter dropped that we have logged
+  double                             SimTime_s = 0;
+  double                             PredictionEnd_s = -1;
+  ResultsCSVLoader                   Loader;
+  std::thread                        LoadThread;
+  std::vector<std::vector<double>>   LoadedColumns;
+  PhysiologyTableSource*             TableSource = nullptr;
+  RollingStatistics                  Stats;// Of every data request, in plot order
+  // Plots only hold samples, these few views are handed to whichever plots are being looked at
+  std::vector<StripChartWidget*>     Views;
+  std::vector<size_t>                ViewPlot;// Plot bound to each view, -1 if none
+  std::vector<size_t>                ViewUsed;// When each view was last shown, to reuse the stalest
+  size_t                             ViewClock = 0;
+  size_t                             PlotDecimation = 1;// Append every this many samples to the plots
+  size_t                             PlotSkipped = 0;
+  bool                               Dirty = false;// Since the plot was last drawn
+  PulsePrediction                    Prediction;
+  // Recorded runs drawn over the plots, lined up on when this run started
+  RunComparison                      Runs;
+  double                             RunStart_s = -1;
+  GridInterpolator                   Reference;// Lookups into the window of the plot being compared
+  size_t                             ReferencePlot = -1;
+  std::vector<double>                GridTimes;// The comparison grid in simulation time of this run
+  std::vector<double>                Resampled;
+  std::vector<double>                ReferenceValues;
+  bool                               Differences = false;
+  StripChartWidget*                  DifferenceView = nullptr;
+  // Everything since the graphs were built, drawn instead of the plot window when looking at the whole session
+  SignalHistory                      History;
+  bool                               WholeSession = false;
+  StripChartWidget*                  SessionView = nullptr;
+  std::vector<double>                SessionTimes;
+  std::vector<double>                SessionMins;
+  std::vector<double>                SessionMaxs;
+  std::vector<double>                SessionMeans;
+  std::vector<double>                SessionX;
+  std::vector<double>                SessionY;
+
+  void SetTableColumns(const std::vector<std::string>& names)
+  {
+    if (TableSource == nullptr)
+      TableSource = new PhysiologyTableSource(pqActiveObjects::instance().activeServer());
+    TableSource->SetColumns(names);
+  }
+
+  QPulsePlot* AddPlot(const std::string& title)
+  {
+    QPulsePlot *p = new QPulsePlot(PlotSamples);
+    p->SetTitle(title.c_str());
+    Plots.push_back(p);
+    DataRequested->addItem(QString(title.c_str()));
+    return p;
+  }
+
+  // Views are only made when someone actually looks at a plot, and never more than ViewPoolSize of them.
+  // Switching to a plot without a view rebinds the stalest view, costing a copy of its visible samples
+  void ShowPlot(size_t idx)
+  {
+    if (idx >= Plots.size())
+      return;
+    if (WholeSession && History.GetNumberOfSamples() > 1)
+    {
+      ShowSession(idx);
+      return;
+    }
+    if (SessionView != nullptr)
+      SessionView->setVisible(false);
+    size_t v = 0;
+    while (v < Views.size() && ViewPlot[v] != idx)
+      v++;
+    if (v == Views.size())
+    {
+      if (Views.size() < ViewPoolSize)
+      {
+        Views.push_back(new StripChartWidget(PlotSamples, DataGraphWidget));
+        ViewPlot.push_back(-1);
+        ViewUsed.push_back(0);
+        DataGraphWidget->layout()->addWidget(Views.back());
+      }
+      else
+        v = std::min_element(ViewUsed.begin(), ViewUsed.end()) - ViewUsed.begin();
+      if (ViewPlot[v] < Plots.size())
+        Plots[ViewPlot[v]]->SetView(nullptr);
+      ViewPlot[v] = idx;
+      Plots[idx]->SetView(Views[v]);
+    }
+    ViewUsed[v] = ++ViewClock;
+    for (size_t i = 0; i < Views.size(); i++)
+      if (i != v)
+        Views[i]->setVisible(false);
+    if (Runs.GetNumberOfRuns() > 0)
+      ShowRuns(idx);
+    else if (DifferenceView != nullptr)
+      DifferenceView->setVisible(false);
+    Plots[idx]->UpdateUI();
+  }
+
+  // Only the history level with about a record per pixel is read, however long the session
+  void ShowSession(size_t idx)
+  {
+    for (StripChartWidget* view : Views)
+      view->setVisible(false);
+    if (DifferenceView != nullptr)
+      DifferenceView->setVisible(false);
+    if (SessionView == nullptr)
+    {
+      SessionView = new StripChartWidget(2 * SessionPoints, DataGraphWidget);
+      DataGraphWidget->layout()->addWidget(SessionView);
+    }
+    size_t points = std::min(SessionPoints, size_t(std::max(2, SessionView->width())));
+    History.Query(idx, History.GetStartTime_s(), History.GetEndTime_s(), points, SessionTimes, SessionMins, SessionMaxs, SessionMeans);
+    if (SessionTimes.empty())
+      return;
+    SessionX.resize(2 * SessionTimes.size());
+    SessionY.resize(2 * SessionTimes.size());
+    double minY = SessionMins[0];
+    double maxY = SessionMaxs[0];
+    for (size_t i = 0; i < SessionTimes.size(); i++)
+    {// Alternate the direction of the strokes so each bucket connects to the next through its nearer extreme
+      bool up = i % 2 == 0;
+      SessionX[2 * i] = SessionTimes[i];
+      SessionX[2 * i + 1] = SessionTimes[i];
+      SessionY[2 * i] = up ? SessionMins[i] : SessionMaxs[i];
+      SessionY[2 * i + 1] = up ? SessionMaxs[i] : SessionMins[i];
+      minY = std::min(minY, SessionMins[i]);
+      maxY = std::max(maxY, SessionMaxs[i]);
+    }
+    double pad = maxY > minY ? (maxY - minY) * 0.05 : 0.5;
+    SessionView->SetTitle(DataRequested->itemText(int(idx)) + " (whole session)");
+    SessionView->SetSamples(SessionX.data(), SessionY.data(), SessionX.size());
+    SessionView->SetRange(History.GetStartTime_s(), History.GetEndTime_s(), minY - pad, maxY + pad);
+    SessionView->setVisible(true);
+  }
+
+  void ShowPrediction(size_t idx)
+  {
+    QPulsePlot* plot = Plots[idx];
+    plot->ClearGhosts();
+    if (PredictionEnd_s >= 0 && idx < Prediction.Baseline.size() && idx < Prediction.Intervention.size())
+    {
+      plot->AddGhost(Prediction.Times_s, Prediction.Baseline[idx], Qt::gray);
+      plot->AddGhost(Prediction.Times_s, Prediction.Intervention[idx], Qt::darkGreen);
+    }
+  }
+
+  // Draw the recorded runs over the window of samples this plot is showing
+  void ShowRuns(size_t idx)
+  {
+    QPulsePlot* plot = Plots[idx];
+    ShowPrediction(idx);
+    size_t n = plot->GetNumberOfSamples();
+    if (RunStart_s < 0 || n < 2)
+      return;
+    const double* times = plot->GetTimes();
+    // The grid, and every run's lookups into it, only change when the window moves, not per signal
+    if (Runs.SetGrid(times[0] - RunStart_s, times[n - 1] - RunStart_s, ComparisonPoints) || ReferencePlot != idx)
+    {
+      const std::vector<double>& grid = Runs.GetGrid();
+      Reference.Build(grid, times, n, RunStart_s);
+      ReferencePlot = idx;
+      GridTimes.resize(grid.size());
+      for (size_t i = 0; i < grid.size(); i++)
+        GridTimes[i] = grid[i] + RunStart_s;
+    }
+    if (Differences)
+    {
+      if (DifferenceView == nullptr)
+      {
+        DifferenceView = new StripChartWidget(ComparisonPoints, DataGraphWidget);
+        DifferenceView->SetTitle("Difference from this run");
+        DataGraphWidget->layout()->addWidget(DifferenceView);
+      }
+      ReferenceValues.resize(GridTimes.size());
+      Reference.Apply(plot->GetValues(), ReferenceValues.data());
+      DifferenceView->ClearGhosts();
+    }
+
+    std::string title = DataRequested->itemText(int(idx)).toStdString();
+    size_t begin, end;
+    double minY = 0, maxY = 0;
+    for (size_t r = 0; r < Runs.GetNumberOfRuns(); r++)
+    {
+      if (!Runs.Resample(r, title, Resampled))
+        continue;
+      Runs.GetCoverage(r, begin, end);
+      QColor color = RunColors[r % NumRunColors];
+      plot->AddGhost(std::vector<double>(GridTimes.begin() + begin, GridTimes.begin() + end),
+                     std::vector<double>(Resampled.begin() + begin, Resampled.begin() + end), color);
+      if (!Differences)
+        continue;
+      begin = std::max(begin, Reference.GetBegin());
+      end = std::min(end, Reference.GetEnd());
+      if (begin >= end)
+        continue;
+      for (size_t i = begin; i < end; i++)
+      {
+        Resampled[i] -= ReferenceValues[i];
+        minY = std::min(minY, Resampled[i]);
+        maxY = std::max(maxY, Resampled[i]);
+      }
+      DifferenceView->AddGhost(std::vector<double>(GridTimes.begin() + begin, GridTimes.begin() + end),
+                               std::vector<double>(Resampled.begin() + begin, Resampled.begin() + end), color);
+    }
+    if (!Differences)
+    {
+      if (DifferenceView != nullptr)
+        DifferenceView->setVisible(false);
+      return;
+    }
+    // This run is the zero line
+    begin = Reference.GetBegin();
+    end = Reference.GetEnd();
+    std::vector<double> zeros(end - begin, 0);
+    DifferenceView->SetSamples(GridTimes.data() + begin, zeros.data(), zeros.size());
+    double pad = maxY > minY ? (maxY - minY) * 0.05 : 0.5;
+    DifferenceView->SetRange(GridTimes.front(), GridTimes.back(), minY - pad, maxY + pad);
+    DifferenceView->setVisible(true);
+  }
+
+  // Runs recorded by the explorer (pxc), or Pulse results (csv)
+  bool LoadRun(const QString& filename, std::vector<std::vector<double>>& columns, std::vector<std::string>& names)
+  {
+    QString csv = filename;
+    if (filename.endsWith(".pxc", Qt::CaseInsensitive))
+    {
+      csv = QDir::tempPath() + "/" + QFileInfo(filename).completeBaseName() + ".csv";
+      if (!DataRequestExporter::ConvertToCSV(filename.toStdString(), csv.toStdString()))
+        return false;
+    }
+    ResultsCSVLoader loader;
+    bool ok = loader.Open(csv.toStdString()) && loader.Load(columns);
+    if (ok)
+      names = loader.GetColumnNames();
+    loader.Close();
+    if (csv != filename)
+      QFile::remove(csv);
+    return ok;
+  }
+
+  // Views outlive the plots, leave them empty and unbound
+  void ReleaseViews()
+  {
+    for (size_t v = 0; v < Views.size(); v++)
+    {
+      if (ViewPlot[v] < Plots.size())
+        Plots[ViewPlot[v]]->SetView(nullptr);
+      ViewPlot[v] = -1;
+      Views[v]->SetSamples(nullptr, nullptr, 0);
+      Views[v]->SetTitle("");
+      Views[v]->ClearGhosts();
+      Views[v]->setVisible(false);
+    }
+    if (DifferenceView != nullptr)
+      DifferenceView->setVisible(false);
+    if (SessionView != nullptr)
+    {
+      SessionView->SetSamples(nullptr, nullptr, 0);
+      SessionView->setVisible(false);
+    }
+    ReferencePlot = -1;
+  }
+
+  void ShowStatistics(size_t idx)
+  {
+    RollingStats stats;
+    if (!Stats.GetStatistics(idx, 0, stats))
+    {
+      StatisticsLabel->setText("");
+      return;
+    }
+    QString names[] = { "Mean", "Std Dev", "Min", "Max", "Slope (/s)" };
+    QString rows[5];
+    QString header = "<tr><td></td>";
+    for (size_t w = 0; w < Stats.GetWindows().size(); w++)
+    {
+      double window_s = Stats.GetWindows()[w];
+      header += "<td align=right><b>" + (window_s < 60 ? QString::number(window_s) + "s" : QString::number(window_s / 60) + "min") + "</b></td>";
+      Stats.GetStatistics(idx, w, stats);
+      double values[] = { stats.Mean, stats.StdDev, stats.Min, stats.Max, stats.Slope };
+      for (int r = 0; r < 5; r++)
+        rows[r] += "<td align=right>" + QString::number(values[r], 'g', 4) + "</td>";
+    }
+    QString table = "<table cellspacing=4>" + header + "</tr>";
+    for (int r = 0; r < 5; r++)
+      table += "<tr><td>" + names[r] + "</td>" + rows[r] + "</tr>";
+    StatisticsLabel->setText(table + "</table>");
+  }
+
+  void SetPlotData(const std::vector<std::vector<double>>& columns)
+  {// Column 0 is time
+    if (!columns.empty() && !columns[0].empty())
+      RunStart_s = columns[0][0];
+    for (size_t i = 0; i < Plots.size() && i + 1 < columns.size(); i++)
+      Plots[i]->SetData(columns[0], columns[i + 1]);
+    if (TableSource != nullptr)
+      TableSource->Update(Plots);
+    ShowPlot(CurrentPlot);
+  }
 };
 
-DataRequestsWidget::DataRequestsWidget(QTextEdit& log, QWidget *parent, Qt::WindowFlags flags) : QDockWidget(parent,flags)
+DataRequestsWidget::DataRequestsWidget(LogWidget& log, QWidget *parent, Qt::WindowFlags flags) : QDockWidget(parent,flags)
 {
   m_Controls = new Controls(log);
   m_Controls->setupUi(this);
 
   connect(m_Controls->DataRequested, SIGNAL(currentIndexChanged(int)), SLOT(ChangePlot(int)));
+  connect(this, SIGNAL(ResultsLoaded()), SLOT(FinishLoadingResults()));
+  connect(m_Controls->CompareRunsButton, SIGNAL(clicked()), SLOT(AddRuns()));
+  connect(m_Controls->ClearRunsButton, SIGNAL(clicked()), SLOT(ClearRuns()));
+  connect(m_Controls->ShowDifferences, SIGNAL(toggled(bool)), SLOT(ToggleDifferences(bool)));
+  connect(m_Controls->ShowWholeSession, SIGNAL(toggled(bool)), SLOT(ToggleWholeSession(bool)));
 }
 
 DataRequestsWidget::~DataRequestsWidget()
 {
   Reset();
+  delete m_Controls->TableSource;
   delete m_Controls;
 }
 
 void DataRequestsWidget::Reset()
 {
+  if (m_Controls->LoadThread.joinable())
+    m_Controls->LoadThread.join();
+  m_Controls->Loader.Close();
+  m_Controls->LoadedColumns.clear();
+  m_Controls->Mutex.lock();
+  m_Controls->Exporter.Close();
+  m_Controls->History.Close();
+  m_Controls->Mutex.unlock();
   m_Controls->CurrentPlot = -1;
+  m_Controls->PredictionEnd_s = -1;
+  m_Controls->RunStart_s = -1;
+  m_Controls->Stats.SetNumberOfSignals(0);
+  m_Controls->StatisticsLabel->setText("");
+  if (m_Controls->TableSource != nullptr)
+    m_Controls->TableSource->SetColumns(std::vector<std::string>());
+  m_Controls->ReleaseViews();
   DELETE_VECTOR(m_Controls->Plots);
   m_Controls->DataRequested->clear();
 }
@@ -52,107 +402,345 @@ void DataRequestsWidget::ChangePlot(int idx)
   m_Controls->Mutex.lock();
   if (m_Controls->CurrentPlot != -1)
   {
-    m_Controls->Plots[m_Controls->CurrentPlot]->GetView().setVisible(false);
     m_Controls->CurrentPlot = idx;
+    m_Controls->ShowPlot(m_Controls->CurrentPlot);
   }
   m_Controls->Mutex.unlock();
 }
 
+std::string DataRequestsWidget::GetTitle(const SEDataRequest& dr)
+{
+  std::string title;
+  std::string unit;
+  if (dr.HasUnit())
+    unit = " (" + dr.GetUnit()->GetString() + ")";
+  else
+    unit = "";
+  switch (dr.GetCategory())
+  {
+  case cdm::DataRequestData_eCategory_Patient:
+    title = "Patient " + dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_Physiology:
+    title = dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_Environment:
+    title = dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_GasCompartment:
+  case cdm::DataRequestData_eCategory_LiquidCompartment:
+    if (dr.HasSubstanceName())
+      title = dr.GetCompartmentName() + " " + dr.GetSubstanceName() + " " + dr.GetPropertyName() + unit;
+    else
+      title = dr.GetCompartmentName() + " " + dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_ThermalCompartment:
+    title = dr.GetCompartmentName() + " " + dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_TissueCompartment:
+    title = dr.GetCompartmentName() + " " + dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_Substance:
+    if (dr.HasCompartmentName())
+      title = dr.GetSubstanceName() + " " + dr.GetCompartmentName() + " " + dr.GetPropertyName() + unit;
+    else
+      title = dr.GetSubstanceName() + " " + dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_AnesthesiaMachine:
+    title = dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_ECG:
+    title = dr.GetPropertyName() + unit;
+    break;
+  case cdm::DataRequestData_eCategory_Inhaler:
+    title = dr.GetPropertyName() + unit;
+    break;
+  }
+  return title;
+}
+
 void DataRequestsWidget::BuildGraphs(PhysiologyEngine& pulse)
 {
   Reset();
   std::stringstream ss;
+  std::vector<std::string> titles;
   SEDataRequestManager& drMgr = pulse.GetEngineTracker()->GetDataRequestManager();
   std::string title;
-  std::string unit;
   for (SEDataRequest* dr : drMgr.GetDataRequests())
   {
-    if (dr->HasUnit())
-      unit = " (" + dr->GetUnit()->GetString() + ")";
-    else
-      unit = "";
-    switch (dr->GetCategory())
-    {
-    case cdm::DataRequestData_eCategory_Patient:
-      title = "Patient " + dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_Physiology:
-      title = dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_Environment:
-      title = dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_GasCompartment:
-    case cdm::DataRequestData_eCategory_LiquidCompartment:
-      if (dr->HasSubstanceName())
-        title = dr->GetCompartmentName() + " " + dr->GetSubstanceName() + " " + dr->GetPropertyName() + unit;
-      else
-        title = dr->GetCompartmentName() + " " + dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_ThermalCompartment:
-      title = dr->GetCompartmentName() + " " + dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_TissueCompartment:
-      title = dr->GetCompartmentName() + " " + dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_Substance:
-      if (dr->HasCompartmentName())
-        title = dr->GetSubstanceName() + " " + dr->GetCompartmentName() + " " + dr->GetPropertyName() + unit;
-      else
-        title = dr->GetSubstanceName() + " " + dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_AnesthesiaMachine:
-      title = dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_ECG:
-      title = dr->GetPropertyName() + unit;
-      break;
-    case cdm::DataRequestData_eCategory_Inhaler:
-      title = dr->GetPropertyName() + unit;
-      break;
-    }
+    title = GetTitle(*dr);
     if (!pulse.GetEngineTracker()->TrackRequest(*dr))
     {// Could not hook this up, get rid of it
       ss << "Unable to find data for " << title;
-      m_Controls->LogBox.append(ss.str().c_str());
+      m_Controls->LogBox.Append(ss.str().c_str(), LogSeverity::Warning);
       continue;
     }
-    QPulsePlot *p = new QPulsePlot(1000);
-    p->GetChart().setTitle(title.c_str());
-    m_Controls->DataGraphWidget->layout()->addWidget(&p->GetView());
-    m_Controls->Plots.push_back(p);
-    m_Controls->DataRequested->addItem(QString(title.c_str()));
+    m_Controls->AddPlot(title);
+    titles.push_back(title);
   }
+
+  m_Controls->SetTableColumns(titles);
+
+  // Keep everything we track, the plots only hold a window of it
+  QDir().mkpath("results");
+  QString exportFile = "results/DataRequests-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".pxc";
+  m_Controls->Values.resize(titles.size());
+  m_Controls->Stats.SetNumberOfSignals(titles.size());
+  m_Controls->ExportDropped = 0;
+  if (m_Controls->Exporter.Open(exportFile.toStdString(), titles))
+    m_Controls->LogBox.Append("Recording all data requests to " + exportFile);
+  else
+    m_Controls->LogBox.Append("Unable to record data requests to " + exportFile, LogSeverity::Warning);
+  // The whole session for the plots, older blocks of it spill to a temporary file
+  QString historyFile = QDir::tempPath() + "/PulseExplorer-History-" + QString::number(QCoreApplication::applicationPid()) + ".bin";
+  if (!m_Controls->History.Open(historyFile.toStdString(), titles.size()))
+    m_Controls->LogBox.Append("Unable to write " + historyFile + ", keeping the whole session history in memory", LogSeverity::Warning);
   
   m_Controls->CurrentPlot = 0;
   m_Controls->DataRequested->setCurrentIndex(0); 
-  m_Controls->Plots[0]->GetView().setVisible(true);
+  m_Controls->ShowPlot(0);
+}
+
+bool DataRequestsWidget::LoadResults(const QString& filename)
+{
+  Reset();
+  if (!m_Controls->Loader.Open(filename.toStdString()) || m_Controls->Loader.GetColumnNames().size() < 2)
+  {
+    m_Controls->LogBox.Append("Unable to read results from " + filename, LogSeverity::Warning);
+    return false;
+  }
+  const std::vector<std::string>& columns = m_Controls->Loader.GetColumnNames();
+  for (size_t c = 1; c < columns.size(); c++)
+    m_Controls->AddPlot(columns[c]);
+  m_Controls->SetTableColumns(std::vector<std::string>(columns.begin() + 1, columns.end()));
+  m_Controls->CurrentPlot = 0;
+  m_Controls->DataRequested->setCurrentIndex(0);
+  m_Controls->ShowPlot(0);
+
+  // Show the start of the file now, and parse the rest across all cores
+  std::vector<std::vector<double>> preview;
+  m_Controls->Loader.LoadPreview(preview);
+  m_Controls->SetPlotData(preview);
+  m_Controls->LogBox.Append("Loading results from " + filename);
+  m_Controls->LoadThread = std::thread([this]()
+  {
+    m_Controls->Loader.Load(m_Controls->LoadedColumns);
+    emit ResultsLoaded();
+  });
+  return true;
+}
+
+void DataRequestsWidget::FinishLoadingResults()
+{
+  if (m_Controls->LoadThread.joinable())
+    m_Controls->LoadThread.join();
+  if (m_Controls->LoadedColumns.empty())
+    return;
+  m_Controls->SetPlotData(m_Controls->LoadedColumns);
+  m_Controls->LogBox.Append("Loaded " + QString::number(m_Controls->LoadedColumns[0].size()) + " rows of results");
+  m_Controls->LoadedColumns.clear();
+  m_Controls->Loader.Close();
+}
+
+void DataRequestsWidget::SetPrediction(const PulsePrediction& p)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Prediction = p;
+  m_Controls->PredictionEnd_s = p.Times_s.empty() ? -1 : p.Times_s.back();
+  for (size_t i = 0; i < m_Controls->Plots.size(); i++)
+    m_Controls->ShowPrediction(i);
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::AddRuns()
+{
+  QStringList files = QFileDialog::getOpenFileNames(this, "Compare Runs", "./results", "Data Requests (*.pxc *.csv);;All Files (*)");
+  for (const QString& file : files)
+  {
+    std::vector<std::vector<double>> columns;
+    std::vector<std::string> names;
+    QString name = QFileInfo(file).completeBaseName();
+    if (!m_Controls->LoadRun(file, columns, names))
+    {
+      m_Controls->LogBox.Append("Unable to read run " + file, LogSeverity::Warning);
+      continue;
+    }
+    m_Controls->Mutex.lock();
+    size_t run = m_Controls->Runs.GetNumberOfRuns();
+    bool added = m_Controls->Runs.AddRun(name.toStdString(), columns, names);
+    m_Controls->Mutex.unlock();
+    if (added)
+      m_Controls->LogBox.Append("Comparing with " + name + ", drawn in " + RunColorNames[run % NumRunColors]);
+    else
+      m_Controls->LogBox.Append("No data to compare in " + file, LogSeverity::Warning);
+  }
+  m_Controls->Mutex.lock();
+  m_Controls->ShowPlot(m_Controls->CurrentPlot);
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::ClearRuns()
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Runs.Clear();
+  for (size_t i = 0; i < m_Controls->Plots.size(); i++)
+    m_Controls->ShowPrediction(i);
+  m_Controls->ShowPlot(m_Controls->CurrentPlot);
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::ToggleDifferences(bool b)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Differences = b;
+  m_Controls->ShowPlot(m_Controls->CurrentPlot);
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::ToggleWholeSession(bool b)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->WholeSession = b;
+  m_Controls->ShowPlot(m_Controls->CurrentPlot);
+  m_Controls->Mutex.unlock();
 }
 
 void DataRequestsWidget::ProcessPhysiology(PhysiologyEngine& pulse)
 {
-  // This is where we pull data from pulse, and push any actions to it
+  // The plots are only appended at the UI rate, with the values PulseStepped pulled this step
+  m_Controls->Mutex.lock();
+  bool append = ++m_Controls->PlotSkipped >= m_Controls->PlotDecimation;
+  if (append)
+  {
+    m_Controls->PlotSkipped = 0;
+    for (size_t i = 0; i < m_Controls->Plots.size() && i < m_Controls->Values.size(); i++)
+      m_Controls->Plots[i]->Append(m_Controls->SimTime_s, m_Controls->Values[i]);
+  }
+  m_Controls->Dirty |= append;
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::PulseStepped(PhysiologyEngine& pulse)
+{
+  // The export, statistics and session history get every step
   m_Controls->Mutex.lock();
   size_t i = 0;
-  QPulsePlot* plot;
   pulse.GetEngineTracker()->PullData();
   double  v;
   for (SEDataRequest* dr : pulse.GetEngineTracker()->GetDataRequestManager().GetDataRequests())
   {
-    plot = m_Controls->Plots[i++];
     if (dr->HasUnit())
      v=pulse.GetEngineTracker()->GetScalar(*dr)->GetValue(*dr->GetUnit());
     else
      v=pulse.GetEngineTracker()->GetScalar(*dr)->GetValue();
-    plot->Append(pulse.GetSimulationTime(TimeUnit::s),v);
+    m_Controls->Values[i++] = v;
   }
+  m_Controls->SimTime_s = pulse.GetSimulationTime(TimeUnit::s);
+  if (m_Controls->RunStart_s < 0)
+    m_Controls->RunStart_s = m_Controls->SimTime_s;
+  m_Controls->Exporter.Append(m_Controls->SimTime_s, m_Controls->Values.data());
+  m_Controls->Stats.Push(m_Controls->SimTime_s, m_Controls->Values.data());
+  m_Controls->History.Push(m_Controls->SimTime_s, m_Controls->Values.data());
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::PulseStateLoaded(PhysiologyEngine& pulse)
+{
+  m_Controls->Mutex.lock();
+  // Our requests point into the old state, hook them back up
+  pulse.GetEngineTracker()->ForceConnection();
+  for (SEDataRequest* dr : pulse.GetEngineTracker()->GetDataRequestManager().GetDataRequests())
+    pulse.GetEngineTracker()->TrackRequest(*dr);
+  for (QPulsePlot* plot : m_Controls->Plots)
+    plot->Clear();
+  m_Controls->Stats.Clear();
+  // Rewound, the history picks up from here
+  m_Controls->History.Truncate(pulse.GetSimulationTime(TimeUnit::s));
+  m_Controls->Dirty = true;
+  m_Controls->Mutex.unlock();
+}
+
+void DataRequestsWidget::PulseOverloadChanged(OverloadLevel level)
+{
+  // The export and statistics still get every sample
+  m_Controls->Mutex.lock();
+  m_Controls->PlotDecimation = level >= OverloadLevel::DecimatedCharts ? 2 : 1;
   m_Controls->Mutex.unlock();
 }
 
 void DataRequestsWidget::PulseUpdateUI()
 {
   m_Controls->Mutex.lock();
-  m_Controls->Plots[m_Controls->CurrentPlot]->UpdateUI();
+  if (m_Controls->PredictionEnd_s >= 0 && m_Controls->SimTime_s > m_Controls->PredictionEnd_s)
+  {// We have caught up with the prediction
+    m_Controls->PredictionEnd_s = -1;
+    m_Controls->Prediction = PulsePrediction();
+    for (QPulsePlot* plot : m_Controls->Plots)
+      plot->ClearGhosts();
+    m_Controls->Dirty = true;
+  }
+  if (m_Controls->TableSource != nullptr)
+    m_Controls->TableSource->Update(m_Controls->Plots);
+  size_t dropped = m_Controls->Exporter.GetNumberOfDroppedRows();
+  if (dropped > m_Controls->ExportDropped)
+  {
+    m_Controls->LogBox.Append("Recording the data requests is falling behind the disk, dropped " +
+                              QString::number(dropped - m_Controls->ExportDropped) + " rows (" + QString::number(dropped) + " in all)", LogSeverity::Warning);
+    m_Controls->ExportDropped = dropped;
+  }
+  m_Controls->Mutex.unlock();
+}
+
+size_t DataRequestsWidget::GetSampleMemoryUsed() const
+{
+  m_Controls->Mutex.lock();
+  size_t bytes = m_Controls->Stats.GetMemoryUsed() + m_Controls->Runs.GetMemoryUsed() + m_Controls->Reference.GetMemoryUsed();
+  for (const QPulsePlot* plot : m_Controls->Plots)
+    bytes += plot->GetMemoryUsed();
+  bytes += (m_Controls->Values.capacity() + m_Controls->GridTimes.capacity() +
+            m_Controls->Resampled.capacity() + m_Controls->ReferenceValues.capacity()) * sizeof(double);
+  m_Controls->Mutex.unlock();
+  return bytes;
+}
+
+size_t DataRequestsWidget::GetHistoryMemoryUsed() const
+{
+  m_Controls->Mutex.lock();
+  size_t bytes = m_Controls->History.GetMemoryUsed() + (m_Controls->SessionTimes.capacity() + m_Controls->SessionMins.capacity() +
+                 m_Controls->SessionMaxs.capacity() + m_Controls->SessionMeans.capacity() +
+                 m_Controls->SessionX.capacity() + m_Controls->SessionY.capacity()) * sizeof(double);
+  m_Controls->Mutex.unlock();
+  return bytes;
+}
+
+size_t DataRequestsWidget::GetChartMemoryUsed() const
+{
+  size_t bytes = 0;
+  for (const StripChartWidget* view : m_Controls->Views)
+    bytes += view->GetMemoryUsed();
+  if (m_Controls->DifferenceView != nullptr)
+    bytes += m_Controls->DifferenceView->GetMemoryUsed();
+  if (m_Controls->SessionView != nullptr)
+    bytes += m_Controls->SessionView->GetMemoryUsed();
+  return bytes;
+}
+
+bool DataRequestsWidget::NeedsRender() const
+{
+  if (!isVisible())
+    return false;
+  m_Controls->Mutex.lock();
+  bool dirty = m_Controls->Dirty;
+  m_Controls->Mutex.unlock();
+  return dirty;
+}
+
+void DataRequestsWidget::Render()
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Dirty = false;
+  m_Controls->ShowPlot(m_Controls->CurrentPlot);
+  m_Controls->ShowStatistics(m_Controls->CurrentPlot);
   m_Controls->Mutex.unlock();
 }
 
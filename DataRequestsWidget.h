@@ -5,6 +5,7 @@ See accompanying NOTICE file for details.*/
 #include <QObject>
 #include <QDockWidget>
 #include "QPulse.h"
+class SEDataRequest;
 
 namespace Ui {
   class DataRequestsWidget;
@@ -14,18 +15,43 @@ class DataRequestsWidget : public QDockWidget, public PulseListener
 {
   Q_OBJECT
 public:
-  DataRequestsWidget(QTextEdit& log, QWidget *parent = Q_NULLPTR, Qt::WindowFlags flags = Qt::WindowFlags());
+  DataRequestsWidget(LogWidget& log, QWidget *parent = Q_NULLPTR, Qt::WindowFlags flags = Qt::WindowFlags());
   virtual ~DataRequestsWidget();
 
   void Reset();
   void BuildGraphs(PhysiologyEngine& pulse);
+  // Plot the columns of a Pulse results csv file, the first rows show up before the whole file is parsed
+  bool LoadResults(const QString& filename);
+  // Overlay predicted traces on the graphs until the simulation catches up with them
+  void SetPrediction(const PulsePrediction& p);
   void ProcessPhysiology(PhysiologyEngine& pulse);
+  void PulseStepped(PhysiologyEngine& pulse);
+  void PulseStateLoaded(PhysiologyEngine& pulse);
+  void PulseOverloadChanged(OverloadLevel level);
 
   void PulseUpdateUI();// Main Window will call this to update UI Components
+  // For the render scheduler, new samples (or ghosts) to show
+  bool NeedsRender() const;
+  void Render();
+  // For the memory panel, in bytes
+  size_t GetSampleMemoryUsed() const;// Plots, statistics and compared runs
+  size_t GetHistoryMemoryUsed() const;// The resident part of the whole session history
+  size_t GetChartMemoryUsed() const;// Chart views
+
+  // The name we give a data request on its graph, results columns and alarm rules
+  static std::string GetTitle(const SEDataRequest& dr);
 
 signals:
+  void ResultsLoaded();
 protected slots:
   void ChangePlot(int);
+  void FinishLoadingResults();
+  // Overlay recorded runs of the same data requests, lined up on when each run started
+  void AddRuns();
+  void ClearRuns();
+  void ToggleDifferences(bool);
+  // Chart everything since the graphs were built instead of the latest samples
+  void ToggleWholeSession(bool);
 
 private:
   class Controls;
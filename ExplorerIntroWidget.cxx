@@ -29,12 +29,18 @@ ExplorerIntroWidget::ExplorerIntroWidget(QWidget *parent, Qt::WindowFlags flags)
   m_Controls->PatientStateComboBox->setCurrentIndex(idx);
 
   m_Controls->LoadPatientState->setEnabled(false);
-  m_Controls->CreatePatientButton->setEnabled(false);
-  m_Controls->LoadScenarioButton->setEnabled(false);
 
   connect(this,SIGNAL(dataChanged()), this, SLOT(updateUI()));
   connect(m_Controls->LoadShowcase, SIGNAL(clicked()), this,SLOT(ReadSelectedShowcase()));
   connect(this, SIGNAL(StartSelectedShowcase()), parentWidget(), SLOT(StartShowcase()));
+  connect(m_Controls->RunSweepButton, SIGNAL(clicked()), this, SIGNAL(RunParameterSweep()));
+  connect(this, SIGNAL(RunParameterSweep()), parentWidget(), SLOT(RunSweep()));
+  connect(m_Controls->LoadResultsButton, SIGNAL(clicked()), this, SIGNAL(LoadResults()));
+  connect(this, SIGNAL(LoadResults()), parentWidget(), SLOT(LoadResults()));
+  connect(m_Controls->LoadScenarioButton, SIGNAL(clicked()), this, SIGNAL(LoadScenario()));
+  connect(this, SIGNAL(LoadScenario()), parentWidget(), SLOT(LoadScenario()));
+  connect(m_Controls->CreatePatientButton, SIGNAL(clicked()), this, SIGNAL(CreatePatient()));
+  connect(this, SIGNAL(CreatePatient()), parentWidget(), SLOT(CreatePatient()));
 }
 
 ExplorerIntroWidget::~ExplorerIntroWidget()
@@ -58,3 +64,13 @@ QString ExplorerIntroWidget::GetShowcase()
 {
   return m_Controls->Showcase;
 }
+
+void ExplorerIntroWidget::SetSweepRunning(bool b)
+{
+  m_Controls->RunSweepButton->setText(b ? "Stop Parameter Sweep" : "Run Parameter Sweep");
+}
+
+void ExplorerIntroWidget::SetStabilizing(bool b)
+{
+  m_Controls->CreatePatientButton->setText(b ? "Cancel New Patient" : "New Patient");
+}
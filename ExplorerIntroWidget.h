@@ -17,9 +17,15 @@ public:
   virtual ~ExplorerIntroWidget();
 
   QString GetShowcase();
+  void SetSweepRunning(bool b);
+  void SetStabilizing(bool b);
 
 signals:
   void StartSelectedShowcase();
+  void RunParameterSweep();
+  void LoadResults();
+  void LoadScenario();
+  void CreatePatient();
 protected slots:
   void UpdateUI();
   void ReadSelectedShowcase();
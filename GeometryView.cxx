@@ -1,6 +1,8 @@
 #include "GeometryView.h"
 
 #include <QColor>
+#include <QEvent>
+#include <QFileInfo>
 #include <QList>
 #include <QVariant>
 #include <QString>
@@ -12,14 +14,27 @@
 
 #include <pqApplicationCore.h>
 #include <pqObjectBuilder.h>
+#include <pqOutputPort.h>
 #include <pqSMAdaptor.h>
 #include <pqRenderView.h>
+#include <pqServer.h>
 #include <pqView.h>
 
 #include <vtkSMProxy.h>
 #include <vtkSMProperty.h>
 #include <vtkSMPropertyHelper.h>
 #include <vtkSMPVRepresentationProxy.h>
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPVDataInformation.h>
+#include <vtkPVTrivialProducer.h>
+#include <vtkSmartPointer.h>
+
+#include "AnatomyAsset.h"
 
 #include "cdm/CommonDataModel.h"
 #include "PulsePhysiologyEngine.h"
@@ -30,12 +45,18 @@ class GeometryView::Data
 public:
   double SpO2;
   bool   RenderSpO2;
+  bool   Paused = false;// The engine cannot keep up, leave the view as is
+  QColor Color;// Of the lungs, as last set
+  bool   Changed = false;
+  bool   Interacting = false;
   QMutex Mutex;
 };
 
 GeometryView::GeometryView(pqRenderView* view, QObject* parentObject) : m_View(view)
 {
   m_Data = new GeometryView::Data();
+  if (m_View != nullptr)
+    m_View->widget()->installEventFilter(this);
 }
 
 GeometryView::~GeometryView()
@@ -60,11 +81,73 @@ pqPipelineSource* loadDataFile(const QString & filePath)
   return source;
 }
 
-void GeometryView::LoadGeometry()
+// Decode a prebuilt anatomy asset straight into the arrays of a client side source
+pqPipelineSource* loadAssetFile(const QString& filePath, pqServer* server)
+{
+  AnatomyAsset asset;
+  if (!asset.Open(filePath.toStdString()))
+    return nullptr;
+  vtkIdType numPoints = vtkIdType(asset.GetNumberOfPoints());
+  vtkIdType numTriangles = vtkIdType(asset.GetNumberOfTriangles());
+
+  vtkSmartPointer<vtkFloatArray> positions = vtkSmartPointer<vtkFloatArray>::New();
+  positions->SetNumberOfComponents(3);
+  positions->SetNumberOfTuples(numPoints);
+  asset.ReadPoints(positions->GetPointer(0));
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetData(positions);
+
+  vtkSmartPointer<vtkFloatArray> normals = vtkSmartPointer<vtkFloatArray>::New();
+  normals->SetName("Normals");
+  normals->SetNumberOfComponents(3);
+  normals->SetNumberOfTuples(numPoints);
+  asset.ReadNormals(normals->GetPointer(0));
+
+  vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+  cells->SetNumberOfValues(4 * numTriangles);
+  asset.ReadCells(cells->GetPointer(0));
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  polys->SetCells(numTriangles, cells);
+  asset.Close();
+
+  vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points);
+  mesh->SetPolys(polys);
+  mesh->GetPointData()->SetNormals(normals);
+
+  pqObjectBuilder* builder = pqApplicationCore::instance()->getObjectBuilder();
+  pqPipelineSource* source = builder->createSource("sources", "PVTrivialProducer", server);
+  if (source == nullptr)
+    return nullptr;
+  vtkPVTrivialProducer* producer = vtkPVTrivialProducer::SafeDownCast(source->getProxy()->GetClientSideObject());
+  if (producer == nullptr)
+  {
+    builder->destroy(source);
+    return nullptr;
+  }
+  source->rename(QFileInfo(filePath).fileName());
+  producer->SetOutput(mesh);
+  return source;
+}
+
+pqPipelineSource* GeometryView::LoadMesh(const QString& data_dir, const QString& name)
+{
+  // The asset is decoded on the client, a remote server has to read the vtp itself
+  QString asset = data_dir + "/" + name + ".pxa";
+  if (!m_View->getServer()->isRemote() && QFileInfo(asset).exists())
+  {
+    pqPipelineSource* source = loadAssetFile(asset, m_View->getServer());
+    if (source != nullptr)
+      return source;
+  }
+  return loadDataFile(data_dir + "/" + name + ".vtp");
+}
+
+void GeometryView::LoadGeometry(const QString& data_dir)
 {
   vtkSMProxy* renderProxy = m_View->getProxy();
   // Read in lungs
-  this->m_DataSources.push_back(loadDataFile("data/lungs.vtp"));
+  this->m_DataSources.push_back(LoadMesh(data_dir, "lungs"));
   this->m_DataRepresentations.push_back(pqApplicationCore::instance()->getObjectBuilder()->createDataRepresentation(m_DataSources[0]->getOutputPort(0), m_View));
 
   vtkSMProxy* lungProxy = m_DataRepresentations[0]->getProxy();
@@ -90,14 +173,14 @@ void GeometryView::LoadGeometry()
   lungProxy->UpdateProperty("DiffuseColor");
 
   // Read in trachea/bronchus
-  this->m_DataSources.push_back(loadDataFile("data/trachea.vtp"));
+  this->m_DataSources.push_back(LoadMesh(data_dir, "trachea"));
   this->m_DataRepresentations.push_back(pqApplicationCore::instance()->getObjectBuilder()->createDataRepresentation(m_DataSources[1]->getOutputPort(0), m_View));
 
-  this->m_DataSources.push_back(loadDataFile("data/bronchus.vtp"));
+  this->m_DataSources.push_back(LoadMesh(data_dir, "bronchus"));
   this->m_DataRepresentations.push_back(pqApplicationCore::instance()->getObjectBuilder()->createDataRepresentation(m_DataSources[2]->getOutputPort(0), m_View));
 
   // Read in skin
-  this->m_DataSources.push_back(loadDataFile("data/skin.vtp"));
+  this->m_DataSources.push_back(LoadMesh(data_dir, "skin"));
   this->m_DataRepresentations.push_back(pqApplicationCore::instance()->getObjectBuilder()->createDataRepresentation(m_DataSources[3]->getOutputPort(0), m_View));
 
   vtkSMProxy* skinProxy = m_DataRepresentations[3]->getProxy();
@@ -119,6 +202,9 @@ void GeometryView::LoadGeometry()
   m_View->resetCenterOfRotation();
 
   renderProxy->UpdateVTKObjects();
+  m_Data->Mutex.lock();
+  m_Data->Changed = true;
+  m_Data->Mutex.unlock();
 }
 
 void GeometryView::ProcessPhysiology(PhysiologyEngine& pulse)
@@ -138,10 +224,17 @@ void GeometryView::RenderSpO2(bool b)
   m_Data->Mutex.unlock();
 }
 
+void GeometryView::PulseOverloadChanged(OverloadLevel level)
+{
+  m_Data->Mutex.lock();
+  m_Data->Paused = level >= OverloadLevel::Paused3D;
+  m_Data->Mutex.unlock();
+}
+
 void GeometryView::PulseUpdateUI()
 {
   m_Data->Mutex.lock();
-  if (m_Data->RenderSpO2)
+  if (m_Data->RenderSpO2 && !m_Data->Paused)
   {
     QColor color;
     if (m_Data->SpO2 >= 0.95)
@@ -162,6 +255,13 @@ void GeometryView::PulseUpdateUI()
 
       color = QColor(r, g, b);
     }
+    if (color == m_Data->Color)
+    {// Nothing to draw
+      m_Data->Mutex.unlock();
+      return;
+    }
+    m_Data->Color = color;
+    m_Data->Changed = true;
 
     vtkSMProxy* proxy = m_DataRepresentations[0]->getProxy();
     vtkSMProperty* diffuse = proxy->GetProperty("DiffuseColor");
@@ -178,3 +278,54 @@ void GeometryView::PulseUpdateUI()
   m_Data->Mutex.unlock();
 }
 
+bool GeometryView::NeedsRender() const
+{
+  m_Data->Mutex.lock();
+  bool changed = m_Data->Changed;
+  m_Data->Mutex.unlock();
+  // Anything else shown in the view (i.e. filters on the physiology table) may change every refresh
+  return changed || (m_View != nullptr && m_View->getNumberOfVisibleRepresentations() > m_DataRepresentations.size());
+}
+
+void GeometryView::Render()
+{
+  if (m_View != nullptr)
+    m_View->forceRender();
+  m_Data->Mutex.lock();
+  m_Data->Changed = false;
+  m_Data->Mutex.unlock();
+}
+
+bool GeometryView::IsInteracting() const
+{
+  return m_Data->Interacting;
+}
+
+size_t GeometryView::GetMemoryUsed() const
+{
+  size_t bytes = 0;
+  for (pqPipelineSource* source : m_DataSources)
+  {
+    vtkPVDataInformation* info = source != nullptr ? source->getOutputPort(0)->getDataInformation() : nullptr;
+    if (info != nullptr)
+      bytes += size_t(info->GetMemorySize()) * 1024;// Reported in KiB
+  }
+  return bytes;
+}
+
+bool GeometryView::eventFilter(QObject* obj, QEvent* event)
+{
+  switch (event->type())
+  {
+  case QEvent::MouseButtonPress:
+    m_Data->Interacting = true;
+    break;
+  case QEvent::MouseButtonRelease:
+  case QEvent::Leave:
+    m_Data->Interacting = false;
+    break;
+  default:
+    break;
+  }
+  return QObject::eventFilter(obj, event);
+}
@@ -23,14 +23,29 @@ public:
 
   void Reset();
 
-  void LoadGeometry();
+  // data_dir is where the server (that the view is on) can find the anatomy meshes
+  // With the builtin server the prebuilt .pxa assets are used when they are there, otherwise the .vtp files are read
+  void LoadGeometry(const QString& data_dir="data");
   void RenderSpO2(bool b);
 
   void ProcessPhysiology(PhysiologyEngine& pulse);
   void PulseUpdateUI();
+  void PulseOverloadChanged(OverloadLevel level);
+
+  // For the render scheduler, the scene changed since it was last drawn
+  bool NeedsRender() const;
+  void Render();
+  // A mouse button is down on the view, the interactor is drawing it
+  bool IsInteracting() const;
+  // Bytes in the VTK arrays of the anatomy, as the server reports them
+  size_t GetMemoryUsed() const;
+
+  bool eventFilter(QObject* obj, QEvent* event);
 
 
 protected:
+  pqPipelineSource* LoadMesh(const QString& data_dir, const QString& name);
+
   class Data;
   Data* m_Data;
   
@@ -0,0 +1,268 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "HeatmapWidget.h"
+
+#include <QOpenGLShaderProgram>
+#include <QFontMetrics>
+#include <QLinearGradient>
+#include <QMouseEvent>
+#include <QPainter>
+#include <algorithm>
+
+static const char* VertexShader =
+  "attribute vec2 position;\n"
+  "varying vec2 v_coord;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_Position = vec4(position, 0.0, 1.0);\n"
+  "  v_coord = vec2(0.5 + 0.5 * position.x, 0.5 - 0.5 * position.y);\n"// The first row is at the top
+  "}\n";
+
+static const char* FragmentShader =
+  "#ifdef GL_ES\n"
+  "precision mediump float;\n"
+  "#endif\n"
+  "uniform sampler2D cells;\n"
+  "varying vec2 v_coord;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = texture2D(cells, v_coord);\n"
+  "}\n";
+
+static const GLfloat Quad[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+
+class HeatmapWidget::Data
+{
+public:
+  size_t                     Rows = 0;
+  size_t                     Columns = 0;
+  std::vector<unsigned char> Pixels;// RGBA, row by row
+  QString                    Title;
+  QStringList                RowNames;
+  QString                    LowLabel;
+  QString                    HighLabel;
+  QColor                     LowColor = Qt::blue;
+  QColor                     MiddleColor = Qt::white;
+  QColor                     HighColor = Qt::red;
+  QRectF                     Cells;// Where the cells were last drawn
+  int                        HoverRow = -1;
+  int                        HoverColumn = -1;
+
+  // What is on the GPU
+  QOpenGLShaderProgram*      Program = nullptr;
+  GLuint                     Texture = 0;
+  size_t                     TextureRows = 0;
+  size_t                     TextureColumns = 0;
+  bool                       Upload = true;
+};
+
+HeatmapWidget::HeatmapWidget(QWidget *parent) : QOpenGLWidget(parent)
+{
+  m_Data = new HeatmapWidget::Data();
+  setMouseTracking(true);
+}
+
+HeatmapWidget::~HeatmapWidget()
+{
+  if (m_Data->Program != nullptr)
+  {
+    makeCurrent();
+    glDeleteTextures(1, &m_Data->Texture);
+    delete m_Data->Program;
+    doneCurrent();
+  }
+  delete m_Data;
+}
+
+void HeatmapWidget::SetTitle(const QString& title)
+{
+  m_Data->Title = title;
+  update();
+}
+
+void HeatmapWidget::SetRowNames(const QStringList& names)
+{
+  m_Data->RowNames = names;
+  update();
+}
+
+void HeatmapWidget::SetLegend(const QString& low, const QString& high, const QColor& low_color, const QColor& middle_color, const QColor& high_color)
+{
+  m_Data->LowLabel = low;
+  m_Data->HighLabel = high;
+  m_Data->LowColor = low_color;
+  m_Data->MiddleColor = middle_color;
+  m_Data->HighColor = high_color;
+  update();
+}
+
+void HeatmapWidget::SetSize(size_t rows, size_t columns)
+{
+  if (rows == m_Data->Rows && columns == m_Data->Columns)
+    return;
+  m_Data->Rows = rows;
+  m_Data->Columns = columns;
+  m_Data->Pixels.assign(4 * rows * columns, 0);
+  m_Data->HoverRow = m_Data->HoverColumn = -1;
+  m_Data->Upload = true;
+  update();
+}
+
+size_t HeatmapWidget::GetNumberOfRows() const
+{
+  return m_Data->Rows;
+}
+
+size_t HeatmapWidget::GetNumberOfColumns() const
+{
+  return m_Data->Columns;
+}
+
+void HeatmapWidget::SetColors(const std::vector<QRgb>& colors)
+{
+  size_t n = std::min(colors.size(), m_Data->Rows * m_Data->Columns);
+  unsigned char* p = m_Data->Pixels.data();
+  for (size_t i = 0; i < n; i++, p += 4)
+  {
+    p[0] = (unsigned char)qRed(colors[i]);
+    p[1] = (unsigned char)qGreen(colors[i]);
+    p[2] = (unsigned char)qBlue(colors[i]);
+    p[3] = 255;
+  }
+  m_Data->Upload = true;
+  update();
+}
+
+void HeatmapWidget::initializeGL()
+{
+  initializeOpenGLFunctions();
+  // We can get a new context (i.e. when reparented), start over
+  delete m_Data->Program;
+  m_Data->Program = new QOpenGLShaderProgram();
+  m_Data->Program->addShaderFromSourceCode(QOpenGLShader::Vertex, VertexShader);
+  m_Data->Program->addShaderFromSourceCode(QOpenGLShader::Fragment, FragmentShader);
+  m_Data->Program->bindAttributeLocation("position", 0);
+  m_Data->Program->link();
+  glGenTextures(1, &m_Data->Texture);
+  glBindTexture(GL_TEXTURE_2D, m_Data->Texture);
+  // One texel per cell, with hard edges between them
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  m_Data->TextureRows = 0;
+  m_Data->TextureColumns = 0;
+  m_Data->Upload = true;
+}
+
+void HeatmapWidget::paintGL()
+{
+  Data& d = *m_Data;
+  QPainter painter(this);
+  painter.fillRect(rect(), Qt::white);
+
+  QFont font = painter.font();
+  font.setPointSize(9);
+  painter.setFont(font);
+  QFontMetrics metrics(font);
+  int labels = 0;
+  for (const QString& name : d.RowNames)
+    labels = std::max(labels, metrics.width(name));
+  d.Cells = QRectF(rect()).adjusted(labels + 12, metrics.height() * 2 + 4, -15, -metrics.height() * 2 - 12);
+
+  painter.setPen(Qt::black);
+  QFont titleFont = font;
+  titleFont.setBold(true);
+  titleFont.setPointSize(11);
+  painter.setFont(titleFont);
+  painter.drawText(QRectF(0, 4, width(), metrics.height() * 2), Qt::AlignHCenter | Qt::AlignVCenter, d.Title);
+  painter.setFont(font);
+  if (d.Rows == 0 || d.Columns == 0 || d.Cells.width() < 1 || d.Cells.height() < 1)
+    return;
+
+  double rowHeight = d.Cells.height() / d.Rows;
+  double columnWidth = d.Cells.width() / d.Columns;
+  painter.setPen(Qt::darkGray);
+  for (int r = 0; r < d.RowNames.size() && r < int(d.Rows); r++)
+    painter.drawText(QRectF(0, d.Cells.top() + r * rowHeight, d.Cells.left() - 6, rowHeight), Qt::AlignRight | Qt::AlignVCenter, d.RowNames[r]);
+
+  // The color scale under the cells
+  QRectF legend(d.Cells.left() + d.Cells.width() / 4, d.Cells.bottom() + 8, d.Cells.width() / 2, metrics.height());
+  QLinearGradient gradient(legend.topLeft(), legend.topRight());
+  gradient.setColorAt(0, d.LowColor);
+  gradient.setColorAt(0.5, d.MiddleColor);
+  gradient.setColorAt(1, d.HighColor);
+  painter.fillRect(legend, gradient);
+  painter.drawRect(legend);
+  painter.drawText(QRectF(0, legend.top(), legend.left() - 6, legend.height()), Qt::AlignRight | Qt::AlignVCenter, d.LowLabel);
+  painter.drawText(QRectF(legend.right() + 6, legend.top(), width(), legend.height()), Qt::AlignLeft | Qt::AlignVCenter, d.HighLabel);
+
+  painter.beginNativePainting();
+  qreal dpr = devicePixelRatioF();
+  glViewport(GLint(d.Cells.left() * dpr), GLint((height() - d.Cells.bottom()) * dpr), GLsizei(d.Cells.width() * dpr), GLsizei(d.Cells.height() * dpr));
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, d.Texture);
+  if (d.Upload)
+  {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (d.Rows != d.TextureRows || d.Columns != d.TextureColumns)
+    {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, GLsizei(d.Columns), GLsizei(d.Rows), 0, GL_RGBA, GL_UNSIGNED_BYTE, d.Pixels.data());
+      d.TextureRows = d.Rows;
+      d.TextureColumns = d.Columns;
+    }
+    else
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GLsizei(d.Columns), GLsizei(d.Rows), GL_RGBA, GL_UNSIGNED_BYTE, d.Pixels.data());
+    d.Upload = false;
+  }
+  d.Program->bind();
+  d.Program->setUniformValue("cells", 0);
+  d.Program->enableAttributeArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, Quad);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  d.Program->disableAttributeArray(0);
+  d.Program->release();
+  glBindTexture(GL_TEXTURE_2D, 0);
+  painter.endNativePainting();
+
+  painter.setPen(QColor(120, 120, 120));
+  painter.drawRect(d.Cells);
+  if (d.HoverRow >= 0)
+  {
+    painter.setPen(QPen(Qt::black, 2));
+    painter.drawRect(QRectF(d.Cells.left() + d.HoverColumn * columnWidth, d.Cells.top() + d.HoverRow * rowHeight, columnWidth, rowHeight));
+  }
+}
+
+void HeatmapWidget::mouseMoveEvent(QMouseEvent* event)
+{
+  Data& d = *m_Data;
+  int row = -1;
+  int column = -1;
+  if (d.Rows > 0 && d.Columns > 0 && d.Cells.contains(event->pos()))
+  {
+    row = std::min(int(d.Rows) - 1, int((event->pos().y() - d.Cells.top()) / d.Cells.height() * d.Rows));
+    column = std::min(int(d.Columns) - 1, int((event->pos().x() - d.Cells.left()) / d.Cells.width() * d.Columns));
+  }
+  if (row != d.HoverRow || column != d.HoverColumn)
+  {
+    d.HoverRow = row;
+    d.HoverColumn = column;
+    update();
+    emit CellHovered(row, column);
+  }
+  QOpenGLWidget::mouseMoveEvent(event);
+}
+
+void HeatmapWidget::leaveEvent(QEvent* event)
+{
+  if (m_Data->HoverRow >= 0)
+  {
+    m_Data->HoverRow = m_Data->HoverColumn = -1;
+    update();
+    emit CellHovered(-1, -1);
+  }
+  QOpenGLWidget::leaveEvent(event);
+}
@@ -0,0 +1,44 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QStringList>
+#include <vector>
+
+// A matrix of colored cells drawn with plain OpenGL (2.0 / GLSL 1.10, like the strip charts).
+// Each cell is one texel of a texture that lives as long as the widget, so recoloring every cell is
+// a single texture upload and one quad, however many cells there are.
+// The title, row labels and legend are painted over it with QPainter, hovering a cell emits CellHovered.
+class HeatmapWidget : public QOpenGLWidget, protected QOpenGLFunctions
+{
+  Q_OBJECT
+public:
+  HeatmapWidget(QWidget *parent = Q_NULLPTR);
+  virtual ~HeatmapWidget();
+
+  void SetTitle(const QString& title);
+  void SetRowNames(const QStringList& names);
+  // Labels at either end of the color scale
+  void SetLegend(const QString& low, const QString& high, const QColor& low_color, const QColor& middle_color, const QColor& high_color);
+
+  void SetSize(size_t rows, size_t columns);
+  size_t GetNumberOfRows() const;
+  size_t GetNumberOfColumns() const;
+  // A color per cell, row by row
+  void SetColors(const std::vector<QRgb>& colors);
+
+signals:
+  void CellHovered(int row, int column);// -1, -1 when the mouse leaves the cells
+
+protected:
+  void initializeGL() override;
+  void paintGL() override;
+  void mouseMoveEvent(QMouseEvent* event) override;
+  void leaveEvent(QEvent* event) override;
+
+private:
+  class Data;
+  Data* m_Data;
+};
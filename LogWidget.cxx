@@ -0,0 +1,428 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "LogWidget.h"
+
+#include <QAbstractListModel>
+#include <QBrush>
+#include <QCheckBox>
+#include <QDateTime>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QMutex>
+#include <QScrollBar>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+struct LogRecord
+{
+  qint64      Time_ms;
+  LogSeverity Severity;
+  QString     Origin;
+  QString     Message;
+};
+
+static const int NumSeverities = 5;
+// Roughly what a posting list costs before it holds anything, deques allocate in blocks
+static const size_t PostingListBytes = sizeof(std::deque<quint64>) + 512;
+
+static size_t TextBytes(const LogRecord& r)
+{
+  return size_t(r.Message.capacity() + r.Origin.capacity()) * sizeof(QChar);
+}
+
+// Three characters of a lower cased message packed into one key
+static void Trigrams(const QString& lower, std::vector<quint64>& keys)
+{
+  keys.clear();
+  for (int i = 0; i + 2 < lower.size(); i++)
+    keys.push_back((quint64(lower[i].unicode()) << 32) | (quint64(lower[i + 1].unicode()) << 16) | quint64(lower[i + 2].unicode()));
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+// Records are numbered in the order they arrive, record n lives in Ring[n % capacity]
+// Rows holds the numbers of the records that pass the filter, in order
+class LogModel : public QAbstractListModel
+{
+public:
+  LogModel(size_t capacity)
+  {
+    for (int s = 0; s < NumSeverities; s++)
+      Show[s] = true;
+    SetCapacity(capacity);
+  }
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override
+  {
+    return parent.isValid() ? 0 : int(Rows.size());
+  }
+
+  QVariant data(const QModelIndex& index, int role) const override
+  {
+    if (!index.isValid() || size_t(index.row()) >= Rows.size())
+      return QVariant();
+    const LogRecord& r = Record(Rows[index.row()]);
+    switch (role)
+    {
+    case Qt::DisplayRole:
+      return QDateTime::fromMSecsSinceEpoch(r.Time_ms).toString("hh:mm:ss  ") + r.Message;
+    case Qt::ToolTipRole:
+      return r.Origin.isEmpty() ? QVariant() : QVariant(r.Origin);
+    case Qt::ForegroundRole:
+      if (r.Severity == LogSeverity::Warning)
+        return QBrush(QColor(200, 120, 0));
+      if (r.Severity >= LogSeverity::Error)
+        return QBrush(Qt::red);
+      if (r.Severity == LogSeverity::Debug)
+        return QBrush(Qt::gray);
+      return QVariant();
+    }
+    return QVariant();
+  }
+
+  const LogRecord& Record(quint64 n) const { return Ring[n % Ring.size()]; }
+
+  void SetCapacity(size_t capacity)
+  {
+    beginResetModel();
+    Ring.clear();
+    Ring.resize(std::max(size_t(1), capacity));
+    Rows.clear();
+    Index.clear();
+    RecordBytes = 0;
+    Postings = 0;
+    First = Next;
+    endResetModel();
+  }
+
+  void Clear()
+  {
+    SetCapacity(Ring.size());
+  }
+
+  void Add(std::vector<LogRecord>& batch)
+  {
+    size_t capacity = Ring.size();
+    // Anything past a full ring would be dropped right away
+    size_t skip = batch.size() > capacity ? batch.size() - capacity : 0;
+    size_t incoming = batch.size() - skip;
+    size_t count = size_t(Next - First);
+    if (count + incoming > capacity)
+    {
+      quint64 evict = count + incoming - capacity;
+      for (quint64 n = First; n < First + evict; n++)
+        Unindex(n);
+      First += evict;
+      size_t gone = 0;
+      while (gone < Rows.size() && Rows[gone] < First)
+        gone++;
+      if (gone > 0)
+      {
+        beginRemoveRows(QModelIndex(), 0, int(gone - 1));
+        Rows.erase(Rows.begin(), Rows.begin() + gone);
+        endRemoveRows();
+      }
+    }
+
+    std::vector<quint64> matched;
+    for (size_t i = skip; i < batch.size(); i++)
+    {
+      RecordBytes -= TextBytes(Ring[Next % capacity]);
+      Ring[Next % capacity] = std::move(batch[i]);
+      RecordBytes += TextBytes(Ring[Next % capacity]);
+      AddToIndex(Next);
+      if (Matches(Next))
+        matched.push_back(Next);
+      Next++;
+    }
+    if (!matched.empty())
+    {
+      beginInsertRows(QModelIndex(), int(Rows.size()), int(Rows.size() + matched.size() - 1));
+      Rows.insert(Rows.end(), matched.begin(), matched.end());
+      endInsertRows();
+    }
+  }
+
+  // Rebuild the matching rows, candidates come from the shortest posting list of the query
+  void Filter()
+  {
+    beginResetModel();
+    Rows.clear();
+    if (Query.size() >= 3)
+    {
+      Trigrams(Query, Keys);
+      const std::deque<quint64>* shortest = nullptr;
+      for (quint64 key : Keys)
+      {
+        auto itr = Index.find(key);
+        if (itr == Index.end())
+        {// No record has this trigram
+          shortest = nullptr;
+          break;
+        }
+        if (shortest == nullptr || itr->second.size() < shortest->size())
+          shortest = &itr->second;
+      }
+      if (shortest != nullptr)
+      {
+        for (quint64 n : *shortest)
+          if (Matches(n))
+            Rows.push_back(n);
+      }
+    }
+    else
+    {
+      for (quint64 n = First; n < Next; n++)
+        if (Matches(n))
+          Rows.push_back(n);
+    }
+    endResetModel();
+  }
+
+  bool Matches(quint64 n) const
+  {
+    const LogRecord& r = Record(n);
+    if (!Show[int(r.Severity)])
+      return false;
+    return Query.isEmpty() || r.Message.contains(Query, Qt::CaseInsensitive);
+  }
+
+  size_t GetCapacity() const { return Ring.size(); }
+  size_t GetNumberOfRecords() const { return size_t(Next - First); }
+  size_t GetMemoryUsed() const
+  {
+    return Ring.capacity() * sizeof(LogRecord) + RecordBytes + (Rows.size() + Postings) * sizeof(quint64) + Index.size() * PostingListBytes;
+  }
+
+  QString                Query;// Lower case
+  bool                   Show[NumSeverities];
+
+protected:
+  void AddToIndex(quint64 n)
+  {
+    Trigrams(Record(n).Message.toLower(), Keys);
+    for (quint64 key : Keys)
+      Index[key].push_back(n);
+    Postings += Keys.size();
+  }
+  // Records leave in the order they came in, so they are always at the front of their posting lists
+  void Unindex(quint64 n)
+  {
+    Trigrams(Record(n).Message.toLower(), Keys);
+    for (quint64 key : Keys)
+    {
+      auto itr = Index.find(key);
+      if (itr == Index.end())
+        continue;
+      if (!itr->second.empty() && itr->second.front() == n)
+      {
+        itr->second.pop_front();
+        Postings--;
+      }
+      if (itr->second.empty())
+        Index.erase(itr);
+    }
+  }
+
+  std::vector<LogRecord>                          Ring;
+  quint64                                         First = 0;// Oldest record still in the ring
+  quint64                                         Next = 0; // Number the next record will get
+  std::deque<quint64>                             Rows;
+  std::unordered_map<quint64, std::deque<quint64>> Index;
+  std::vector<quint64>                            Keys;// Scratch
+  size_t                                          RecordBytes = 0;// Text of the records in the ring
+  size_t                                          Postings = 0;// Entries in the index
+};
+
+class LogWidget::Controls
+{
+public:
+  Controls() : Model(10000) {}
+
+  LogModel               Model;
+  QListView*             View;
+  QLineEdit*             Search;
+  QCheckBox*             ShowDebug;
+  QCheckBox*             ShowInfo;
+  QCheckBox*             ShowWarning;
+  QCheckBox*             ShowError;
+  QLabel*                Count;
+  QTimer                 Timer;
+
+  QMutex                 Mutex;
+  std::vector<LogRecord> Pending;
+  bool                   ScrollRequested = false;
+  bool                   ClearRequested = false;
+
+  void UpdateCount()
+  {
+    Count->setText(QString::number(Model.rowCount()) + "/" + QString::number(Model.GetNumberOfRecords()));
+  }
+};
+
+LogWidget::LogWidget(QWidget *parent) : QWidget(parent)
+{
+  m_Controls = new Controls();
+
+  m_Controls->View = new QListView(this);
+  m_Controls->View->setModel(&m_Controls->Model);
+  m_Controls->View->setUniformItemSizes(true);
+  m_Controls->View->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  m_Controls->View->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  m_Controls->View->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+  QFont font = m_Controls->View->font();
+  font.setPointSize(10);
+  m_Controls->View->setFont(font);
+
+  m_Controls->Search = new QLineEdit(this);
+  m_Controls->Search->setPlaceholderText("Search log");
+  m_Controls->Search->setClearButtonEnabled(true);
+  m_Controls->ShowDebug = new QCheckBox("Debug", this);
+  m_Controls->ShowInfo = new QCheckBox("Info", this);
+  m_Controls->ShowWarning = new QCheckBox("Warning", this);
+  m_Controls->ShowError = new QCheckBox("Error", this);
+  m_Controls->Count = new QLabel(this);
+  m_Controls->ShowDebug->setChecked(true);
+  m_Controls->ShowInfo->setChecked(true);
+  m_Controls->ShowWarning->setChecked(true);
+  m_Controls->ShowError->setChecked(true);
+
+  QHBoxLayout* filters = new QHBoxLayout();
+  filters->setContentsMargins(0, 0, 0, 0);
+  filters->addWidget(m_Controls->Search, 1);
+  filters->addWidget(m_Controls->ShowDebug);
+  filters->addWidget(m_Controls->ShowInfo);
+  filters->addWidget(m_Controls->ShowWarning);
+  filters->addWidget(m_Controls->ShowError);
+  filters->addWidget(m_Controls->Count);
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->setSpacing(2);
+  layout->addLayout(filters);
+  layout->addWidget(m_Controls->View, 1);
+
+  connect(m_Controls->Search, SIGNAL(textChanged(const QString&)), SLOT(SearchChanged(const QString&)));
+  connect(m_Controls->ShowDebug, SIGNAL(toggled(bool)), SLOT(SeverityToggled()));
+  connect(m_Controls->ShowInfo, SIGNAL(toggled(bool)), SLOT(SeverityToggled()));
+  connect(m_Controls->ShowWarning, SIGNAL(toggled(bool)), SLOT(SeverityToggled()));
+  connect(m_Controls->ShowError, SIGNAL(toggled(bool)), SLOT(SeverityToggled()));
+  connect(&m_Controls->Timer, SIGNAL(timeout()), SLOT(Flush()));
+  m_Controls->Timer.start(100);
+}
+
+LogWidget::~LogWidget()
+{
+  m_Controls->View->setModel(nullptr);
+  delete m_Controls;
+}
+
+void LogWidget::Append(const QString& msg, LogSeverity severity, const QString& origin)
+{
+  // Keep the rows a uniform height, one record per line
+  QStringList lines = msg.split('\n');
+  qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+  m_Controls->Mutex.lock();
+  for (const QString& line : lines)
+  {
+    m_Controls->Pending.push_back(LogRecord());
+    LogRecord& r = m_Controls->Pending.back();
+    r.Time_ms = now_ms;
+    r.Severity = severity;
+    r.Origin = origin;
+    r.Message = line.endsWith('\r') ? line.left(line.size() - 1) : line;
+  }
+  m_Controls->Mutex.unlock();
+}
+
+void LogWidget::ScrollToBottom()
+{
+  m_Controls->Mutex.lock();
+  m_Controls->ScrollRequested = true;
+  m_Controls->Mutex.unlock();
+}
+
+void LogWidget::Clear()
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Pending.clear();
+  m_Controls->ClearRequested = true;
+  m_Controls->Mutex.unlock();
+  Flush();
+}
+
+void LogWidget::SetCapacity(size_t max_records)
+{
+  m_Controls->Model.SetCapacity(max_records);
+  m_Controls->UpdateCount();
+}
+
+size_t LogWidget::GetCapacity() const
+{
+  return m_Controls->Model.GetCapacity();
+}
+
+size_t LogWidget::GetNumberOfRecords() const
+{
+  return m_Controls->Model.GetNumberOfRecords();
+}
+
+size_t LogWidget::GetMemoryUsed() const
+{
+  // Records waiting for the next refresh count too
+  m_Controls->Mutex.lock();
+  size_t bytes = m_Controls->Pending.capacity() * sizeof(LogRecord);
+  for (const LogRecord& r : m_Controls->Pending)
+    bytes += TextBytes(r);
+  m_Controls->Mutex.unlock();
+  return bytes + m_Controls->Model.GetMemoryUsed();
+}
+
+void LogWidget::Flush()
+{
+  std::vector<LogRecord> batch;
+  m_Controls->Mutex.lock();
+  batch.swap(m_Controls->Pending);
+  bool scroll = m_Controls->ScrollRequested;
+  bool clear = m_Controls->ClearRequested;
+  m_Controls->ScrollRequested = false;
+  m_Controls->ClearRequested = false;
+  m_Controls->Mutex.unlock();
+
+  if (clear)
+    m_Controls->Model.Clear();
+  if (batch.empty() && !clear)
+    return;
+  // Only follow the newest record if the user has not scrolled up to read something
+  QScrollBar* sb = m_Controls->View->verticalScrollBar();
+  bool follow = scroll || sb->value() == sb->maximum();
+  m_Controls->Model.Add(batch);
+  if (follow)
+    m_Controls->View->scrollToBottom();
+  m_Controls->UpdateCount();
+}
+
+void LogWidget::SearchChanged(const QString& text)
+{
+  m_Controls->Model.Query = text.toLower();
+  m_Controls->Model.Filter();
+  m_Controls->View->scrollToBottom();
+  m_Controls->UpdateCount();
+}
+
+void LogWidget::SeverityToggled()
+{
+  m_Controls->Model.Show[int(LogSeverity::Debug)] = m_Controls->ShowDebug->isChecked();
+  m_Controls->Model.Show[int(LogSeverity::Info)] = m_Controls->ShowInfo->isChecked();
+  m_Controls->Model.Show[int(LogSeverity::Warning)] = m_Controls->ShowWarning->isChecked();
+  m_Controls->Model.Show[int(LogSeverity::Error)] = m_Controls->ShowError->isChecked();
+  m_Controls->Model.Show[int(LogSeverity::Fatal)] = m_Controls->ShowError->isChecked();
+  m_Controls->Model.Filter();
+  m_Controls->View->scrollToBottom();
+  m_Controls->UpdateCount();
+}
@@ -0,0 +1,40 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QWidget>
+
+enum class LogSeverity { Debug = 0, Info, Warning, Error, Fatal };
+
+// The Explorer log pane, a list view over a bounded ring of log records.
+// Only the visible rows are ever laid out, and the oldest records are dropped once the ring is full.
+// Messages are indexed by trigram as they come in, so searching and severity filtering
+// only rebuild the list of matching rows, never the text.
+class LogWidget : public QWidget
+{
+  Q_OBJECT
+public:
+  LogWidget(QWidget *parent = Q_NULLPTR);
+  virtual ~LogWidget();
+
+  // Safe to call from any thread, records are queued and shown on the next refresh
+  void Append(const QString& msg, LogSeverity severity=LogSeverity::Info, const QString& origin=QString());
+  // Keep the newest record in view after the next refresh
+  void ScrollToBottom();
+  void Clear();
+
+  // Drops all records
+  void SetCapacity(size_t max_records);
+  size_t GetCapacity() const;
+  size_t GetNumberOfRecords() const;
+  size_t GetMemoryUsed() const;// bytes, records, their text and the search index
+
+protected slots:
+  void Flush();
+  void SearchChanged(const QString& text);
+  void SeverityToggled();
+
+private:
+  class Controls;
+  Controls* m_Controls;
+};
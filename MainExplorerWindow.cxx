@@ -12,13 +12,13 @@
 #include <QScrollBar>
 #include <QTimer>
 #include <QThread>
-#include <QtCharts/QChart>
-#include <QtCharts/QChartView>
-#include <QtCharts/QLineSeries>
-#include <QtCharts/QValueAxis>
 #include <QCloseEvent>
 #include <QMessageBox>
 #include <QMutex>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QShortcut>
+#include <iostream>
 
 #include <pqActiveObjects.h>
 #include <pqAlwaysConnectedBehavior.h>
@@ -28,10 +28,13 @@
 #include <pqContextView.h>
 #include <pqXYChartView.h>
 #include <pqRenderView.h>
+#include <pqServer.h>
+#include <pqServerResource.h>
 
 #include <vtkSMProxy.h>
 #include <vtkSMPropertyHelper.h>
 #include <vtkSMReaderFactory.h>
+#include <vtkSMSessionProxyManager.h>
 
 #include "MainExplorerWindow.h"
 #include "ui_MainExplorerWindow.h"
@@ -40,13 +43,29 @@
 #include "AnaphylaxisShowcaseWidget.h"
 #include "MultiTraumaShowcaseWidget.h"
 #include "DataRequestsWidget.h"
+#include "CompartmentHeatmapWidget.h"
+#include "MemoryAccountingWidget.h"
 #include "VitalsMonitorWidget.h"
+#include "SweepRunner.h"
+#include "WhatIfPredictor.h"
+#include "VitalsBroadcaster.h"
+#include "StartupTimeline.h"
+#include "RealtimeThread.h"
+#include "ScenarioRunner.h"
+#include "PatientCache.h"
+#include "RenderScheduler.h"
+#include "MemoryAccounting.h"
 
 #include "cdm/CommonDataModel.h"
 #include "PulsePhysiologyEngine.h"
 #include "cdm/scenario/SEDataRequestManager.h"
 #include "cdm/engine/SEEngineTracker.h"
 #include "cdm/properties/SEScalarTime.h"
+#include "cdm/properties/SEScalarFrequency.h"
+#include "cdm/properties/SEScalarPressure.h"
+#include "cdm/properties/SEScalarTemperature.h"
+#include "cdm/properties/SEScalarVolume.h"
+#include "cdm/properties/SEScalarVolumePerTime.h"
 
 
 class MainExplorerWindow::Controls : public Ui::MainExplorerWindow
@@ -60,26 +79,152 @@ public:
     delete MainView;
     delete ExplorerIntroWidget;
     delete AnaphylaxisShowcaseWidget;
+    delete MultiTraumaShowcaseWidget;
     delete VitalsMonitorWidget;
     delete DataRequestsWidget;
+    delete CompartmentHeatmapWidget;
+    delete MemoryAccountingWidget;
+    delete SweepRunner;
+    delete ScenarioRunner;
+    delete PatientCache;
   }
 
   QMutex                            Mutex;
   QPulse*                           Pulse;
   QPointer<QThread>                 Thread;
   QPointer<GeometryView>            GeometryView;
-  pqRenderView*                     MainView;
+  pqRenderView*                     MainView=nullptr;
   ExplorerIntroWidget*              ExplorerIntroWidget;
-  AnaphylaxisShowcaseWidget*        AnaphylaxisShowcaseWidget;
-  MultiTraumaShowcaseWidget*        MultiTraumaShowcaseWidget;
+  AnaphylaxisShowcaseWidget*        AnaphylaxisShowcaseWidget=nullptr;
+  MultiTraumaShowcaseWidget*        MultiTraumaShowcaseWidget=nullptr;
   VitalsMonitorWidget*              VitalsMonitorWidget;
   DataRequestsWidget*               DataRequestsWidget;
+  CompartmentHeatmapWidget*         CompartmentHeatmapWidget;
+  MemoryAccountingWidget*           MemoryAccountingWidget;
+  std::vector<size_t>               MemoryReporters;
+  SweepRunner*                      SweepRunner=nullptr;
+  ScenarioRunner*                   ScenarioRunner=nullptr;
+  QString                           Scenario;// File of the running scenario, empty when running a showcase
+  PatientCache*                     PatientCache=nullptr;
+  QString                           PatientState;// State of the running new patient, empty when running a showcase
   std::stringstream                 Status;
-  double                            CurrentSimTime_s;
+  OverloadLevel                     Overload = OverloadLevel::None;
+  double                            CurrentSimTime_s = 0;
+  RenderScheduler                   Scheduler;// Draws the views that changed, after each UI refresh
+  size_t                            MainViewRender = -1;
+
+  // PULSE_EXPLORER_SERVER (i.e. cs://localhost:11111) points us at a separately launched pvserver,
+  // so loading, coloring and rendering the anatomy happens there instead of next to the engine
+  pqServer* ConnectToServer()
+  {
+    QString url = qgetenv("PULSE_EXPLORER_SERVER");
+    if (url.isEmpty())
+      return pqActiveObjects::instance().activeServer();
+    pqServer* server = pqApplicationCore::instance()->getObjectBuilder()->createServer(pqServerResource(url));
+    if (server == nullptr)
+    {
+      LogBox->Append("Unable to connect to " + url + ", using the builtin server", LogSeverity::Warning);
+      return pqActiveObjects::instance().activeServer();
+    }
+    pqActiveObjects::instance().setActiveServer(server);
+    // Always render on the server and only ship compressed images back
+    vtkSMProxy* settings = server->proxyManager()->GetProxy("settings", "RenderViewSettings");
+    if (settings != nullptr)
+    {
+      if (settings->GetProperty("RemoteRenderThreshold") != nullptr)
+        vtkSMPropertyHelper(settings, "RemoteRenderThreshold").Set(0.0);
+      if (settings->GetProperty("CompressorConfig") != nullptr)
+        vtkSMPropertyHelper(settings, "CompressorConfig").Set("vtkLZ4Compressor 0 3");
+      settings->UpdateVTKObjects();
+    }
+    LogBox->Append("Rendering the anatomy on " + url);
+    return server;
+  }
+
+  // The 3D view (and any server connection) waits until it is looked at, or a showcase needs it
+  void BuildRenderView()
+  {
+    if (MainView != nullptr)
+      return;
+    pqServer* server = ConnectToServer();
+    MainView = qobject_cast<pqRenderView*>(pqApplicationCore::instance()->getObjectBuilder()->createView(
+                                           pqRenderView::renderViewType(), server));
+    TabWidget->widget(0)->layout()->addWidget(MainView->widget());
+    StartupTimeline::Mark("Render view");
+    GeometryView = new ::GeometryView(MainView);
+    GeometryView->LoadGeometry(GetDataDirectory(server));
+    Pulse->RegisterListener(GeometryView, 5);
+    MainViewRender = Scheduler.AddView("3D", [this]() { return Overload < OverloadLevel::Paused3D && GeometryView->NeedsRender(); },
+                                       [this]() { GeometryView->Render(); }, 1);
+    StartupTimeline::Mark("Geometry loaded");
+  }
+
+  void BuildShowcase(const QString& showcase, QWidget* parent)
+  {
+    if (showcase == "Anaphylaxis" && AnaphylaxisShowcaseWidget == nullptr)
+    {
+      AnaphylaxisShowcaseWidget = new ::AnaphylaxisShowcaseWidget(*Pulse, parent);
+      AnaphylaxisShowcaseWidget->setTitleBarWidget(new QWidget());
+      InputWidget->layout()->addWidget(AnaphylaxisShowcaseWidget);
+    }
+    else if (showcase == "MultiTrauma" && MultiTraumaShowcaseWidget == nullptr)
+    {
+      MultiTraumaShowcaseWidget = new ::MultiTraumaShowcaseWidget(*Pulse, parent);
+      MultiTraumaShowcaseWidget->setTitleBarWidget(new QWidget());
+      InputWidget->layout()->addWidget(MultiTraumaShowcaseWidget);
+    }
+  }
+
+  // A patient file comes with no data requests of its own, plot (and record) the basics
+  void AddPatientDataRequests(SEDataRequestManager& drMgr)
+  {
+    drMgr.CreatePhysiologyDataRequest("HeartRate", FrequencyUnit::Per_min);
+    drMgr.CreatePhysiologyDataRequest("MeanArterialPressure", PressureUnit::mmHg);
+    drMgr.CreatePhysiologyDataRequest("OxygenSaturation");
+    drMgr.CreatePhysiologyDataRequest("RespirationRate", FrequencyUnit::Per_min);
+    drMgr.CreatePhysiologyDataRequest("TidalVolume", VolumeUnit::mL);
+    drMgr.CreatePhysiologyDataRequest("CardiacOutput", VolumePerTimeUnit::L_Per_min);
+    drMgr.CreatePhysiologyDataRequest("BloodVolume", VolumeUnit::L);
+    drMgr.CreatePhysiologyDataRequest("EndTidalCarbonDioxidePressure", PressureUnit::mmHg);
+    drMgr.CreatePhysiologyDataRequest("CoreTemperature", TemperatureUnit::C);
+  }
+
+  // Controls of a running engine, the intro is up when they are not
+  void ShowRunControls(bool b)
+  {
+    ExplorerIntroWidget->setVisible(!b);
+    TimelineSlider->setVisible(b);
+    FastForwardTime->setVisible(b);
+    FastForwardButton->setVisible(b);
+    RunInRealtime->setVisible(b);
+    BroadcastVitals->setVisible(b);
+    PlayPauseButton->setVisible(b);
+    ResetExplorer->setVisible(b);
+    ResetShowcaseButton->setVisible(b);
+  }
+
+  void HideShowcases()
+  {
+    if (AnaphylaxisShowcaseWidget != nullptr)
+      AnaphylaxisShowcaseWidget->setVisible(false);
+    if (MultiTraumaShowcaseWidget != nullptr)
+      MultiTraumaShowcaseWidget->setVisible(false);
+  }
+
+  // Where the server we are on can find the anatomy meshes
+  QString GetDataDirectory(pqServer* server)
+  {
+    if (server == nullptr || !server->isRemote())
+      return "data";
+    QString dir = qgetenv("PULSE_EXPLORER_SERVER_DATA");
+    // A pvserver on this machine can read our copy, but it has its own working directory
+    return dir.isEmpty() ? QFileInfo("data").absoluteFilePath() : dir;
+  }
 };
 
 MainExplorerWindow::MainExplorerWindow()
 {
+  StartupTimeline::Mark("Main window");
   m_Controls = new Controls();
   m_Controls->setupUi(this);
 
@@ -101,62 +246,137 @@ MainExplorerWindow::MainExplorerWindow()
   m_Controls->OutputWidget->show();
   m_Controls->OutputWidget->raise();
   m_Controls->OutputWidget->setVisible(true);
-  m_Controls->LogBox->setFontPointSize(10);
   
   m_Controls->Thread = new QThread(parent());
   m_Controls->Pulse = new QPulse(*m_Controls->Thread, *m_Controls->LogBox);
-  m_Controls->Pulse->RegisterListener(this);
+  m_Controls->Pulse->RegisterListener(this, 10);
+  if (qEnvironmentVariableIsSet("PULSE_EXPLORER_REALTIME_CPU"))
+  {// Hardware in the loop rigs want the engine on its own core
+    RealtimeSettings realtime;
+    realtime.CPU = qgetenv("PULSE_EXPLORER_REALTIME_CPU").toInt();
+    if (qEnvironmentVariableIsSet("PULSE_EXPLORER_REALTIME_PRIORITY"))
+      realtime.Priority = qgetenv("PULSE_EXPLORER_REALTIME_PRIORITY").toInt();
+    m_Controls->Pulse->EnableRealtimeMode(realtime);
+  }
   m_Controls->Status << "Current Simulation Time : 0s";
+  StartupTimeline::Mark("Engine created");
 
   // Add the Intro Widget to the Main control area
   m_Controls->ExplorerIntroWidget = new ExplorerIntroWidget(this);
   m_Controls->ExplorerIntroWidget->setTitleBarWidget(new QWidget());
   m_Controls->InputWidget->layout()->addWidget(m_Controls->ExplorerIntroWidget);
 
-  // Add ParaView view to the tabWidget
-  m_Controls->MainView =
-      qobject_cast<pqRenderView*>(pqApplicationCore::instance()->getObjectBuilder()->createView(
-                                  pqRenderView::renderViewType(),pqActiveObjects::instance().activeServer()));
-  m_Controls->GeometryView = new GeometryView(m_Controls->MainView, this);
-  m_Controls->GeometryView->LoadGeometry();
-  m_Controls->Pulse->RegisterListener(m_Controls->GeometryView);
+  // The ParaView view is added to the tabWidget when first needed, see BuildRenderView
   this->setCentralWidget(m_Controls->TabWidget);
-  m_Controls->TabWidget->widget(0)->layout()->addWidget(m_Controls->MainView->widget());
   m_Controls->VitalsMonitorWidget = new VitalsMonitorWidget(*m_Controls->LogBox, this);
-  m_Controls->Pulse->RegisterListener(m_Controls->VitalsMonitorWidget);
+  // Its waveforms and alarms see every step through PulseStepped, this is just the display rate
+  m_Controls->Pulse->RegisterListener(m_Controls->VitalsMonitorWidget, 10);
   m_Controls->TabWidget->widget(1)->layout()->addWidget(m_Controls->VitalsMonitorWidget);
   m_Controls->DataRequestsWidget = new DataRequestsWidget(*m_Controls->LogBox, this);
   m_Controls->DataRequestsWidget->setTitleBarWidget(new QWidget());
-  m_Controls->Pulse->RegisterListener(m_Controls->DataRequestsWidget);
+  m_Controls->Pulse->RegisterListener(m_Controls->DataRequestsWidget, 10);
   m_Controls->TabWidget->widget(2)->layout()->addWidget(m_Controls->DataRequestsWidget);
+  m_Controls->CompartmentHeatmapWidget = new CompartmentHeatmapWidget(this);
+  m_Controls->CompartmentHeatmapWidget->setTitleBarWidget(new QWidget());
+  // The snapshot is taken every step through PulseStepped, the heatmap is drawn through the render scheduler
+  m_Controls->Pulse->RegisterListener(m_Controls->CompartmentHeatmapWidget, 10);
+  m_Controls->TabWidget->widget(3)->layout()->addWidget(m_Controls->CompartmentHeatmapWidget);
+  // The vitals are what people watch, they go first when there is not time to draw everything
+  m_Controls->Scheduler.AddView("Vitals", [this]() { return m_Controls->VitalsMonitorWidget->NeedsRender(); },
+                                [this]() { m_Controls->VitalsMonitorWidget->Render(); }, 2);
+  m_Controls->Scheduler.AddView("Data Requests", [this]() { return m_Controls->DataRequestsWidget->NeedsRender(); },
+                                [this]() { m_Controls->DataRequestsWidget->Render(); }, 0);
+  m_Controls->Scheduler.AddView("Compartments", [this]() { return m_Controls->CompartmentHeatmapWidget->NeedsRender(); },
+                                [this]() { m_Controls->CompartmentHeatmapWidget->Render(); }, 0);
+  // Queued after the refresh that runs every PulseUpdateUI, so the views have their new data
+  connect(m_Controls->Pulse, SIGNAL(RefreshUI()), this, SLOT(RenderViews()));
 
+  // What each part of the Explorer holds, in a dock next to the log
+  // The heaps hold checkpoints, histories and the like reported on their own, so they are not added to the total
+  if (MemoryAccounting::IsCountingAllocations())
+  {
+    m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Engine heap",
+      []() { return MemoryAccounting::GetHeapBytes(MemoryAccounting::EngineHeap); }, true));
+    m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Prediction, sweep and patient engines heap",
+      []() { return MemoryAccounting::GetHeapBytes(MemoryAccounting::BackgroundEngineHeap); }, true));
+  }
+  m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Engine checkpoints",
+    [this]() { return m_Controls->Pulse->GetCheckpointMemoryUsed(); }));
+  m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Plot samples",
+    [this]() { return m_Controls->VitalsMonitorWidget->GetSampleMemoryUsed() + m_Controls->DataRequestsWidget->GetSampleMemoryUsed(); }));
+  m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Session history",
+    [this]() { return m_Controls->DataRequestsWidget->GetHistoryMemoryUsed(); }));
+  m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Chart views",
+    [this]() { return m_Controls->VitalsMonitorWidget->GetChartMemoryUsed() + m_Controls->DataRequestsWidget->GetChartMemoryUsed(); }));
+  m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Log",
+    [this]() { return m_Controls->LogBox->GetMemoryUsed(); }));
+  m_Controls->MemoryReporters.push_back(MemoryAccounting::Register("Anatomy geometry",
+    [this]() { return m_Controls->GeometryView != nullptr ? m_Controls->GeometryView->GetMemoryUsed() : size_t(0); }));
+  m_Controls->MemoryAccountingWidget = new MemoryAccountingWidget(*m_Controls->LogBox, this);
+  addDockWidget(Qt::BottomDockWidgetArea, m_Controls->MemoryAccountingWidget);
+  tabifyDockWidget(m_Controls->OutputWidget, m_Controls->MemoryAccountingWidget);
+  m_Controls->OutputWidget->raise();
+
+  m_Controls->TimelineSlider->setVisible(false);
+  m_Controls->FastForwardTime->setVisible(false);
+  m_Controls->FastForwardButton->setVisible(false);
   m_Controls->RunInRealtime->setVisible(false);
+  m_Controls->BroadcastVitals->setVisible(false);
   m_Controls->PlayPauseButton->setVisible(false);
   m_Controls->ResetExplorer->setVisible(false);
   m_Controls->ResetShowcaseButton->setVisible(false);
 
-  // Add Scenario Widgets
-
-  m_Controls->AnaphylaxisShowcaseWidget = new AnaphylaxisShowcaseWidget(*m_Controls->Pulse, this);
-  m_Controls->AnaphylaxisShowcaseWidget->setTitleBarWidget(new QWidget());
-  m_Controls->InputWidget->layout()->addWidget(m_Controls->AnaphylaxisShowcaseWidget);
-  m_Controls->AnaphylaxisShowcaseWidget->setVisible(false);
-
-  m_Controls->MultiTraumaShowcaseWidget = new MultiTraumaShowcaseWidget(*m_Controls->Pulse,  this);
-  m_Controls->MultiTraumaShowcaseWidget->setTitleBarWidget(new QWidget());
-  m_Controls->InputWidget->layout()->addWidget(m_Controls->MultiTraumaShowcaseWidget);
-  m_Controls->MultiTraumaShowcaseWidget->setVisible(false);
+  // Scenario Widgets are made when their showcase is started
 
   connect(this,SIGNAL(PulseChanged()), this, SLOT(PulseUpdate()));
   connect(m_Controls->RunInRealtime, SIGNAL(clicked()), this, SLOT(RunInRealtime()));
+  connect(m_Controls->BroadcastVitals, SIGNAL(clicked()), this, SLOT(ToggleBroadcast()));
+  connect(&m_Controls->Pulse->GetBroadcaster(), SIGNAL(ClientsChanged(int)), this, SLOT(BroadcastClientsChanged(int)));
   connect(m_Controls->PlayPauseButton, SIGNAL(clicked()), this, SLOT(PlayPause()));
   connect(m_Controls->ResetExplorer, SIGNAL(clicked()), this, SLOT(ResetExplorer()));
   connect(m_Controls->ResetShowcaseButton, SIGNAL(clicked()), this, SLOT(ResetShowcase()));
+  connect(m_Controls->TimelineSlider, SIGNAL(sliderReleased()), this, SLOT(RewindTimeline()));
+  connect(m_Controls->FastForwardButton, SIGNAL(clicked()), this, SLOT(FastForward()));
+  connect(m_Controls->Pulse, SIGNAL(PredictionReady()), this, SLOT(ShowPrediction()));
+  connect(m_Controls->TabWidget, SIGNAL(currentChanged(int)), this, SLOT(TabChanged(int)));
+  connect(new QShortcut(QKeySequence("Ctrl+Shift+T"), this), SIGNAL(activated()), this, SLOT(DumpStartupTimeline()));
+  connect(new QShortcut(QKeySequence("Ctrl+Shift+M"), this), SIGNAL(activated()), m_Controls->MemoryAccountingWidget, SLOT(Dump()));
+
+  StartupTimeline::Mark("Widgets built");
+  StartupTimeline::WatchFirstPaint(*this, [this]()
+  {
+    StartupTimeline::Mark("First paint");
+    QTimer::singleShot(0, this, SLOT(StartupFinished()));// Once the event loop is free again
+  });
+}
+
+void MainExplorerWindow::StartupFinished()
+{
+  StartupTimeline::Mark("Interactive");
+  if (qEnvironmentVariableIsSet("PULSE_EXPLORER_STARTUP_TIMELINE"))
+    DumpStartupTimeline();
+  if (m_Controls->TabWidget->currentIndex() == 0)
+    m_Controls->BuildRenderView();
+}
+
+void MainExplorerWindow::DumpStartupTimeline()
+{
+  std::string timeline = StartupTimeline::ToString();
+  std::cout << timeline << std::endl;
+  m_Controls->LogBox->Append(timeline.c_str());
+  m_Controls->Pulse->ScrollLogBox();
+}
+
+void MainExplorerWindow::TabChanged(int idx)
+{
+  if (idx == 0)
+    m_Controls->BuildRenderView();
 }
 
 MainExplorerWindow::~MainExplorerWindow()
 {
-  
+  for (size_t id : m_Controls->MemoryReporters)
+    MemoryAccounting::Unregister(id);
   delete m_Controls;
 }
 
@@ -199,54 +419,62 @@ void MainExplorerWindow::ResetExplorer()
   m_Controls->Pulse->Reset();
   m_Controls->DataRequestsWidget->Reset();
   m_Controls->VitalsMonitorWidget->Reset();
+  m_Controls->CompartmentHeatmapWidget->Reset();
   m_Controls->RunInRealtime->setChecked(true);
   m_Controls->PlayPauseButton->setText("Pause");
-  m_Controls->LogBox->clear();
+  m_Controls->LogBox->Clear();
   m_Controls->Status << "Current Simulation Time : 0s";
-  m_Controls->ExplorerIntroWidget->setVisible(true);
-  m_Controls->RunInRealtime->setVisible(false);
-  m_Controls->PlayPauseButton->setVisible(false);
-  m_Controls->ResetExplorer->setVisible(false);
-  m_Controls->ResetShowcaseButton->setVisible(false);
-  m_Controls->AnaphylaxisShowcaseWidget->setVisible(false);
-  m_Controls->MultiTraumaShowcaseWidget->setVisible(false);
+  m_Controls->ShowRunControls(false);
+  m_Controls->HideShowcases();
   m_Controls->Pulse->RemoveListener(m_Controls->AnaphylaxisShowcaseWidget);
   m_Controls->Pulse->RemoveListener(m_Controls->MultiTraumaShowcaseWidget);
+  m_Controls->Pulse->RemoveListener(m_Controls->ScenarioRunner);
+  m_Controls->Scenario.clear();
+  m_Controls->PatientState.clear();
 }
 
 void MainExplorerWindow::ResetShowcase()
 {
   m_Controls->Pulse->Reset();
-  m_Controls->GeometryView->Reset();
+  if (m_Controls->GeometryView != nullptr)
+    m_Controls->GeometryView->Reset();
   m_Controls->DataRequestsWidget->Reset();
   m_Controls->VitalsMonitorWidget->Reset();
+  m_Controls->CompartmentHeatmapWidget->Reset();
   m_Controls->RunInRealtime->setChecked(true);
   m_Controls->PlayPauseButton->setText("Pause");
-  m_Controls->LogBox->clear();  
+  m_Controls->LogBox->Clear();  
   m_Controls->Pulse->RemoveListener(m_Controls->AnaphylaxisShowcaseWidget);
   m_Controls->Pulse->RemoveListener(m_Controls->MultiTraumaShowcaseWidget);
-  StartShowcase();
+  m_Controls->Pulse->RemoveListener(m_Controls->ScenarioRunner);
+  if (!m_Controls->Scenario.isEmpty())
+    StartScenario();
+  else if (!m_Controls->PatientState.isEmpty())
+    StartPatient();
+  else
+    StartShowcase();
 }
 
 void MainExplorerWindow::StartShowcase()
 {
-  m_Controls->ExplorerIntroWidget->setVisible(false);
-  m_Controls->RunInRealtime->setVisible(true);
-  m_Controls->PlayPauseButton->setVisible(true);
-  m_Controls->ResetExplorer->setVisible(true);
-  m_Controls->ResetShowcaseButton->setVisible(true);
+  m_Controls->ShowRunControls(true);
+  m_Controls->TimelineSlider->setRange(0, 0);
   QString showcase = m_Controls->ExplorerIntroWidget->GetShowcase();
+  m_Controls->BuildRenderView();
+  m_Controls->BuildShowcase(showcase, this);
   m_Controls->Pulse->GetEngineTracker().Clear();
   if(showcase == "Anaphylaxis")
   {
     m_Controls->GeometryView->RenderSpO2(true);
     m_Controls->AnaphylaxisShowcaseWidget->setVisible(true);
+    MemoryAccounting::HeapScope heap(MemoryAccounting::EngineHeap);// The state it loads belongs to the engine
     m_Controls->AnaphylaxisShowcaseWidget->ConfigurePulse(m_Controls->Pulse->GetEngine(),m_Controls->Pulse->GetEngineTracker().GetDataRequestManager());
     m_Controls->Pulse->RegisterListener(m_Controls->AnaphylaxisShowcaseWidget);
   }
   else if(showcase == "MultiTrauma")
   {
     m_Controls->MultiTraumaShowcaseWidget->setVisible(true);
+    MemoryAccounting::HeapScope heap(MemoryAccounting::EngineHeap);
     m_Controls->MultiTraumaShowcaseWidget->ConfigurePulse(m_Controls->Pulse->GetEngine(), m_Controls->Pulse->GetEngineTracker().GetDataRequestManager());
     m_Controls->Pulse->RegisterListener(m_Controls->MultiTraumaShowcaseWidget);
   }
@@ -254,13 +482,172 @@ void MainExplorerWindow::StartShowcase()
   m_Controls->Pulse->Start();
 }
 
+void MainExplorerWindow::LoadScenario()
+{
+  QString filename = QFileDialog::getOpenFileName(this, "Open Pulse Scenario", "./", "Pulse Scenarios (*.pba *.json);;All Files (*)");
+  if (filename.isEmpty())
+    return;
+  m_Controls->Scenario = filename;
+  StartScenario();
+}
+
+void MainExplorerWindow::StartScenario()
+{
+  if (m_Controls->ScenarioRunner == nullptr)
+    m_Controls->ScenarioRunner = new ScenarioRunner(*m_Controls->Pulse);
+  m_Controls->Pulse->GetEngineTracker().Clear();
+  bool loaded;
+  {// The state the scenario loads belongs to the engine
+    MemoryAccounting::HeapScope heap(MemoryAccounting::EngineHeap);
+    loaded = m_Controls->ScenarioRunner->Load(m_Controls->Scenario.toStdString(), m_Controls->Pulse->GetEngine(),
+                                              m_Controls->Pulse->GetEngineTracker().GetDataRequestManager());
+  }
+  if (!loaded)
+  {
+    m_Controls->Scenario.clear();
+    m_Controls->Pulse->ScrollLogBox();
+    return;
+  }
+  m_Controls->ShowRunControls(true);
+  m_Controls->TimelineSlider->setRange(0, 0);
+  m_Controls->FastForwardTime->setValue(m_Controls->ScenarioRunner->GetDuration_s() / 60);
+  m_Controls->BuildRenderView();
+  m_Controls->Pulse->RegisterListener(m_Controls->ScenarioRunner);
+  m_Controls->DataRequestsWidget->BuildGraphs(m_Controls->Pulse->GetEngine());
+  m_Controls->Pulse->ScrollLogBox();
+  m_Controls->Pulse->Start();
+}
+
+void MainExplorerWindow::CreatePatient()
+{
+  if (m_Controls->PatientCache == nullptr)
+  {
+    m_Controls->PatientCache = new PatientCache();
+    connect(m_Controls->PatientCache, SIGNAL(Progress(double)), this, SLOT(PatientStabilizing(double)));
+    connect(m_Controls->PatientCache, SIGNAL(Stabilized(QString)), this, SLOT(PatientStabilized(QString)));
+  }
+  if (m_Controls->PatientCache->IsStabilizing())
+  {
+    m_Controls->PatientCache->Cancel();
+    return;
+  }
+  QString filename = QFileDialog::getOpenFileName(this, "Open Pulse Patient", "./patients", "Pulse Patients (*.pba *.json);;All Files (*)");
+  if (filename.isEmpty())
+    return;
+  QString name = QFileInfo(filename).completeBaseName();
+  QString state = m_Controls->PatientCache->Find(filename);
+  if (!state.isEmpty())
+  {
+    m_Controls->LogBox->Append("Using the stabilized " + name + " from " + m_Controls->PatientCache->GetDirectory());
+    m_Controls->PatientState = state;
+    StartPatient();
+    return;
+  }
+  if (!m_Controls->PatientCache->Stabilize(filename))
+  {
+    m_Controls->LogBox->Append("Unable to read patient " + filename, LogSeverity::Warning);
+    return;
+  }
+  m_Controls->LogBox->Append("Stabilizing " + name + ", this takes a few minutes the first time, after that it comes from " +
+                             m_Controls->PatientCache->GetDirectory());
+  m_Controls->Pulse->ScrollLogBox();
+  m_Controls->ExplorerIntroWidget->SetStabilizing(true);
+}
+
+void MainExplorerWindow::PatientStabilizing(double stabilized_s)
+{
+  m_Controls->StatusBar->showMessage("Stabilizing patient : " + QString::number(int(stabilized_s)) + "s simulated");
+}
+
+void MainExplorerWindow::PatientStabilized(QString state_file)
+{
+  m_Controls->ExplorerIntroWidget->SetStabilizing(false);
+  m_Controls->StatusBar->clearMessage();
+  if (state_file.isEmpty())
+  {
+    m_Controls->LogBox->Append("Patient stabilization failed or was cancelled, see Stabilization.log in " + m_Controls->PatientCache->GetDirectory(), LogSeverity::Warning);
+    m_Controls->Pulse->ScrollLogBox();
+    return;
+  }
+  m_Controls->LogBox->Append("Patient stabilized and cached as " + state_file);
+  m_Controls->Pulse->ScrollLogBox();
+  // Only take over if nothing else was started in the meantime
+  if (m_Controls->ExplorerIntroWidget->isVisible())
+  {
+    m_Controls->PatientState = state_file;
+    StartPatient();
+  }
+}
+
+void MainExplorerWindow::StartPatient()
+{
+  m_Controls->Pulse->GetEngineTracker().Clear();
+  bool loaded;
+  {// The loaded state belongs to the engine
+    MemoryAccounting::HeapScope heap(MemoryAccounting::EngineHeap);
+    loaded = m_Controls->Pulse->GetEngine().LoadStateFile(m_Controls->PatientState.toStdString());
+  }
+  if (!loaded)
+  {
+    m_Controls->LogBox->Append("Unable to load patient state " + m_Controls->PatientState, LogSeverity::Error);
+    m_Controls->PatientState.clear();
+    return;
+  }
+  m_Controls->ShowRunControls(true);
+  m_Controls->TimelineSlider->setRange(0, 0);
+  m_Controls->BuildRenderView();
+  m_Controls->AddPatientDataRequests(m_Controls->Pulse->GetEngineTracker().GetDataRequestManager());
+  m_Controls->DataRequestsWidget->BuildGraphs(m_Controls->Pulse->GetEngine());
+  m_Controls->Pulse->ScrollLogBox();
+  m_Controls->Pulse->Start();
+}
+
+void MainExplorerWindow::FastForward()
+{
+  double time_s = m_Controls->FastForwardTime->value() * 60;
+  m_Controls->Mutex.lock();
+  double now_s = m_Controls->CurrentSimTime_s;
+  m_Controls->Mutex.unlock();
+  if (time_s <= now_s)
+  {
+    m_Controls->LogBox->Append("Already past " + QString::number(time_s) + "s, drag the timeline back to rewind");
+    m_Controls->Pulse->ScrollLogBox();
+    return;
+  }
+  m_Controls->LogBox->Append("Fast forwarding to " + QString::number(time_s) + "s");
+  m_Controls->Pulse->ScrollLogBox();
+  // It carries on in real time once it gets there
+  m_Controls->RunInRealtime->setChecked(true);
+  m_Controls->Pulse->FastForwardTo(time_s);
+}
+
 void MainExplorerWindow::PulseUpdateUI()
 {
   m_Controls->Mutex.lock();
   m_Controls->Status.str("");
   m_Controls->Status << "Current Simulation Time : " << m_Controls->CurrentSimTime_s << "s";
+  if (m_Controls->Overload != OverloadLevel::None)
+    m_Controls->Status << "   (" << OverloadGovernor::ToString(m_Controls->Overload) << ")";
   m_Controls->StatusBar->showMessage(QString(m_Controls->Status.str().c_str()));
-  m_Controls->MainView->render();
+  if (!m_Controls->TimelineSlider->isSliderDown())
+  {
+    m_Controls->TimelineSlider->setRange(0, int(m_Controls->CurrentSimTime_s));
+    m_Controls->TimelineSlider->setValue(int(m_Controls->CurrentSimTime_s));
+  }
+  m_Controls->Mutex.unlock();
+}
+
+void MainExplorerWindow::RenderViews()
+{
+  if (m_Controls->GeometryView != nullptr)
+    m_Controls->Scheduler.SetInteracting(m_Controls->MainViewRender, m_Controls->GeometryView->IsInteracting());
+  m_Controls->Scheduler.Render();
+}
+
+void MainExplorerWindow::PulseOverloadChanged(OverloadLevel level)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Overload = level;
   m_Controls->Mutex.unlock();
 }
 
@@ -271,3 +658,116 @@ void MainExplorerWindow::ProcessPhysiology(PhysiologyEngine& pulse)
   m_Controls->CurrentSimTime_s = pulse.GetSimulationTime(TimeUnit::s);
   m_Controls->Mutex.unlock();
 }
+
+void MainExplorerWindow::RewindTimeline()
+{
+  int time_s = m_Controls->TimelineSlider->value();
+  if (time_s >= int(m_Controls->CurrentSimTime_s))
+    return;
+  m_Controls->LogBox->Append("Rewinding to " + QString::number(time_s) + "s");
+  m_Controls->Pulse->ScrollLogBox();
+  m_Controls->Pulse->RewindTo(time_s);
+}
+
+void MainExplorerWindow::ShowPrediction()
+{
+  PulsePrediction p;
+  if (!m_Controls->Pulse->GetPrediction(p))
+  {
+    if (m_Controls->Pulse->HasPredictionFailed())
+    {
+      m_Controls->LogBox->Append("The prediction failed, see WhatIfBaseline.log and WhatIfIntervention.log", LogSeverity::Error);
+      m_Controls->Pulse->ScrollLogBox();
+    }
+    return;
+  }
+  m_Controls->DataRequestsWidget->SetPrediction(p);
+  m_Controls->LogBox->Append(QString("Prediction ready, the Data Requests graphs show the next ") + QString::number(int(p.Times_s.empty() ? 0 : p.Times_s.back() - p.Times_s.front() + 1)) +
+                             "s with " + p.Name.c_str() + " in dashed green and without it in dashed gray");
+  m_Controls->Pulse->ScrollLogBox();
+}
+
+void MainExplorerWindow::ToggleBroadcast()
+{
+  if (!m_Controls->BroadcastVitals->isChecked())
+  {
+    m_Controls->Pulse->StopBroadcast();
+    m_Controls->LogBox->Append("Stopped broadcasting vitals");
+    return;
+  }
+  int port = qEnvironmentVariableIsSet("PULSE_EXPLORER_BROADCAST_PORT") ? qgetenv("PULSE_EXPLORER_BROADCAST_PORT").toInt() : 9050;
+  // Vitals are only offered to other machines when asked for
+  bool anyInterface = qEnvironmentVariableIntValue("PULSE_EXPLORER_BROADCAST_ANY_INTERFACE") != 0;
+  if (m_Controls->Pulse->StartBroadcast(port, anyInterface))
+  {
+    m_Controls->LogBox->Append("Broadcasting vitals on port " + QString::number(m_Controls->Pulse->GetBroadcaster().GetPort()) +
+                               (anyInterface ? " of every network interface" : " to this machine only"),
+                               anyInterface ? LogSeverity::Warning : LogSeverity::Info);
+  }
+  else
+  {
+    m_Controls->LogBox->Append("Unable to broadcast vitals on port " + QString::number(port), LogSeverity::Warning);
+    m_Controls->BroadcastVitals->setChecked(false);
+  }
+  m_Controls->Pulse->ScrollLogBox();
+}
+
+void MainExplorerWindow::BroadcastClientsChanged(int count)
+{
+  m_Controls->LogBox->Append(QString::number(count) + " vitals viewer(s) connected");
+  m_Controls->Pulse->ScrollLogBox();
+}
+
+void MainExplorerWindow::LoadResults()
+{
+  QString filename = QFileDialog::getOpenFileName(this, "Open Pulse Results", "./", "Pulse Results (*.csv)");
+  if (filename.isEmpty())
+    return;
+  // Any server connection has to happen before the table source is made on it
+  m_Controls->BuildRenderView();
+  m_Controls->TabWidget->setCurrentIndex(2);
+  m_Controls->DataRequestsWidget->LoadResults(filename);
+}
+
+void MainExplorerWindow::RunSweep()
+{
+  if (m_Controls->SweepRunner == nullptr)
+  {
+    m_Controls->SweepRunner = new SweepRunner();
+    connect(m_Controls->SweepRunner, SIGNAL(RunCompleted(QString)), this, SLOT(SweepRunCompleted(QString)));
+    connect(m_Controls->SweepRunner, SIGNAL(SweepFinished(int, int)), this, SLOT(SweepFinished(int, int)));
+  }
+  if (m_Controls->SweepRunner->IsRunning())
+  {
+    m_Controls->SweepRunner->Stop();
+    m_Controls->ExplorerIntroWidget->SetSweepRunning(false);
+    return;
+  }
+  if (!m_Controls->SweepRunner->Start())
+  {
+    if (m_Controls->SweepRunner->GetNumberOfRunsLeft() == 0)
+      m_Controls->LogBox->Append(QString("Parameter sweep is complete, every run is in ") + m_Controls->SweepRunner->GetResultsFile().c_str());
+    else
+      m_Controls->LogBox->Append(QString("Unable to write parameter sweep results to ") + m_Controls->SweepRunner->GetResultsFile().c_str(), LogSeverity::Warning);
+    return;
+  }
+  m_Controls->LogBox->Append(QString("Running parameter sweep of ") + QString::number(m_Controls->SweepRunner->GetNumberOfRuns()) +
+                             " runs in the background, results go to " + m_Controls->SweepRunner->GetResultsFile().c_str());
+  m_Controls->ExplorerIntroWidget->SetSweepRunning(true);
+}
+
+void MainExplorerWindow::SweepRunCompleted(QString summary)
+{
+  m_Controls->LogBox->Append("Sweep run : " + summary);
+  m_Controls->Pulse->ScrollLogBox();
+}
+
+void MainExplorerWindow::SweepFinished(int completed, int total)
+{
+  m_Controls->LogBox->Append("Parameter sweep stopped with " + QString::number(completed) + " of " + QString::number(total) + " runs complete");
+  int failed = m_Controls->SweepRunner->GetNumberOfFailedRuns();
+  if (failed > 0)
+    m_Controls->LogBox->Append(QString::number(failed) + " runs failed (see their logs in sweep/), run the sweep again to retry them", LogSeverity::Warning);
+  m_Controls->Pulse->ScrollLogBox();
+  m_Controls->ExplorerIntroWidget->SetSweepRunning(false);
+}
@@ -22,14 +22,34 @@ public:
   void ProcessPhysiology(PhysiologyEngine& pulse);
 
   void PulseUpdateUI();
+  void PulseOverloadChanged(OverloadLevel level);
 
 signals:
 protected slots:
   void PlayPause();
+  void RenderViews();
   void RunInRealtime();
   void ResetExplorer();
   void ResetShowcase();
   void StartShowcase();
+  void StartupFinished();
+  void DumpStartupTimeline();
+  void TabChanged(int idx);
+  void RewindTimeline();
+  void ShowPrediction();
+  void ToggleBroadcast();
+  void BroadcastClientsChanged(int count);
+  void RunSweep();
+  void LoadResults();
+  void LoadScenario();
+  void StartScenario();
+  void FastForward();
+  void CreatePatient();
+  void StartPatient();
+  void PatientStabilizing(double stabilized_s);
+  void PatientStabilized(QString state_file);
+  void SweepRunCompleted(QString summary);
+  void SweepFinished(int completed, int total);
 
 private:
   class Controls;
@@ -0,0 +1,267 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <psapi.h>
+  #ifdef _MSC_VER
+    #pragma comment(lib, "psapi.lib")
+  #endif
+#elif defined(__APPLE__)
+  #include <mach/mach.h>
+#else
+  #include <unistd.h>
+#endif
+
+struct MemoryReporter
+{
+  size_t                  Id;
+  std::string             Name;
+  std::function<size_t()> Bytes;
+  bool                    Overlapping = false;
+  size_t                  HighWater = 0;
+};
+
+class MemoryRegistry
+{
+public:
+  std::mutex                  Mutex;
+  std::vector<MemoryReporter> Reporters;
+  size_t                      NextId = 0;
+  size_t                      TotalHighWater = 0;
+  size_t                      ResidentHighWater = 0;
+};
+
+// Made on first use, so subsystems can register from static initializers
+static MemoryRegistry& Registry()
+{
+  static MemoryRegistry registry;
+  return registry;
+}
+
+// Plain statics, so they are usable by operator new before any constructor has run
+static std::atomic<size_t> HeapBytes[MemoryAccounting::NumHeaps];
+static thread_local int ThreadHeap = MemoryAccounting::OtherHeap;
+
+size_t MemoryAccounting::Register(const std::string& name, std::function<size_t()> bytes, bool overlapping)
+{
+  MemoryRegistry& r = Registry();
+  std::lock_guard<std::mutex> lock(r.Mutex);
+  MemoryReporter reporter;
+  reporter.Id = r.NextId++;
+  reporter.Name = name;
+  reporter.Bytes = bytes;
+  reporter.Overlapping = overlapping;
+  r.Reporters.push_back(reporter);
+  return reporter.Id;
+}
+
+void MemoryAccounting::Unregister(size_t id)
+{
+  MemoryRegistry& r = Registry();
+  std::lock_guard<std::mutex> lock(r.Mutex);
+  r.Reporters.erase(std::remove_if(r.Reporters.begin(), r.Reporters.end(),
+    [id](const MemoryReporter& reporter) { return reporter.Id == id; }), r.Reporters.end());
+}
+
+std::vector<MemoryAccounting::Usage> MemoryAccounting::Sample()
+{
+  MemoryRegistry& r = Registry();
+  std::lock_guard<std::mutex> lock(r.Mutex);
+  std::vector<Usage> usage;
+  std::vector<Usage> overlapping;
+  size_t total = 0;
+  for (MemoryReporter& reporter : r.Reporters)
+  {
+    Usage u;
+    u.Name = reporter.Name;
+    u.Bytes = reporter.Bytes ? reporter.Bytes() : 0;
+    reporter.HighWater = std::max(reporter.HighWater, u.Bytes);
+    u.HighWater = reporter.HighWater;
+    if (reporter.Overlapping)
+    {
+      u.Type = Overlapping;
+      overlapping.push_back(u);
+      continue;
+    }
+    total += u.Bytes;
+    usage.push_back(u);
+  }
+  r.TotalHighWater = std::max(r.TotalHighWater, total);
+  Usage accounted;
+  accounted.Name = "Accounted for";
+  accounted.Bytes = total;
+  accounted.HighWater = r.TotalHighWater;
+  accounted.Type = Total;
+  usage.push_back(accounted);
+
+  size_t resident = GetResidentBytes();
+  r.ResidentHighWater = std::max(r.ResidentHighWater, resident);
+  Usage process;
+  process.Name = "Process resident";
+  process.Bytes = resident;
+  process.HighWater = r.ResidentHighWater;
+  process.Type = Total;
+  usage.push_back(process);
+
+  usage.insert(usage.end(), overlapping.begin(), overlapping.end());
+  return usage;
+}
+
+void MemoryAccounting::ResetHighWater()
+{
+  MemoryRegistry& r = Registry();
+  std::lock_guard<std::mutex> lock(r.Mutex);
+  for (MemoryReporter& reporter : r.Reporters)
+    reporter.HighWater = 0;
+  r.TotalHighWater = 0;
+  r.ResidentHighWater = 0;
+}
+
+std::string MemoryAccounting::FormatBytes(size_t bytes)
+{
+  static const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+  double value = double(bytes);
+  size_t unit = 0;
+  while (value >= 1024 && unit < 4)
+  {
+    value /= 1024;
+    unit++;
+  }
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+  return buffer;
+}
+
+std::string MemoryAccounting::ToString(const std::vector<Usage>& usage)
+{
+  size_t width = 0;
+  for (const Usage& u : usage)
+    width = std::max(width, u.Name.size());
+  std::stringstream ss;
+  ss << "Memory (current / high water)";
+  bool overlapping = false;
+  for (const Usage& u : usage)
+  {
+    if (u.Type == Overlapping && !overlapping)
+    {
+      ss << "\n Also in the rows above (not accounted for twice)";
+      overlapping = true;
+    }
+    ss << "\n  " << u.Name << std::string(width - u.Name.size(), ' ') << " : " << FormatBytes(u.Bytes) << " / " << FormatBytes(u.HighWater);
+  }
+  return ss.str();
+}
+
+size_t MemoryAccounting::GetResidentBytes()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return size_t(counters.WorkingSetSize);
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+    return size_t(info.resident_size);
+  return 0;
+#else
+  // Total and resident pages
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0;
+  size_t resident = 0;
+  if (!(statm >> pages >> resident))
+    return 0;
+  return resident * size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+bool MemoryAccounting::IsCountingAllocations()
+{
+#ifdef PULSE_EXPLORER_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void MemoryAccounting::SetThreadHeap(Heap heap)
+{
+  ThreadHeap = heap;
+}
+
+MemoryAccounting::Heap MemoryAccounting::GetThreadHeap()
+{
+  return Heap(ThreadHeap);
+}
+
+size_t MemoryAccounting::GetHeapBytes(Heap heap)
+{
+  return heap < NumHeaps ? HeapBytes[heap].load(std::memory_order_relaxed) : 0;
+}
+
+#ifdef PULSE_EXPLORER_COUNT_ALLOCATIONS
+// Every allocation carries a header with its size and heap, so freeing it is counted against the heap it came from,
+// whichever thread frees it. The header is as big as malloc's alignment so the block handed out stays aligned.
+static const size_t HeaderBytes = alignof(std::max_align_t) < 16 ? 16 : alignof(std::max_align_t);
+
+static void* CountedAllocate(std::size_t size)
+{
+  char* block = static_cast<char*>(std::malloc(size + HeaderBytes));
+  if (block == nullptr)
+    return nullptr;
+  size_t* header = reinterpret_cast<size_t*>(block);
+  header[0] = size;
+  header[1] = size_t(ThreadHeap);
+  HeapBytes[ThreadHeap].fetch_add(size, std::memory_order_relaxed);
+  return block + HeaderBytes;
+}
+
+static void* CountedNew(std::size_t size)
+{
+  void* p;
+  while ((p = CountedAllocate(size)) == nullptr)
+  {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+  return p;
+}
+
+static void CountedFree(void* p)
+{
+  if (p == nullptr)
+    return;
+  char* block = static_cast<char*>(p) - HeaderBytes;
+  size_t* header = reinterpret_cast<size_t*>(block);
+  HeapBytes[header[1]].fetch_sub(header[0], std::memory_order_relaxed);
+  std::free(block);
+}
+
+void* operator new(std::size_t size) { return CountedNew(size); }
+void* operator new[](std::size_t size) { return CountedNew(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void operator delete(void* p) noexcept { CountedFree(p); }
+void operator delete[](void* p) noexcept { CountedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { CountedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { CountedFree(p); }
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* p, std::size_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { CountedFree(p); }
+#endif
+#endif
@@ -0,0 +1,56 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Bytes held by each part of the Explorer, so a process that keeps growing can be pinned on something.
+// Subsystems register a reporter of their current bytes, sampling asks every reporter and keeps
+// the high water mark of each, of their total and of the process resident set.
+// Built with PULSE_EXPLORER_COUNT_ALLOCATIONS, operator new and delete also keep a running count of the bytes
+// live on each heap, and threads say which heap they allocate on (i.e. the engine thread is the engine heap).
+class MemoryAccounting
+{
+public:
+  enum Heap { OtherHeap = 0, EngineHeap, BackgroundEngineHeap, NumHeaps };
+
+  // Parts add up to the totals, overlapping rows are bytes already in other rows (i.e. the engine heap holds the checkpoints)
+  enum Kind { Part = 0, Total, Overlapping };
+  struct Usage
+  {
+    std::string Name;
+    size_t      Bytes = 0;
+    size_t      HighWater = 0;
+    Kind        Type = Part;
+  };
+
+  // Reporters are called from whichever thread samples, they must be safe against their subsystem's own threads
+  // Give overlapping for bytes that other reporters also report, so they are left out of the total
+  static size_t Register(const std::string& name, std::function<size_t()> bytes, bool overlapping=false);
+  static void Unregister(size_t id);
+  // One row per part in the order they registered, then the total of them and the process resident set,
+  // then one row per overlapping reporter
+  static std::vector<Usage> Sample();
+  static void ResetHighWater();
+  static std::string ToString(const std::vector<Usage>& usage);
+  static std::string FormatBytes(size_t bytes);
+
+  static size_t GetResidentBytes();// 0 when the OS will not tell us
+
+  static bool IsCountingAllocations();
+  static void SetThreadHeap(Heap heap);
+  static Heap GetThreadHeap();
+  static size_t GetHeapBytes(Heap heap);// 0 unless counting
+
+  // Allocations on this thread go to heap until the scope ends
+  class HeapScope
+  {
+  public:
+    HeapScope(Heap heap) : m_Previous(GetThreadHeap()) { SetThreadHeap(heap); }
+    ~HeapScope() { SetThreadHeap(m_Previous); }
+  private:
+    Heap m_Previous;
+  };
+};
@@ -0,0 +1,119 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "MemoryAccountingWidget.h"
+
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <iostream>
+
+#include "LogWidget.h"
+#include "MemoryAccounting.h"
+
+static const int RefreshInterval_ms = 1000;
+static const int DefaultDumpInterval_s = 300;
+
+class MemoryAccountingWidget::Controls
+{
+public:
+  Controls(LogWidget& log) : LogBox(log) {}
+  LogWidget&    LogBox;
+  QTableWidget* Table;
+  QLabel*       Note;
+  QTimer        RefreshTimer;
+  QTimer        DumpTimer;
+
+  void SetCell(int row, int column, const QString& text, bool total)
+  {
+    QTableWidgetItem* item = Table->item(row, column);
+    if (item == nullptr)
+    {
+      item = new QTableWidgetItem();
+      item->setTextAlignment(column == 0 ? Qt::AlignLeft | Qt::AlignVCenter : Qt::AlignRight | Qt::AlignVCenter);
+      Table->setItem(row, column, item);
+    }
+    item->setText(text);
+    QFont font = item->font();
+    font.setBold(total);
+    item->setFont(font);
+  }
+};
+
+MemoryAccountingWidget::MemoryAccountingWidget(LogWidget& log, QWidget *parent, Qt::WindowFlags flags) : QDockWidget(parent, flags)
+{
+  m_Controls = new Controls(log);
+  setWindowTitle("Memory");
+
+  QWidget* contents = new QWidget(this);
+  QVBoxLayout* layout = new QVBoxLayout(contents);
+  m_Controls->Table = new QTableWidget(0, 3, contents);
+  m_Controls->Table->setHorizontalHeaderLabels(QStringList() << "Subsystem" << "Current" << "High Water");
+  m_Controls->Table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+  m_Controls->Table->verticalHeader()->setVisible(false);
+  m_Controls->Table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  m_Controls->Table->setSelectionMode(QAbstractItemView::NoSelection);
+  layout->addWidget(m_Controls->Table);
+
+  QHBoxLayout* buttons = new QHBoxLayout();
+  m_Controls->Note = new QLabel(contents);
+  if (!MemoryAccounting::IsCountingAllocations())
+    m_Controls->Note->setText("Engine heaps are counted in builds with PULSE_EXPLORER_COUNT_ALLOCATIONS");
+  buttons->addWidget(m_Controls->Note, 1);
+  QPushButton* reset = new QPushButton("Reset High Water", contents);
+  QPushButton* dump = new QPushButton("Dump", contents);
+  buttons->addWidget(reset);
+  buttons->addWidget(dump);
+  layout->addLayout(buttons);
+  setWidget(contents);
+
+  connect(reset, SIGNAL(clicked()), SLOT(ResetHighWater()));
+  connect(dump, SIGNAL(clicked()), SLOT(Dump()));
+  connect(&m_Controls->RefreshTimer, SIGNAL(timeout()), SLOT(Refresh()));
+  connect(&m_Controls->DumpTimer, SIGNAL(timeout()), SLOT(Dump()));
+  m_Controls->RefreshTimer.start(RefreshInterval_ms);
+
+  bool ok = false;
+  int dump_s = qEnvironmentVariableIntValue("PULSE_EXPLORER_MEMORY_DUMP_S", &ok);
+  if (!ok)
+    dump_s = DefaultDumpInterval_s;
+  if (dump_s > 0)
+    m_Controls->DumpTimer.start(dump_s * 1000);
+}
+
+MemoryAccountingWidget::~MemoryAccountingWidget()
+{
+  delete m_Controls;
+}
+
+void MemoryAccountingWidget::Refresh()
+{
+  // High water marks are only as good as the sampling, keep sampling while hidden
+  std::vector<MemoryAccounting::Usage> usage = MemoryAccounting::Sample();
+  if (!isVisible())
+    return;
+  m_Controls->Table->setRowCount(int(usage.size()));
+  for (size_t i = 0; i < usage.size(); i++)
+  {
+    bool total = usage[i].Type == MemoryAccounting::Total;// Accounted for, and the process
+    m_Controls->SetCell(int(i), 0, QString::fromStdString(usage[i].Name), total);
+    m_Controls->SetCell(int(i), 1, QString::fromStdString(MemoryAccounting::FormatBytes(usage[i].Bytes)), total);
+    m_Controls->SetCell(int(i), 2, QString::fromStdString(MemoryAccounting::FormatBytes(usage[i].HighWater)), total);
+  }
+}
+
+void MemoryAccountingWidget::ResetHighWater()
+{
+  MemoryAccounting::ResetHighWater();
+  Refresh();
+}
+
+void MemoryAccountingWidget::Dump()
+{
+  std::string table = MemoryAccounting::ToString(MemoryAccounting::Sample());
+  std::cout << table << std::endl;
+  m_Controls->LogBox.Append(table.c_str(), LogSeverity::Debug, "Memory");
+}
@@ -0,0 +1,27 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QObject>
+#include <QDockWidget>
+class LogWidget;
+
+// What each subsystem registered with MemoryAccounting holds now and at most, refreshed every second while shown.
+// The same table is written to stdout and the log every dump period (PULSE_EXPLORER_MEMORY_DUMP_S, 300s by default, 0 for never)
+class MemoryAccountingWidget : public QDockWidget
+{
+  Q_OBJECT
+public:
+  MemoryAccountingWidget(LogWidget& log, QWidget *parent = Q_NULLPTR, Qt::WindowFlags flags = Qt::WindowFlags());
+  virtual ~MemoryAccountingWidget();
+
+public slots:
+  void Dump();
+protected slots:
+  void Refresh();
+  void ResetHighWater();
+
+private:
+  class Controls;
+  Controls* m_Controls;
+};
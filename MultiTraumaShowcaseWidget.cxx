@@ -19,6 +19,23 @@
 #include "cdm/patient/actions/SETensionPneumothorax.h"
 #include "cdm/patient/actions/SENeedleDecompression.h"
 
+static void ProcessTourniquet(PhysiologyEngine& pulse)
+{
+  SEHemorrhage hemorrhage;
+  hemorrhage.GetRate().SetValue(0, VolumePerTimeUnit::mL_Per_min);
+  hemorrhage.SetCompartment(pulse::VascularCompartment::RightLeg);
+  pulse.ProcessAction(hemorrhage);
+}
+
+static void ProcessSalineInfusion(PhysiologyEngine& pulse)
+{
+  const SESubstanceCompound* Saline = pulse.GetSubstanceManager().GetCompound("Saline");
+  SESubstanceCompoundInfusion   SalineInfusion(*Saline);
+  SalineInfusion.GetBagVolume().SetValue(500, VolumeUnit::mL);
+  SalineInfusion.GetRate().SetValue(100, VolumePerTimeUnit::mL_Per_min);
+  pulse.ProcessAction(SalineInfusion);
+}
+
 class MultiTraumaShowcaseWidget::Controls : public Ui::MultiTraumaShowcaseWidget
 {
 public:
@@ -51,6 +68,8 @@ MultiTraumaShowcaseWidget::MultiTraumaShowcaseWidget(QPulse& qp, QWidget *parent
   connect(m_Controls->ApplyTournyButton, SIGNAL(clicked()), this, SLOT(ApplyTourniquet()));
   connect(m_Controls->InfuseSalineButton, SIGNAL(clicked()), this, SLOT(InfuseSaline()));
   connect(m_Controls->InjectMorphineButton, SIGNAL(clicked()), this, SLOT(InjectMorphine()));
+  connect(m_Controls->PreviewTournyButton, SIGNAL(clicked()), this, SLOT(PreviewTourniquet()));
+  connect(m_Controls->PreviewSalineButton, SIGNAL(clicked()), this, SLOT(PreviewSaline()));
 }
 
 MultiTraumaShowcaseWidget::~MultiTraumaShowcaseWidget()
@@ -81,10 +100,12 @@ void MultiTraumaShowcaseWidget::ConfigurePulse(PhysiologyEngine& pulse, SEDataRe
   m_Controls->ApplyTournyButton->setEnabled(false);
   m_Controls->InfuseSalineButton->setEnabled(false);
   m_Controls->InjectMorphineButton->setEnabled(false);
+  m_Controls->PreviewTournyButton->setEnabled(false);
+  m_Controls->PreviewSalineButton->setEnabled(false);
 
   if(!pulse.LoadStateFile("states/Soldier@0s.pba"))
     throw CommonDataModelException("Unable to load state file");
-  m_Controls->Pulse.GetLogBox().append("Combining the tension pneumothorax with the blood loss from the hemorrhage pushes and eventually exceeds the limits of the homeostatic control mechanisms.");
+  m_Controls->Pulse.GetLogBox().Append("Combining the tension pneumothorax with the blood loss from the hemorrhage pushes and eventually exceeds the limits of the homeostatic control mechanisms.");
   m_Controls->Pulse.ScrollLogBox();
   // Fill out any data requsts that we want to have plotted
   drMgr.CreatePhysiologyDataRequest("BloodVolume", VolumeUnit::L);
@@ -137,20 +158,13 @@ void MultiTraumaShowcaseWidget::ProcessPhysiology(PhysiologyEngine& pulse)
   if (m_Controls->ApplyTourniquet)
   {
     m_Controls->ApplyTourniquet = false;
-    SEHemorrhage hemorrhage;
-    hemorrhage.GetRate().SetValue(0,VolumePerTimeUnit::mL_Per_min);
-    hemorrhage.SetCompartment(pulse::VascularCompartment::RightLeg);
-    pulse.ProcessAction(hemorrhage);
+    ProcessTourniquet(pulse);
   }
 
   if (m_Controls->InfuseSaline)
   {
     m_Controls->InfuseSaline = false;
-    const SESubstanceCompound* Saline = pulse.GetSubstanceManager().GetCompound("Saline");
-    SESubstanceCompoundInfusion   SalineInfusion(*Saline);
-    SalineInfusion.GetBagVolume().SetValue(500, VolumeUnit::mL);
-    SalineInfusion.GetRate().SetValue(100, VolumePerTimeUnit::mL_Per_min);
-    pulse.ProcessAction(SalineInfusion);
+    ProcessSalineInfusion(pulse);
   }
 
   if (m_Controls->InjectMorphine)
@@ -174,7 +188,7 @@ void MultiTraumaShowcaseWidget::ApplyHemorrhage()
   m_Controls->ApplyHemorrhageButton->setDisabled(true);
   m_Controls->FlowRateEdit->setDisabled(true);
   m_Controls->ApplyPressureButton->setEnabled(true);
-  m_Controls->Pulse.GetLogBox().append("Applying hemorrhage");
+  m_Controls->Pulse.GetLogBox().Append("Applying hemorrhage");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -189,7 +203,7 @@ void MultiTraumaShowcaseWidget::ApplyPneumothorax()
   m_Controls->SeveritySlider->setDisabled(true);
   m_Controls->PneumothoraxTypeCombo->setDisabled(true);
   m_Controls->NeedleDecompressButton->setEnabled(true);
-  m_Controls->Pulse.GetLogBox().append("Applying Pneumothorax");
+  m_Controls->Pulse.GetLogBox().Append("Applying Pneumothorax");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -200,7 +214,8 @@ void MultiTraumaShowcaseWidget::ApplyPressure()
   m_Controls->ApplyPressure = true;
   m_Controls->ApplyPressureButton->setDisabled(true);
   m_Controls->ApplyTournyButton->setEnabled(true);
-  m_Controls->Pulse.GetLogBox().append("Applying pressure to the wound");
+  m_Controls->PreviewTournyButton->setEnabled(true);
+  m_Controls->Pulse.GetLogBox().Append("Applying pressure to the wound");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -210,7 +225,7 @@ void MultiTraumaShowcaseWidget::ApplyNeedleDecompression()
   m_Controls->Mutex.lock();
   m_Controls->ApplyNeedleDecompression = true;
   m_Controls->NeedleDecompressButton->setEnabled(false);
-  m_Controls->Pulse.GetLogBox().append("Applying Needle Decompression");
+  m_Controls->Pulse.GetLogBox().Append("Applying Needle Decompression");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -220,9 +235,11 @@ void MultiTraumaShowcaseWidget::ApplyTourniquet()
   m_Controls->Mutex.lock();
   m_Controls->ApplyTourniquet = true;
   m_Controls->ApplyTournyButton->setEnabled(false);
+  m_Controls->PreviewTournyButton->setEnabled(false);
   m_Controls->InfuseSalineButton->setEnabled(true);
+  m_Controls->PreviewSalineButton->setEnabled(true);
   m_Controls->InjectMorphineButton->setEnabled(true);
-  m_Controls->Pulse.GetLogBox().append("Applying Tourniquet");
+  m_Controls->Pulse.GetLogBox().Append("Applying Tourniquet");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -232,7 +249,8 @@ void MultiTraumaShowcaseWidget::InfuseSaline()
   m_Controls->Mutex.lock();
   m_Controls->InfuseSaline = true;
   m_Controls->InfuseSalineButton->setEnabled(false);
-  m_Controls->Pulse.GetLogBox().append("Infusing saline");
+  m_Controls->PreviewSalineButton->setEnabled(false);
+  m_Controls->Pulse.GetLogBox().Append("Infusing saline");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
@@ -242,7 +260,21 @@ void MultiTraumaShowcaseWidget::InjectMorphine()
   m_Controls->Mutex.lock();
   m_Controls->InjectMorphine = true;
   m_Controls->InjectMorphineButton->setEnabled(false);
-  m_Controls->Pulse.GetLogBox().append("Injecting a bolus of morphine");
+  m_Controls->Pulse.GetLogBox().Append("Injecting a bolus of morphine");
   m_Controls->Pulse.ScrollLogBox();
   m_Controls->Mutex.unlock();
 }
+
+void MultiTraumaShowcaseWidget::PreviewTourniquet()
+{
+  m_Controls->Pulse.GetLogBox().Append("Predicting the next 5 minutes with and without a tourniquet");
+  m_Controls->Pulse.ScrollLogBox();
+  m_Controls->Pulse.Predict("a tourniquet", ProcessTourniquet);
+}
+
+void MultiTraumaShowcaseWidget::PreviewSaline()
+{
+  m_Controls->Pulse.GetLogBox().Append("Predicting the next 5 minutes with and without a saline infusion");
+  m_Controls->Pulse.ScrollLogBox();
+  m_Controls->Pulse.Predict("a saline infusion", ProcessSalineInfusion);
+}
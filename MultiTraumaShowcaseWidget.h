@@ -19,6 +19,7 @@ public:
 
   void ConfigurePulse(PhysiologyEngine& pulse, SEDataRequestManager& drMgr);
   void ProcessPhysiology(PhysiologyEngine& pulse);
+  bool IsPulseDriver() const { return true; }
 
 signals:
 protected slots:
@@ -29,6 +30,8 @@ protected slots:
   void ApplyTourniquet();
   void InfuseSaline();
   void InjectMorphine();
+  void PreviewTourniquet();
+  void PreviewSaline();
 
 private:
   class Controls;
@@ -0,0 +1,76 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "OverloadGovernor.h"
+
+#include <cmath>
+
+OverloadGovernor::OverloadGovernor()
+{
+  Reset();
+}
+
+void OverloadGovernor::Reset()
+{
+  Level = OverloadLevel::None;
+  Load = 0;
+  Lag_s = 0;
+  Last_s = -1;
+  Since_s = -1;
+  Overloaded = false;
+}
+
+bool OverloadGovernor::Update(double wall_s, double busy_s, double budget_s, double late_s)
+{
+  if (budget_s <= 0)
+    return false;
+  // Exponential averages, weighted by how much wall time passed
+  double dt = Last_s < 0 ? Smoothing_s : wall_s - Last_s;
+  double w = 1 - std::exp(-dt / Smoothing_s);
+  Load += w * (busy_s / budget_s - Load);
+  Lag_s += w * (late_s - Lag_s);
+  Last_s = wall_s;
+
+  bool overloaded = Load > HighLoad || Lag_s > MaxLag_s;
+  bool headroom = Load < LowLoad && Lag_s < budget_s;
+  if (!overloaded && !headroom)
+  {// In between, keep what we have
+    Since_s = -1;
+    return false;
+  }
+  if (Since_s < 0 || overloaded != Overloaded)
+  {
+    Since_s = wall_s;
+    Overloaded = overloaded;
+  }
+  if (overloaded && Level != OverloadLevel::Notified && wall_s - Since_s >= Escalate_s)
+  {
+    Level = OverloadLevel(int(Level) + 1);
+    Since_s = wall_s;
+    return true;
+  }
+  if (headroom && Level != OverloadLevel::None && wall_s - Since_s >= Recover_s)
+  {
+    Level = OverloadLevel(int(Level) - 1);
+    Since_s = wall_s;
+    return true;
+  }
+  return false;
+}
+
+std::string OverloadGovernor::ToString(OverloadLevel level)
+{
+  switch (level)
+  {
+  case OverloadLevel::None:
+    return "Keeping up with real time";
+  case OverloadLevel::ReducedRefresh:
+    return "Behind real time, refreshing the UI less often";
+  case OverloadLevel::DecimatedCharts:
+    return "Behind real time, charts show fewer samples";
+  case OverloadLevel::Paused3D:
+    return "Behind real time, 3D view paused";
+  case OverloadLevel::Notified:
+    return "Unable to keep up with real time";
+  }
+  return "";
+}
@@ -0,0 +1,51 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+
+// How much the UI gives up so the engine can keep up with real time, each level includes the ones before it
+enum class OverloadLevel
+{
+  None = 0,
+  ReducedRefresh,  // Refresh the UI less often
+  DecimatedCharts, // Only append every few samples to the charts
+  Paused3D,        // Stop rendering the 3D view
+  Notified         // Nothing left to give, tell the user
+};
+
+// Decides the overload level from how busy the engine thread is stepping in real time.
+// The load (time spent on a step over the step size) and the lag behind schedule are smoothed,
+// a level is only added after being overloaded for a while, and only given back after a longer run of headroom.
+class OverloadGovernor
+{
+public:
+  OverloadGovernor();
+
+  // Back to no overload, i.e. when not running in real time
+  void Reset();
+  // Call after every realtime step (or batch of steps), with how long it took and how late it started
+  // Returns true if the level changed
+  bool Update(double wall_s, double busy_s, double budget_s, double late_s);
+
+  OverloadLevel GetLevel() const { return Level; }
+  double GetLoad() const { return Load; }
+  double GetLag_s() const { return Lag_s; }
+
+  static std::string ToString(OverloadLevel level);
+
+  double HighLoad = 0.95;   // Overloaded past this load
+  double MaxLag_s = 0.1;    // or this far behind
+  double LowLoad = 0.7;     // Headroom under this load, and less than a step behind
+  double Escalate_s = 2;    // Overloaded this long before adding a level
+  double Recover_s = 5;     // Headroom this long before giving a level back
+  double Smoothing_s = 1;   // Time constant of the load and lag averages
+
+private:
+  OverloadLevel Level;
+  double        Load;
+  double        Lag_s;
+  double        Last_s;
+  double        Since_s;// When the current run of overload or headroom started, -1 if neither
+  bool          Overloaded;
+};
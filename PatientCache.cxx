@@ -0,0 +1,185 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "PatientCache.h"
+#include "MemoryAccounting.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+#include "cdm/CommonDataModel.h"
+#include "PulsePhysiologyEngine.h"
+#include "cdm/engine/SEAdvanceHandler.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+
+// Part of every key, bump it when the way states are made changes so old entries are left behind
+static const char* CacheVersion = "PatientCache 1";
+// Also part of every key, states are not portable between Pulse versions (or even builds), see CMakeLists.txt
+#ifndef PULSE_EXPLORER_PULSE_BUILD
+  #define PULSE_EXPLORER_PULSE_BUILD "unknown"
+#endif
+
+// Readers see the old file or the new one, never neither
+static bool ReplaceFile(const QString& from, const QString& to)
+{
+#ifdef _WIN32
+  return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()),
+                     reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return std::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
+
+// Reports stabilization progress, and is the only way to stop a stabilization early
+class StabilizationProgress : public SEAdvanceHandler
+{
+public:
+  StabilizationProgress(PatientCache& cache, std::atomic<bool>& cancel) : SEAdvanceHandler(true), Cache(cache), Cancel(cancel) {}
+  virtual ~StabilizationProgress() {}
+
+  virtual void OnAdvance(double time_s, const PhysiologyEngine& engine)
+  {
+    if (Cancel)
+      throw CommonDataModelException("Stabilization cancelled");
+    // Plenty for a progress readout
+    if (time_s - Reported_s >= 1)
+    {
+      Reported_s = time_s;
+      emit Cache.Progress(time_s);
+    }
+  }
+
+  PatientCache&      Cache;
+  std::atomic<bool>& Cancel;
+  double             Reported_s = 0;
+};
+
+class PatientCache::Controls
+{
+public:
+  QString            Directory;
+  std::thread        Worker;
+  std::atomic<bool>  Running;
+  std::atomic<bool>  Cancel;
+
+  QString GetStateFile(const QString& key) const
+  {
+    return Directory + "/" + key + ".pba";
+  }
+
+  void Join()
+  {
+    if (Worker.joinable())
+      Worker.join();
+  }
+};
+
+PatientCache::PatientCache(QObject* parent) : QObject(parent)
+{
+  m_Controls = new Controls();
+  m_Controls->Running = false;
+  m_Controls->Cancel = false;
+  m_Controls->Directory = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/PulseExplorer/patients";
+}
+
+PatientCache::~PatientCache()
+{
+  Cancel();
+  m_Controls->Join();
+  delete m_Controls;
+}
+
+void PatientCache::SetDirectory(const QString& dir)
+{
+  m_Controls->Directory = dir;
+}
+
+const QString& PatientCache::GetDirectory() const
+{
+  return m_Controls->Directory;
+}
+
+QString PatientCache::GetKey(const QByteArray& patient)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(CacheVersion);
+  hash.addData(PULSE_EXPLORER_PULSE_BUILD);
+  hash.addData(patient);
+  return QString(hash.result().toHex());
+}
+
+QString PatientCache::Find(const QString& patient_file) const
+{
+  QFile file(patient_file);
+  if (!file.open(QIODevice::ReadOnly))
+    return "";
+  QString state = m_Controls->GetStateFile(GetKey(file.readAll()));
+  return QFileInfo(state).exists() ? state : "";
+}
+
+bool PatientCache::IsStabilizing() const
+{
+  return m_Controls->Running;
+}
+
+void PatientCache::Cancel()
+{
+  m_Controls->Cancel = true;
+}
+
+bool PatientCache::Stabilize(const QString& patient_file)
+{
+  if (m_Controls->Running)
+    return false;
+  QFile file(patient_file);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  QString state = m_Controls->GetStateFile(GetKey(file.readAll()));
+  QDir().mkpath(m_Controls->Directory);
+
+  m_Controls->Join();
+  m_Controls->Cancel = false;
+  m_Controls->Running = true;
+  std::string patient = patient_file.toStdString();
+  m_Controls->Worker = std::thread([this, patient, state]()
+  {
+    MemoryAccounting::SetThreadHeap(MemoryAccounting::BackgroundEngineHeap);
+    Controls& c = *m_Controls;
+    // Written next to the entry and renamed into place, so a session never sees half a state
+    // and two sessions stabilizing the same patient do not trip over each other
+    QString partial = state + "." + QString::number(QCoreApplication::applicationPid()) + ".part";
+    bool ok = false;
+    std::unique_ptr<PhysiologyEngine> pulse = CreatePulseEngine((c.Directory + "/Stabilization.log").toStdString());
+    StabilizationProgress progress(*this, c.Cancel);
+    pulse->SetAdvanceHandler(&progress);
+    try
+    {
+      if (pulse->InitializeEngine(patient))
+      {
+        pulse->SetAdvanceHandler(nullptr);
+        ok = pulse->SaveState(partial.toStdString()) != nullptr;
+      }
+    }
+    catch (...)
+    {
+      ok = false;
+    }
+    pulse->SetAdvanceHandler(nullptr);
+    if (ok)// Someone else may have finished first, theirs is just as good
+      ok = ReplaceFile(partial, state);
+    QFile::remove(partial);
+    c.Running = false;
+    emit Stabilized(ok ? state : QString());
+  });
+  return true;
+}
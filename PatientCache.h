@@ -0,0 +1,40 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+// Stabilized engine states of patient files, kept on disk and shared by every session on this machine.
+// A patient is looked up by a hash of its file contents and the Pulse build, so editing the file
+// or updating Pulse makes a new entry (states are not portable between Pulse versions).
+// Stabilizing a patient the cache has not seen runs on a background thread, as it takes minutes.
+class PatientCache : public QObject
+{
+  Q_OBJECT
+public:
+  PatientCache(QObject* parent = Q_NULLPTR);
+  virtual ~PatientCache();// Cancels any stabilization
+
+  // Defaults to PulseExplorer/patients in the user's cache location
+  void SetDirectory(const QString& dir);
+  const QString& GetDirectory() const;
+
+  static QString GetKey(const QByteArray& patient);
+  // State file for this patient file, empty if it is not in the cache
+  QString Find(const QString& patient_file) const;
+
+  // Stabilize the patient in the background and add it to the cache, Stabilized is emitted when done
+  // Returns false if the file cannot be read or a patient is already being stabilized
+  bool Stabilize(const QString& patient_file);
+  bool IsStabilizing() const;
+  void Cancel();
+
+signals:
+  void Progress(double stabilized_s);// Simulated seconds of stabilization so far
+  void Stabilized(QString state_file);// Empty if stabilization failed or was cancelled
+
+private:
+  class Controls;
+  Controls* m_Controls;
+};
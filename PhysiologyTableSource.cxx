@@ -0,0 +1,94 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "PhysiologyTableSource.h"
+#include "QPulsePlot.h"
+
+#include <algorithm>
+
+#include <pqApplicationCore.h>
+#include <pqObjectBuilder.h>
+#include <pqPipelineSource.h>
+
+#include <vtkDoubleArray.h>
+#include <vtkPVTrivialProducer.h>
+#include <vtkSMProxy.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+class PhysiologyTableSource::Data
+{
+public:
+  pqPipelineSource*                           Source = nullptr;
+  vtkPVTrivialProducer*                       Producer = nullptr;
+  vtkSmartPointer<vtkTable>                   Table;
+  std::vector<vtkSmartPointer<vtkDoubleArray>> Columns;// Time is column 0
+};
+
+PhysiologyTableSource::PhysiologyTableSource(pqServer* server)
+{
+  m_Data = new PhysiologyTableSource::Data();
+  m_Data->Table = vtkSmartPointer<vtkTable>::New();
+  m_Data->Source = pqApplicationCore::instance()->getObjectBuilder()->createSource("sources", "PVTrivialProducer", server);
+  if (m_Data->Source == nullptr)
+    return;
+  m_Data->Source->rename("Pulse Physiology");
+  m_Data->Producer = vtkPVTrivialProducer::SafeDownCast(m_Data->Source->getProxy()->GetClientSideObject());
+  if (m_Data->Producer != nullptr)
+    m_Data->Producer->SetOutput(m_Data->Table);
+}
+
+PhysiologyTableSource::~PhysiologyTableSource()
+{
+  if (m_Data->Source != nullptr)
+    pqApplicationCore::instance()->getObjectBuilder()->destroy(m_Data->Source);
+  delete m_Data;
+}
+
+pqPipelineSource* PhysiologyTableSource::GetSource()
+{
+  return m_Data->Source;
+}
+
+void PhysiologyTableSource::SetColumns(const std::vector<std::string>& names)
+{
+  m_Data->Table->Initialize();
+  m_Data->Columns.clear();
+  if (names.empty())
+    return;
+  std::vector<std::string> columns;
+  columns.push_back("Time(s)");
+  columns.insert(columns.end(), names.begin(), names.end());
+  for (const std::string& name : columns)
+  {
+    vtkSmartPointer<vtkDoubleArray> column = vtkSmartPointer<vtkDoubleArray>::New();
+    column->SetName(name.c_str());
+    m_Data->Table->AddColumn(column);
+    m_Data->Columns.push_back(column);
+  }
+}
+
+void PhysiologyTableSource::Update(const std::vector<QPulsePlot*>& plots)
+{
+  if (plots.empty() || m_Data->Columns.size() != plots.size() + 1)
+    return;
+  size_t rows = plots[0]->GetNumberOfSamples();
+  for (QPulsePlot* plot : plots)
+    rows = std::min(rows, plot->GetNumberOfSamples());
+
+  // The plot windows are moved (and cleared) by the engine thread while ParaView reads the table on the UI thread,
+  // so the table gets its own copy of them, the columns only reallocate when the window grows
+  size_t offset = plots[0]->GetNumberOfSamples() - rows;
+  m_Data->Columns[0]->SetNumberOfValues(vtkIdType(rows));
+  std::copy(plots[0]->GetTimes() + offset, plots[0]->GetTimes() + offset + rows, m_Data->Columns[0]->GetPointer(0));
+  for (size_t i = 0; i < plots.size(); i++)
+  {
+    offset = plots[i]->GetNumberOfSamples() - rows;
+    m_Data->Columns[i + 1]->SetNumberOfValues(vtkIdType(rows));
+    std::copy(plots[i]->GetValues() + offset, plots[i]->GetValues() + offset + rows, m_Data->Columns[i + 1]->GetPointer(0));
+  }
+  m_Data->Table->Modified();
+  if (m_Data->Producer != nullptr)
+    m_Data->Producer->Modified();
+  if (m_Data->Source != nullptr)
+    m_Data->Source->getProxy()->MarkModified(m_Data->Source->getProxy());
+}
@@ -0,0 +1,33 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+class pqPipelineSource;
+class pqServer;
+class QPulsePlot;
+
+// Puts the data request plot samples into the ParaView pipeline as a vtkTable source ("Pulse Physiology"),
+// so any ParaView filter or view can work on the live physiology.
+// Each Update copies the plot sample windows into columns the table owns, as the engine thread keeps moving the windows.
+// Call Update once per UI refresh, with the same lock held that guards the plots.
+// The table lives on the client, so it only has data when running with the builtin server.
+class PhysiologyTableSource
+{
+public:
+  PhysiologyTableSource(pqServer* server);
+  virtual ~PhysiologyTableSource();
+
+  // The time column is added for you, one column per plot
+  void SetColumns(const std::vector<std::string>& names);
+  // Copy the current plot windows into the columns and mark the source modified
+  void Update(const std::vector<QPulsePlot*>& plots);
+
+  pqPipelineSource* GetSource();
+
+private:
+  class Data;
+  Data* m_Data;
+};
@@ -2,7 +2,7 @@
 #include <QThread>
 #include <QPointer>
 #include <QCoreApplication>
-#include <QScrollBar>
+#include <QMutex>
 
 #include "cdm/CommonDataModel.h"
 #include "PulsePhysiologyEngine.h"
@@ -13,6 +13,11 @@
 #include "cdm/system/physiology/SECardiovascularSystem.h"
 #include "cdm/system/physiology/SEBloodChemistrySystem.h"
 #include "cdm/system/physiology/SERespiratorySystem.h"
+#include "cdm/system/physiology/SEEnergySystem.h"
+#include "cdm/system/equipment/electrocardiogram/SEElectroCardioGram.h"
+#include "cdm/compartment/SECompartmentManager.h"
+#include "cdm/compartment/fluid/SEGasCompartment.h"
+#include "cdm/compartment/substances/SEGasSubstanceQuantity.h"
 #include "cdm/patient/actions/SECardiacArrest.h"
 #include "cdm/patient/actions/SEAirwayObstruction.h"
 #include "cdm/CommonDataModel.h"
@@ -23,19 +28,35 @@
 #include "cdm/properties/SEScalarMass.h"
 #include "cdm/properties/SEScalarMassPerVolume.h"
 #include "cdm/properties/SEScalarFrequency.h"
+#include "cdm/properties/SEScalarPressure.h"
+#include "cdm/properties/SEScalarElectricPotential.h"
+#include "cdm/properties/SEScalarTemperature.h"
 #include "cdm/properties/SEFunctionElectricPotentialVsTime.h"
 #include "cdm/substance/SESubstance.h"
 #include "cdm/substance/SESubstanceManager.h"
 #include "cdm/patient/actions/SESubstanceBolus.h"
 #include "cdm/utils/TimingProfile.h"
+#include "StateCheckpointRing.h"
+#include "WhatIfPredictor.h"
+#include "VitalsBroadcaster.h"
+#include "RealtimeThread.h"
+#include "MemoryAccounting.h"
+#include <google/protobuf/message.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <sstream>
 #include <thread>
 
 class LoggerForward2Qt : public LoggerForward
 {
 public:
-  LoggerForward2Qt(QTextEdit& log) : ExplorerLog(log) {}
+  LoggerForward2Qt(LogWidget& log) : ExplorerLog(log) {}
   virtual ~LoggerForward2Qt() {}
-  virtual void ForwardDebug(const std::string& msg, const std::string& origin) { ExplorerLog.append(QString(msg.c_str())); ScrollLogBox(); }
+  // Called on the engine thread, the log widget queues these up until its next refresh
+  // and keeps following the newest record unless the user scrolled up
+  virtual void ForwardDebug(const std::string& msg, const std::string& origin) { Forward(msg, LogSeverity::Debug, origin); }
   virtual void ForwardInfo(const std::string& msg, const std::string& origin)
   { 
     for (std::string str : IgnoreActions)
@@ -43,29 +64,53 @@ public:
       if (msg.find(str) != str.npos)
         return;
     }
-    ExplorerLog.append(QString(msg.c_str()));
-    ScrollLogBox();
+    Forward(msg, LogSeverity::Info, origin);
+  }
+  virtual void ForwardWarning(const std::string& msg, const std::string& origin) { Forward(msg, LogSeverity::Warning, origin); }
+  virtual void ForwardError(const std::string& msg, const std::string& origin)   { Forward(msg, LogSeverity::Error, origin); }
+  virtual void ForwardFatal(const std::string& msg, const std::string& origin)   { Forward(msg, LogSeverity::Fatal, origin); }
+
+  void Forward(const std::string& msg, LogSeverity severity, const std::string& origin)
+  {
+    ExplorerLog.Append(QString(msg.c_str()), severity, QString(origin.c_str()));
   }
-  virtual void ForwardWarning(const std::string& msg, const std::string& origin) { ExplorerLog.append(QString(msg.c_str())); ScrollLogBox(); }
-  virtual void ForwardError(const std::string& msg, const std::string& origin)   { ExplorerLog.append(QString(msg.c_str())); ScrollLogBox(); }
-  virtual void ForwardFatal(const std::string& msg, const std::string& origin)   { ExplorerLog.append(QString(msg.c_str())); ScrollLogBox(); }
 
   void ScrollLogBox()
   {
-    QScrollBar *sb = ExplorerLog.verticalScrollBar();
-    sb->setValue(sb->maximum());
-    ExplorerLog.update();
+    ExplorerLog.ScrollToBottom();
   }
 
-  QTextEdit& ExplorerLog;
+  LogWidget& ExplorerLog;
   std::vector<std::string> IgnoreActions;
 };
 
+// What we broadcast every step, the scale is the quantization steps per unit on the wire
+static std::vector<VitalsChannel> BroadcastChannels()
+{
+  std::vector<VitalsChannel> channels;
+  channels.push_back({ "HeartRate(1/min)", 10 });
+  channels.push_back({ "Lead3ElectricPotential(mV)", 10000 });
+  channels.push_back({ "ArterialPressure(mmHg)", 100 });
+  channels.push_back({ "MeanArterialPressure(mmHg)", 10 });
+  channels.push_back({ "SystolicArterialPressure(mmHg)", 10 });
+  channels.push_back({ "DiastolicArterialPressure(mmHg)", 10 });
+  channels.push_back({ "OxygenSaturation", 10000 });
+  channels.push_back({ "RespirationRate(1/min)", 10 });
+  channels.push_back({ "EndTidalCarbonDioxidePressure(mmHg)", 10 });
+  channels.push_back({ "CoreTemperature(degC)", 100 });
+  channels.push_back({ "CarinaCarbonDioxidePartialPressure(mmHg)", 100 });
+  return channels;
+}
+
+// Most steps the engine takes without checking for stop, pause, rewind or prediction requests
+static const size_t MaxBatchSteps = 50;
+
 class QPulse::Controls
 {
 public:
-  Controls(QThread& thread, QTextEdit& log) : Thread(thread), Log2Qt(log)
+  Controls(QThread& thread, LogWidget& log) : Thread(thread), Log2Qt(log), Broadcaster(BroadcastChannels())
   {
+    MemoryAccounting::HeapScope heap(MemoryAccounting::EngineHeap);
     Pulse = CreatePulseEngine("PulseExplorer.log");
     Pulse->GetLogger()->SetForward(&Log2Qt);
     Pulse->GetLogger()->SetLogLevel(log4cpp::Priority::INFO);
@@ -82,15 +127,262 @@ public:
   bool                              Running=false;
   bool                              Paused=false;
   bool                              RunInRealtime=true;
+  bool                              RealtimeMode=false;
+  RealtimeSettings                  Realtime;
+  StepJitterHistogram               Jitter;
+  OverloadGovernor                  Governor;// Engine thread only
+  std::atomic<int>                  Overload;// Level the engine thread decided on
+  OverloadLevel                     ListenersOverload = OverloadLevel::None;// Level the listeners were last told
   bool                              Advancing;
   double                            AdvanceStep_s;
   std::vector<PulseListener*>       Listeners;
+  std::vector<double>               ListenerPeriod_s;// 0 for every step
+  std::vector<double>               ListenerDue_s;
+  double                            NextDue_s = 0;
+
+  StateCheckpointRing               Checkpoints;
+  std::atomic<size_t>               CheckpointBytes;// Of the ring, for other threads to read
+  std::unique_ptr<google::protobuf::Message> StatePrototype;
+  double                            CheckpointInterval_s = 10;
+  double                            NextCheckpoint_s = 0;
+  std::atomic<double>               RewindTo_s;
+  std::atomic<double>               FastForwardTo_s;
+
+  WhatIfPredictor                   Predictor;
+  QMutex                            ForkMutex;
+  std::atomic<bool>                 ForkRequested;// Checked by the engine thread every step, the rest of the fork is under ForkMutex
+  std::string                       ForkName;
+  std::function<void(PhysiologyEngine&)> ForkIntervention;
+  double                            ForkHorizon_s;
+
+  VitalsBroadcaster                 Broadcaster;
+  SEGasSubstanceQuantity*           CarinaCO2 = nullptr;
+  double                            Vitals[11];
+
+  void Broadcast()
+  {
+    if (CarinaCO2 == nullptr)
+    {
+      SESubstance* CO2 = Pulse->GetSubstanceManager().GetSubstance("CarbonDioxide");
+      CarinaCO2 = Pulse->GetCompartments().GetGasCompartment(pulse::PulmonaryCompartment::Carina)->GetSubstanceQuantity(*CO2);
+    }
+    Vitals[0] = Pulse->GetCardiovascularSystem()->GetHeartRate(FrequencyUnit::Per_min);
+    Vitals[1] = Pulse->GetElectroCardioGram()->GetLead3ElectricPotential(ElectricPotentialUnit::mV);
+    Vitals[2] = Pulse->GetCardiovascularSystem()->GetArterialPressure(PressureUnit::mmHg);
+    Vitals[3] = Pulse->GetCardiovascularSystem()->GetMeanArterialPressure(PressureUnit::mmHg);
+    Vitals[4] = Pulse->GetCardiovascularSystem()->GetSystolicArterialPressure(PressureUnit::mmHg);
+    Vitals[5] = Pulse->GetCardiovascularSystem()->GetDiastolicArterialPressure(PressureUnit::mmHg);
+    Vitals[6] = Pulse->GetBloodChemistrySystem()->GetOxygenSaturation();
+    Vitals[7] = Pulse->GetRespiratorySystem()->GetRespirationRate(FrequencyUnit::Per_min);
+    Vitals[8] = Pulse->GetRespiratorySystem()->GetEndTidalCarbonDioxidePressure(PressureUnit::mmHg);
+    Vitals[9] = Pulse->GetEnergySystem()->GetCoreTemperature(TemperatureUnit::C);
+    Vitals[10] = CarinaCO2->GetPartialPressure(PressureUnit::mmHg);
+    Broadcaster.Publish(Pulse->GetSimulationTime(TimeUnit::s), Vitals);
+  }
+
+  void Fork(QPulse& qp)
+  {
+    ForkMutex.lock();
+    ForkRequested = false;
+    std::string name = ForkName;
+    std::function<void(PhysiologyEngine&)> intervention = ForkIntervention;
+    double horizon_s = ForkHorizon_s;
+    ForkMutex.unlock();
+
+    std::unique_ptr<google::protobuf::Message> state = Pulse->SaveState();
+    std::string bytes;
+    if (state == nullptr || !state->SerializeToString(&bytes))
+    {
+      Pulse->GetLogger()->Error("Unable to fork the engine state for " + name);
+      return;
+    }
+    // Sample the branches once a second, plenty for a 5 minute look ahead
+    if (!Predictor.Start(name, bytes, state->New(), intervention, horizon_s, 1.0, [&qp]() { emit qp.PredictionReady(); }))
+      Pulse->GetLogger()->Warning("A prediction is already running");
+  }
+
+  // Sleep till the step is due, then spin out the rest as sleeps tend to wake up late
+  void WaitUntil(std::chrono::steady_clock::time_point deadline)
+  {
+    if (RealtimeMode && Realtime.Spin_us > 0)
+    {
+      std::this_thread::sleep_until(deadline - std::chrono::microseconds((long long)Realtime.Spin_us));
+      while (std::chrono::steady_clock::now() < deadline);
+    }
+    else
+      std::this_thread::sleep_until(deadline);
+  }
+
+  // One engine step, seen by everyone that needs every step
+  void Step()
+  {
+    Pulse->AdvanceModelTime(AdvanceStep_s, TimeUnit::s);
+    // Before anyone looks at the step, a rewind runs the drivers on it again
+    if (CheckpointInterval_s > 0 && Pulse->GetSimulationTime(TimeUnit::s) >= NextCheckpoint_s - AdvanceStep_s / 2)
+      Checkpoint();
+    StepListeners();
+    if (Broadcaster.GetNumberOfClients() > 0)
+      Broadcast();
+  }
+
+  // Drivers and everyone's PulseStepped see the step just taken
+  void StepListeners()
+  {
+    for (PulseListener* l : Listeners)
+    {
+      if (l->IsPulseDriver())
+        l->ProcessPhysiology(*Pulse);
+      l->PulseStepped(*Pulse);
+    }
+  }
+
+  // Hand the engine to every listener that is due, drivers already saw it in Step
+  void ProcessPhysiology()
+  {
+    double time_s = Pulse->GetSimulationTime(TimeUnit::s);
+    NextDue_s = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < Listeners.size(); i++)
+    {
+      if (Listeners[i]->IsPulseDriver())
+        continue;
+      if (time_s >= ListenerDue_s[i] - AdvanceStep_s / 2)
+      {
+        Listeners[i]->ProcessPhysiology(*Pulse);
+        ListenerDue_s[i] += ListenerPeriod_s[i];
+        if (ListenerDue_s[i] < time_s + AdvanceStep_s / 2)
+          ListenerDue_s[i] = time_s + ListenerPeriod_s[i];// Fell behind, or every step
+      }
+      NextDue_s = std::min(NextDue_s, ListenerDue_s[i]);
+    }
+  }
+
+  void RunDrivers()
+  {
+    for (PulseListener* l : Listeners)
+    {
+      if (l->IsPulseDriver())
+        l->ProcessPhysiology(*Pulse);
+    }
+  }
+
+  // Step to until_s as fast as we can, only the drivers get to see the engine on the way
+  // Catching up after a rewind, the steps replace ones everyone already saw, so PulseStepped is called too
+  // (and the checkpoints are already there)
+  void RunUnattended(double until_s, bool rewound)
+  {
+    try {
+      while (Running && Pulse->GetSimulationTime(TimeUnit::s) < until_s - AdvanceStep_s / 2)
+      {
+        Pulse->AdvanceModelTime(AdvanceStep_s, TimeUnit::s);
+        if (rewound)
+          StepListeners();
+        else
+        {
+          if (CheckpointInterval_s > 0 && Pulse->GetSimulationTime(TimeUnit::s) >= NextCheckpoint_s - AdvanceStep_s / 2)
+            Checkpoint();
+          RunDrivers();
+        }
+      }
+    } catch (CommonDataModelException ex) {}
+  }
+
+  void FastForward(double time_s)
+  {
+    std::stringstream ss;
+    double from_s = Pulse->GetSimulationTime(TimeUnit::s);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RunUnattended(time_s, false);
+    // Everyone else missed the ride, the engine might as well have loaded a new state
+    CarinaCO2 = nullptr;
+    for (PulseListener* l : Listeners)
+    {
+      if (!l->IsPulseDriver())
+        l->PulseStateLoaded(*Pulse);
+    }
+    ScheduleListeners();
+    RunInRealtime = true;
+    ss << "Fast forwarded " << Pulse->GetSimulationTime(TimeUnit::s) - from_s << "s to "
+       << Pulse->GetSimulationTime(TimeUnit::s) << "s in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s";
+    Pulse->GetLogger()->Info(ss.str());
+  }
+
+  // Everyone is due on the next step, i.e. after the engine time jumped
+  void ScheduleListeners()
+  {
+    double time_s = Pulse->GetSimulationTime(TimeUnit::s);
+    ListenerDue_s.assign(Listeners.size(), time_s);
+    NextDue_s = time_s;
+  }
+
+  // Steps to run before a listener is due
+  size_t StepsUntilDue()
+  {
+    double time_s = Pulse->GetSimulationTime(TimeUnit::s);
+    double until_s = NextDue_s - time_s;
+    if (until_s >= AdvanceStep_s * MaxBatchSteps)
+      return MaxBatchSteps;
+    if (until_s <= AdvanceStep_s)
+      return 1;
+    return size_t(until_s / AdvanceStep_s + 0.5);
+  }
+
+  void Checkpoint()
+  {
+    std::unique_ptr<google::protobuf::Message> state = Pulse->SaveState();
+    if (state == nullptr)
+      return;
+    std::string bytes;
+    if (!state->SerializeToString(&bytes))
+      return;
+    double time_s = Pulse->GetSimulationTime(TimeUnit::s);
+    Checkpoints.Add(time_s, bytes);
+    CheckpointBytes = Checkpoints.GetMemoryUsed();
+    NextCheckpoint_s = time_s + CheckpointInterval_s;
+    if (StatePrototype == nullptr)
+      StatePrototype.reset(state->New());
+  }
+
+  void Rewind(double time_s)
+  {
+    double checkpoint_s;
+    std::string bytes;
+    std::stringstream ss;
+    if (StatePrototype == nullptr || !Checkpoints.Restore(time_s, checkpoint_s, bytes))
+    {
+      ss << "No checkpoint available at or before " << time_s << "s";
+      Pulse->GetLogger()->Warning(ss.str());
+      return;
+    }
+    std::unique_ptr<google::protobuf::Message> state(StatePrototype->New());
+    if (!state->ParseFromString(bytes) || !Pulse->LoadState(*state))
+    {
+      ss << "Unable to restore checkpoint at " << checkpoint_s << "s";
+      Pulse->GetLogger()->Error(ss.str());
+      return;
+    }
+    CarinaCO2 = nullptr;
+    for (PulseListener* l : Listeners)
+      l->PulseStateLoaded(*Pulse);
+    ScheduleListeners();
+    // The checkpoint was taken before anyone looked at that step, then catch up to the exact time requested
+    try {
+      StepListeners();
+    } catch (CommonDataModelException ex) {}
+    RunUnattended(time_s, true);
+    NextCheckpoint_s = checkpoint_s + CheckpointInterval_s;
+    ss << "Rewound to " << Pulse->GetSimulationTime(TimeUnit::s) << "s";
+    Pulse->GetLogger()->Info(ss.str());
+  }
 };
 
-QPulse::QPulse(QThread& thread, QTextEdit& log) : QObject()
+QPulse::QPulse(QThread& thread, LogWidget& log) : QObject()
 {
   m_Controls = new Controls(thread,log);
-
+  m_Controls->RewindTo_s = -1;
+  m_Controls->FastForwardTo_s = -1;
+  m_Controls->Overload = int(OverloadLevel::None);
+  m_Controls->CheckpointBytes = 0;
+  m_Controls->ForkRequested = false;
 
   connect(this, SIGNAL(RefreshUI()), SLOT(UpdateUI()));
 }
@@ -98,10 +390,11 @@ QPulse::QPulse(QThread& thread, QTextEdit& log) : QObject()
 QPulse::~QPulse()
 {
   Stop();
+  m_Controls->Broadcaster.Stop();
   delete m_Controls;
 }
 
-QTextEdit& QPulse::GetLogBox()
+LogWidget& QPulse::GetLogBox()
 {
   return m_Controls->Log2Qt.ExplorerLog;
 }
@@ -151,6 +444,34 @@ void QPulse::Reset()
   m_Controls->Advancing = false;
   m_Controls->RunInRealtime = true;
   m_Controls->Log2Qt.IgnoreActions.clear();
+  m_Controls->Checkpoints.Clear();
+  m_Controls->CheckpointBytes = 0;
+  m_Controls->StatePrototype.reset();
+  m_Controls->Predictor.Cancel();
+  m_Controls->RewindTo_s = -1;
+  m_Controls->FastForwardTo_s = -1;
+  m_Controls->CarinaCO2 = nullptr;
+}
+
+void QPulse::EnableRealtimeMode(const RealtimeSettings& settings)
+{
+  m_Controls->Realtime = settings;
+  m_Controls->RealtimeMode = true;
+}
+
+void QPulse::DisableRealtimeMode()
+{
+  m_Controls->RealtimeMode = false;
+}
+
+const StepJitterHistogram& QPulse::GetStepJitter() const
+{
+  return m_Controls->Jitter;
+}
+
+OverloadLevel QPulse::GetOverloadLevel() const
+{
+  return OverloadLevel(m_Controls->Overload.load());
 }
 
 bool QPulse::PlayPause()
@@ -185,54 +506,206 @@ void QPulse::Stop()
   
 }
 
-void QPulse::RegisterListener(PulseListener* l)
+void QPulse::SetCheckpointInterval_s(double interval_s)
+{
+  m_Controls->CheckpointInterval_s = interval_s;
+}
+
+void QPulse::SetMaxCheckpoints(size_t n)
+{
+  m_Controls->Checkpoints.SetMaxCheckpoints(n);
+  m_Controls->CheckpointBytes = m_Controls->Checkpoints.GetMemoryUsed();
+}
+
+size_t QPulse::GetCheckpointMemoryUsed() const
+{
+  return m_Controls->CheckpointBytes;
+}
+
+void QPulse::RewindTo(double time_s)
+{
+  // Picked up by the engine thread before its next step
+  m_Controls->RewindTo_s = time_s < 0 ? 0 : time_s;
+}
+
+void QPulse::FastForwardTo(double time_s)
+{
+  // Picked up by the engine thread before its next step
+  m_Controls->FastForwardTo_s = time_s;
+}
+
+void QPulse::Predict(const std::string& name, std::function<void(PhysiologyEngine&)> intervention, double horizon_s)
+{
+  if (!m_Controls->Thread.isRunning())
+    return;
+  // The engine thread takes the snapshot between steps
+  m_Controls->ForkMutex.lock();
+  m_Controls->ForkName = name;
+  m_Controls->ForkIntervention = intervention;
+  m_Controls->ForkHorizon_s = horizon_s;
+  m_Controls->ForkRequested = true;
+  m_Controls->ForkMutex.unlock();
+}
+
+bool QPulse::GetPrediction(PulsePrediction& p)
+{
+  return m_Controls->Predictor.GetPrediction(p);
+}
+
+bool QPulse::HasPredictionFailed()
+{
+  return m_Controls->Predictor.HasFailed();
+}
+
+bool QPulse::StartBroadcast(int port, bool any_interface)
+{
+  return m_Controls->Broadcaster.Start(port, any_interface);
+}
+
+void QPulse::StopBroadcast()
+{
+  m_Controls->Broadcaster.Stop();
+}
+
+VitalsBroadcaster& QPulse::GetBroadcaster()
+{
+  return m_Controls->Broadcaster;
+}
+
+void QPulse::RegisterListener(PulseListener* l, double rate_hz)
 {
   if (l == nullptr)
     return;
+  double period_s = rate_hz > 0 ? 1 / rate_hz : 0;
   auto itr = std::find(m_Controls->Listeners.begin(), m_Controls->Listeners.end(), l);
   if (itr == m_Controls->Listeners.end())
+  {
     m_Controls->Listeners.push_back(l);
+    m_Controls->ListenerPeriod_s.push_back(period_s);
+    m_Controls->ListenerDue_s.push_back(0);
+  }
+  else
+    m_Controls->ListenerPeriod_s[itr - m_Controls->Listeners.begin()] = period_s;
+  m_Controls->NextDue_s = 0;
 }
 
 void QPulse::RemoveListener(PulseListener* l)
 {
   auto itr = std::find(m_Controls->Listeners.begin(), m_Controls->Listeners.end(), l);
   if (itr != m_Controls->Listeners.end())
+  {
+    size_t i = itr - m_Controls->Listeners.begin();
     m_Controls->Listeners.erase(itr);
+    m_Controls->ListenerPeriod_s.erase(m_Controls->ListenerPeriod_s.begin() + i);
+    m_Controls->ListenerDue_s.erase(m_Controls->ListenerDue_s.begin() + i);
+  }
 }
 
 void QPulse::AdvanceTime()
 {
-  long long sleep_ms;
   TimingProfile timer;
+  // Everything the engine (and the listeners) allocate from here on is the engine's
+  MemoryAccounting::SetThreadHeap(MemoryAccounting::EngineHeap);
   m_Controls->Running = true;
   m_Controls->Advancing = true;
   m_Controls->AdvanceStep_s = m_Controls->Pulse->GetTimeStep(TimeUnit::s);
+  m_Controls->NextCheckpoint_s = m_Controls->Pulse->GetSimulationTime(TimeUnit::s);
+  m_Controls->ScheduleListeners();
+  m_Controls->Jitter.Clear();
+  if (m_Controls->RealtimeMode)
+  {
+    std::vector<std::string> report;
+    if (!RealtimeThread::MakeRealtime(m_Controls->Realtime, report))
+      m_Controls->Pulse->GetLogger()->Warning("Realtime mode was not fully granted, step timing may suffer");
+    for (const std::string& r : report)
+      m_Controls->Pulse->GetLogger()->Info(r);
+  }
+  // Realtime steps are due on a fixed schedule, so sleeping never accumulates drift
+  std::chrono::steady_clock::time_point step_due;
+  std::chrono::steady_clock::time_point step_start;
+  double late_s = 0;
+  bool on_schedule = false;
+  m_Controls->Governor.Reset();
+  m_Controls->Overload = int(OverloadLevel::None);
+  // Drivers see the engine before the first step too, so actions at the start time are in it (as Pulse's scenario executor does)
+  try {
+    m_Controls->RunDrivers();
+  } catch (CommonDataModelException ex) {}
   timer.Start("ui");
   while (m_Controls->Running)
   {
+    double rewind_s = m_Controls->RewindTo_s.exchange(-1);
+    if (rewind_s >= 0)
+    {
+      m_Controls->Rewind(rewind_s);
+      on_schedule = false;
+    }
+    double fast_forward_s = m_Controls->FastForwardTo_s.exchange(-1);
+    if (fast_forward_s >= 0)
+    {
+      m_Controls->FastForward(fast_forward_s);
+      on_schedule = false;
+    }
     if (m_Controls->Paused)
     {
       std::this_thread::sleep_for(std::chrono::seconds(1));
+      on_schedule = false;
     }
     else
     {
-      timer.Start("r");
+      if (m_Controls->RunInRealtime)
+      {
+        if (on_schedule)
+        {
+          m_Controls->WaitUntil(step_due);// Wait for real time to catch up
+          step_start = std::chrono::steady_clock::now();
+          late_s = std::chrono::duration<double>(step_start - step_due).count();
+          m_Controls->Jitter.Add(late_s * 1e6);
+        }
+        else
+        {
+          step_due = step_start = std::chrono::steady_clock::now();
+          late_s = 0;
+        }
+      }
+      else if (m_Controls->Overload != int(OverloadLevel::None))
+      {// Running flat out, there is no keeping up to do
+        m_Controls->Governor.Reset();
+        m_Controls->Overload = int(OverloadLevel::None);
+      }
+      on_schedule = m_Controls->RunInRealtime;
+      // Realtime steps are spread out evenly
+      size_t steps = 1;
+      if (!m_Controls->RunInRealtime)
+        steps = m_Controls->StepsUntilDue();
       try {
-        m_Controls->Pulse->AdvanceModelTime(m_Controls->AdvanceStep_s, TimeUnit::s);
+        for (size_t s = 0; s < steps; s++)
+          m_Controls->Step();
       } catch(CommonDataModelException ex) { }
-      for (PulseListener* l : m_Controls->Listeners)
-        l->ProcessPhysiology(*m_Controls->Pulse);
-      sleep_ms = (long long)((m_Controls->AdvanceStep_s - timer.GetElapsedTime_s("r"))*1000);
-      if (m_Controls->RunInRealtime && sleep_ms > 0)
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));// Wait for real time to catch up
+      m_Controls->ProcessPhysiology();
+      if (m_Controls->ForkRequested)
+        m_Controls->Fork(*this);
+      step_due += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(steps * m_Controls->AdvanceStep_s));
+      if (m_Controls->RunInRealtime)
+      {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (m_Controls->Governor.Update(std::chrono::duration<double>(now.time_since_epoch()).count(),
+                                        std::chrono::duration<double>(now - step_start).count(),
+                                        steps * m_Controls->AdvanceStep_s, late_s))
+          m_Controls->Overload = int(m_Controls->Governor.GetLevel());
+      }
+      // A second behind, start the schedule over rather than rush through the backlog
+      if (std::chrono::steady_clock::now() - step_due > std::chrono::seconds(1))
+        on_schedule = false;
     }
-    if (timer.GetElapsedTime_s("ui") > 0.1)
+    if (timer.GetElapsedTime_s("ui") > (m_Controls->Overload >= int(OverloadLevel::ReducedRefresh) ? 0.25 : 0.1))
     {
-      emit RefreshUI();// Only update the UI every 0.1 seconds
+      emit RefreshUI();// Only update the UI every 0.1 seconds, less when we cannot keep up
       timer.Start("ui");// Reset our timer
     }
   }
+  if (m_Controls->RealtimeMode && m_Controls->Jitter.GetNumberOfSamples() > 0)
+    m_Controls->Pulse->GetLogger()->Info(m_Controls->Jitter.ToString());
   m_Controls->Advancing = false;
 }
 
@@ -240,6 +713,15 @@ void QPulse::UpdateUI()
 {
   if (m_Controls->Running)
   {
+    OverloadLevel level = GetOverloadLevel();
+    if (level != m_Controls->ListenersOverload)
+    {
+      LogSeverity severity = level == OverloadLevel::Notified ? LogSeverity::Warning : LogSeverity::Info;
+      m_Controls->Log2Qt.ExplorerLog.Append(OverloadGovernor::ToString(level).c_str(), severity);
+      for (PulseListener* l : m_Controls->Listeners)
+        l->PulseOverloadChanged(level);
+      m_Controls->ListenersOverload = level;
+    }
     for (PulseListener* l : m_Controls->Listeners)
       l->PulseUpdateUI();
   }
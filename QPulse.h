@@ -3,25 +3,45 @@ See accompanying NOTICE file for details.*/
 #pragma once
 
 #include <QObject>
-#include <QTextEdit>
+#include "LogWidget.h"
+#include "OverloadGovernor.h"
+#include <functional>
 class PhysiologyEngine;
 class SEEngineTracker;
 class SEDataRequestManager;
+struct PulsePrediction;
+class VitalsBroadcaster;
+struct RealtimeSettings;
+class StepJitterHistogram;
 
 class PulseListener
 {
 public:
   // This is where we pull data from pulse, and push any actions to it
   virtual void ProcessPhysiology(PhysiologyEngine& pulse) = 0;
+  // Called after every engine step, including the steps run back to back between listeners that are due
+  // and the steps run again after a rewind, for whatever has to see every step (i.e. waveforms, alarms and exports).
+  // Only a fast forward skips it, PulseStateLoaded is called at the end of one.
+  // It never holds up the batching, so keep it to copying values out of the engine
+  virtual void PulseStepped(PhysiologyEngine& pulse) { }
   // This is where we take data that we pulleds from pulse and do anything to our UI based on it
   virtual  void PulseUpdateUI() { }
+  // The engine state was replaced (i.e. rewound to a checkpoint), drop anything cached from the old state
+  virtual void PulseStateLoaded(PhysiologyEngine& pulse) { }
+  // The engine fell behind real time (or caught back up), shed (or take back) UI work down to this level
+  // Called on the UI thread, before PulseUpdateUI
+  virtual void PulseOverloadChanged(OverloadLevel level) { }
+  // Drivers push actions to the engine (i.e. scenarios and showcases), they get every step no matter what,
+  // even while fast forwarding or catching up after a rewind when every other listener's ProcessPhysiology sits out.
+  // They see each step as it is taken, so they never keep the engine from running steps back to back
+  virtual bool IsPulseDriver() const { return false; }
 };
 
 class QPulse : public QObject
 {
   Q_OBJECT
 public:
-  QPulse(QThread& thread, QTextEdit& log);
+  QPulse(QThread& thread, LogWidget& log);
   virtual ~QPulse();
 
 public:
@@ -29,22 +49,54 @@ public:
   SEEngineTracker& GetEngineTracker();
 
   void ScrollLogBox();
-  QTextEdit& GetLogBox();
+  LogWidget& GetLogBox();
   void IgnoreAction(const std::string& name);
 
   void Reset();
   void Start();
   void Stop(); 
   bool ToggleRealtime();//return true=yes
+  // Opt in to a dedicated, high priority engine thread (see RealtimeThread), applied when the engine thread starts
+  void EnableRealtimeMode(const RealtimeSettings& settings);
+  void DisableRealtimeMode();
+  // How late each step started while running in realtime, since the engine thread started
+  const StepJitterHistogram& GetStepJitter() const;
+  // How much UI work is being shed to keep up with real time, see OverloadGovernor
+  OverloadLevel GetOverloadLevel() const;
   bool PlayPause();//return true=paused
-  void RegisterListener(PulseListener* listener);
+  // Listeners get ProcessPhysiology at rate_hz of simulation time, 0 for every engine step (drivers always get every step)
+  // When not in realtime, the engine runs several steps between listeners that are due, see PulseListener::PulseStepped
+  void RegisterListener(PulseListener* listener, double rate_hz=0);
   void RemoveListener(PulseListener* listener);
   void AdvanceTime();
   double GetTimeStep_s();
 
+  // In memory checkpoints of the engine state, taken every interval of sim time
+  void SetCheckpointInterval_s(double interval_s);
+  void SetMaxCheckpoints(size_t n);
+  size_t GetCheckpointMemoryUsed() const;// bytes
+  // Restore the latest checkpoint before time_s and fast forward to time_s
+  void RewindTo(double time_s);
+  // Run to time_s as fast as the engine goes with only the drivers listening,
+  // then everyone else picks up from there (as if the state was loaded) and it carries on in real time
+  void FastForwardTo(double time_s);
+
+  // Fork the live engine and run the copy forward horizon_s on background threads, with and without the intervention
+  // PredictionReady is emitted when both branches are done, or when either failed
+  void Predict(const std::string& name, std::function<void(PhysiologyEngine&)> intervention, double horizon_s=300);
+  bool GetPrediction(PulsePrediction& p);
+  bool HasPredictionFailed();
+
+  // Publish the vitals and waveforms of every step on a local TCP port, for any number of VitalsStreamClient style viewers
+  // Only viewers on this machine can connect unless any_interface
+  bool StartBroadcast(int port, bool any_interface=false);
+  void StopBroadcast();
+  VitalsBroadcaster& GetBroadcaster();
+
 
 signals:
   void RefreshUI();
+  void PredictionReady();
 protected slots :
   void UpdateUI();
 
@@ -1,117 +1,295 @@
 /* Distributed under the Apache License, Version 2.0.
 See accompanying NOTICE file for details.*/
 #include "QPulsePlot.h"
+#include "StripChartWidget.h"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
-#include <QVector>
-#include <deque>
+// A sliding window of samples that is always contiguous in memory.
+// Appends go past the end of the window and the start moves up, only when the
+// storage runs out is the window copied back to the front (once every Capacity appends).
+class SampleWindow
+{
+public:
+  void Resize(size_t capacity)
+  {
+    Capacity = capacity < 1 ? 1 : capacity;
+    Storage.assign(2 * Capacity, 0);
+    Clear();
+  }
+  void Clear() { Start = 0; Count = 0; }
+
+  void PushBack(double v)
+  {
+    if (Start + Count == Storage.size())
+    {
+      std::memmove(&Storage[0], &Storage[Start], Count * sizeof(double));
+      Start = 0;
+    }
+    Storage[Start + Count] = v;
+    if (Count < Capacity)
+      Count++;
+    else
+      Start++;
+  }
+
+  size_t size() const { return Count; }
+  bool empty() const { return Count == 0; }
+  const double* data() const { return &Storage[Start]; }
+  double operator[](size_t i) const { return Storage[Start + i]; }
+  size_t GetMemoryUsed() const { return Storage.capacity() * sizeof(double); }
+
+private:
+  std::vector<double> Storage;
+  size_t              Capacity = 0;
+  size_t              Start = 0;
+  size_t              Count = 0;
+};
+
+struct GhostTrace
+{
+  std::vector<double> Times;
+  std::vector<double> Values;
+  QColor              Color;
+};
 
 class QPulsePlot::Data
 {
 public:
-  QtCharts::QLineSeries* Series;
-  QtCharts::QChart*      Chart;
-  QtCharts::QChartView*  View;
-  std::deque<double>     Times;
-  std::deque<double>     Values;
+  StripChartWidget*      View = nullptr;
+  bool                   OwnsView = false;
+  QString                Title;
+  SampleWindow           Times;
+  SampleWindow           Values;
   double                 MaxY;
   double                 MinY;
+  bool                   HasRange = false;
   size_t                 MaxSize;
+  // Appends since the view last saw the whole window, and whether the window was replaced since
+  size_t                 NewSamples = 0;
+  bool                   Replaced = true;
+
+  std::vector<GhostTrace> Ghosts;
+  double                 GhostMaxX;
+
+  // The view is only made when someone needs to see it
+  void Build()
+  {
+    if (View != nullptr)
+      return;
+    View = new StripChartWidget(MaxSize);
+    OwnsView = true;
+    View->setVisible(false);
+    Bind();
+  }
+
+  void Bind()
+  {
+    View->SetTitle(Title);
+    View->ClearGhosts();
+    for (const GhostTrace& ghost : Ghosts)
+      View->AddGhost(ghost.Times, ghost.Values, ghost.Color);
+    Replaced = true;
+  }
 };
 
 QPulsePlot::QPulsePlot(size_t max_points)
 {
   m_Data = new QPulsePlot::Data();
-  m_Data->Series = new QtCharts::QLineSeries();
-  m_Data->Series->setUseOpenGL(true);
-  m_Data->Chart = new QtCharts::QChart();
-  m_Data->Chart->legend()->hide();
-  m_Data->Chart->addSeries(m_Data->Series);
-  m_Data->Chart->createDefaultAxes();
-  m_Data->View = new QtCharts::QChartView(m_Data->Chart);
-  m_Data->View->setRenderHint(QPainter::Antialiasing);
-  m_Data->View->setVisible(false);
   m_Data->MinY = std::numeric_limits<double>::max();
   m_Data->MaxY = -std::numeric_limits<double>::max();
   m_Data->MaxSize = max_points;
+  m_Data->Times.Resize(max_points);
+  m_Data->Values.Resize(max_points);
 }
 
 QPulsePlot::~QPulsePlot()
 {
-  delete m_Data->Series;
-  delete m_Data->Chart;
-  delete m_Data->View;
+  if (m_Data->OwnsView)
+    delete m_Data->View;
   delete m_Data;
 }
 
 void QPulsePlot::Reset()
 {
-  m_Data->Series->clear();
-  m_Data->Times.clear();
-  m_Data->Values.clear();
+  if (m_Data->View != nullptr)
+    m_Data->View->SetSamples(nullptr, nullptr, 0);
+  Clear();
+}
+
+void QPulsePlot::Clear()
+{
+  m_Data->Times.Clear();
+  m_Data->Values.Clear();
+  m_Data->Replaced = true;
 }
 
-QtCharts::QLineSeries& QPulsePlot::GetSeries() { return *m_Data->Series; }
-QtCharts::QChart& QPulsePlot::GetChart() { return *m_Data->Chart;  }
-QtCharts::QChartView& QPulsePlot::GetView() { return *m_Data->View; }
+void QPulsePlot::AddGhost(const std::vector<double>& times, const std::vector<double>& values, const QColor& color)
+{
+  size_t size = std::min(times.size(), values.size());
+  for (size_t i = 0; i < size; i++)
+  {
+    if (values[i] > m_Data->MaxY)
+      m_Data->MaxY = values[i];
+    if (values[i] < m_Data->MinY)
+      m_Data->MinY = values[i];
+  }
+  if (size > 0 && (m_Data->Ghosts.empty() || times[size - 1] > m_Data->GhostMaxX))
+    m_Data->GhostMaxX = times[size - 1];
+
+  GhostTrace ghost;
+  ghost.Times = times;
+  ghost.Values = values;
+  ghost.Color = color;
+  m_Data->Ghosts.push_back(ghost);
+  if (m_Data->View != nullptr)
+    m_Data->View->AddGhost(times, values, color);
+}
+
+void QPulsePlot::ClearGhosts()
+{
+  m_Data->Ghosts.clear();
+  if (m_Data->View != nullptr)
+    m_Data->View->ClearGhosts();
+}
+
+size_t QPulsePlot::GetMemoryUsed() const
+{
+  size_t bytes = m_Data->Times.GetMemoryUsed() + m_Data->Values.GetMemoryUsed() + m_Data->Ghosts.capacity() * sizeof(GhostTrace);
+  for (const GhostTrace& ghost : m_Data->Ghosts)
+    bytes += (ghost.Times.capacity() + ghost.Values.capacity()) * sizeof(double);
+  return bytes;
+}
+
+size_t QPulsePlot::GetNumberOfSamples() const { return m_Data->Values.size(); }
+const double* QPulsePlot::GetTimes() const { return m_Data->Times.data(); }
+const double* QPulsePlot::GetValues() const { return m_Data->Values.data(); }
+
+bool QPulsePlot::HasView() const { return m_Data->View != nullptr; }
+StripChartWidget& QPulsePlot::GetView() { m_Data->Build(); return *m_Data->View; }
+
+void QPulsePlot::SetView(StripChartWidget* view)
+{
+  if (view == m_Data->View)
+    return;
+  if (m_Data->OwnsView)
+    delete m_Data->View;
+  m_Data->View = view;
+  m_Data->OwnsView = false;
+  if (view != nullptr)
+    m_Data->Bind();
+}
+
+void QPulsePlot::SetTitle(const QString& title)
+{
+  m_Data->Title = title;
+  if (m_Data->View != nullptr)
+    m_Data->View->SetTitle(title);
+}
 
 void QPulsePlot::SetDataRange(double min, double max)
 {
   m_Data->MinY = min;
   m_Data->MaxY = max;
-  m_Data->Chart->axisY()->setRange(min, max);
+  m_Data->HasRange = true;
 }
 
 void QPulsePlot::Append(double time, double value)
 {
-  m_Data->Times.push_back(time);
-  m_Data->Values.push_back(value);
+  if (m_Data->Values.empty())
+  {// Start with a full window of the first value
+    for (size_t i = m_Data->MaxSize - 1; i > 0; i--)
+    {
+      m_Data->Times.PushBack(time - i / 50.);
+      m_Data->Values.PushBack(value);
+    }
+    m_Data->Replaced = true;
+  }
+  m_Data->Times.PushBack(time);
+  m_Data->Values.PushBack(value);
+  m_Data->NewSamples++;
+}
 
-  double t = time;
-  if (m_Data->Values.size() < m_Data->MaxSize)
+void QPulsePlot::SetData(const std::vector<double>& times, const std::vector<double>& values)
+{
+  m_Data->Times.Clear();
+  m_Data->Values.Clear();
+  m_Data->Replaced = true;
+  m_Data->MinY = std::numeric_limits<double>::max();
+  m_Data->MaxY = -std::numeric_limits<double>::max();
+  size_t size = std::min(times.size(), values.size());
+  if (size <= m_Data->MaxSize)
   {
-    for (size_t i = m_Data->Values.size(); i <= m_Data->MaxSize; i++)
+    for (size_t i = 0; i < size; i++)
     {
-      t -= 1./50.;
-      m_Data->Values.push_back(value);
-      m_Data->Times.push_front(t);
+      m_Data->Times.PushBack(times[i]);
+      m_Data->Values.PushBack(values[i]);
+    }
+    return;
+  }
+  // Each bucket keeps its min and max (in time order) so spikes survive the decimation
+  size_t buckets = std::max(size_t(1), m_Data->MaxSize / 2);
+  for (size_t b = 0; b < buckets; b++)
+  {
+    size_t begin = size * b / buckets;
+    size_t end = size * (b + 1) / buckets;
+    size_t min = begin, max = begin;
+    for (size_t i = begin + 1; i < end; i++)
+    {
+      if (values[i] < values[min])
+        min = i;
+      if (values[i] > values[max])
+        max = i;
+    }
+    size_t first = std::min(min, max);
+    size_t second = std::max(min, max);
+    m_Data->Times.PushBack(times[first]);
+    m_Data->Values.PushBack(values[first]);
+    if (second != first)
+    {
+      m_Data->Times.PushBack(times[second]);
+      m_Data->Values.PushBack(values[second]);
     }
   }
-
-  m_Data->Values.pop_front();
-  m_Data->Times.pop_front();
 }
 
 void QPulsePlot::UpdateUI(bool pad)
 {
+  m_Data->Build();
   size_t size = m_Data->Values.size();
+  // Hand the view only what it has not seen
+  if (m_Data->Replaced || m_Data->NewSamples >= size)
+    m_Data->View->SetSamples(m_Data->Times.data(), m_Data->Values.data(), size);
+  else if (m_Data->NewSamples > 0)
+    m_Data->View->AppendSamples(m_Data->Times.data() + size - m_Data->NewSamples, m_Data->Values.data() + size - m_Data->NewSamples, m_Data->NewSamples);
+  m_Data->Replaced = false;
+  m_Data->NewSamples = 0;
+
   if (size > 2)
   {
-    QVector<QPointF> points;
-
-    double v;
-
+    const double* values = m_Data->Values.data();
     for (size_t i = 0; i < size; i++)
     {
-      v = m_Data->Values[i];
-      if (v > m_Data->MaxY)
-        m_Data->MaxY = v;
-      if (v < m_Data->MinY)
-        m_Data->MinY = v;
-      points.append(QPointF(m_Data->Times[i], v));
+      if (values[i] > m_Data->MaxY)
+        m_Data->MaxY = values[i];
+      if (values[i] < m_Data->MinY)
+        m_Data->MinY = values[i];
     }
     if (m_Data->MinY == m_Data->MaxY)
     {
       m_Data->MinY -= 0.5;
       m_Data->MaxY += 0.5;
     }
-    if(pad)
-      m_Data->Chart->axisY()->setRange(m_Data->MinY - (m_Data->MinY*0.05), m_Data->MaxY + (m_Data->MaxY*0.05));
-    else
-      m_Data->Chart->axisY()->setRange(m_Data->MinY, m_Data->MaxY);
-    m_Data->Chart->axisX()->setRange(m_Data->Times[0], m_Data->Times[size - 1]);
-    m_Data->Series->replace(points);
+    double minY = pad ? m_Data->MinY - (m_Data->MinY*0.05) : m_Data->MinY;
+    double maxY = pad ? m_Data->MaxY + (m_Data->MaxY*0.05) : m_Data->MaxY;
+    double maxX = m_Data->Times[size - 1];
+    if (!m_Data->Ghosts.empty() && m_Data->GhostMaxX > maxX)
+      maxX = m_Data->GhostMaxX;
+    m_Data->View->SetRange(m_Data->Times[0], maxX, minY, maxY);
   }
+  else if (m_Data->HasRange)
+    m_Data->View->SetRange(0, 1, m_Data->MinY, m_Data->MaxY);
   m_Data->View->setVisible(true);
 }
-
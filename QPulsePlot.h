@@ -2,9 +2,10 @@
 See accompanying NOTICE file for details.*/
 #pragma once
 
-#include <QtCharts/QChart>
-#include <QtCharts/QChartView>
-#include <QtCharts/QLineSeries>
+#include <QColor>
+#include <QString>
+#include <vector>
+class StripChartWidget;
 
 class QPulsePlot
 {
@@ -14,15 +15,34 @@ public:
   virtual ~QPulsePlot();
 
   void Reset();
+  void Clear();// Drop the buffered samples only, safe to call from the engine thread
 
-  QtCharts::QLineSeries& GetSeries();
-  QtCharts::QChart& GetChart();
-  QtCharts::QChartView& GetView();
+  // The view is made on first use, samples can be added before that
+  bool HasView() const;
+  StripChartWidget& GetView();
+  // Draw into a view someone else owns (i.e. a pool of views shared by many plots), nullptr lets go of it
+  // Binding hands the view the current window of samples, the plot keeps its samples either way
+  void SetView(StripChartWidget* view);
 
+  void SetTitle(const QString& title);
   void SetDataRange(double min, double max);
   void Append(double time, double value);
+  // Replace the plot data, decimated down to the max size of the plot
+  void SetData(const std::vector<double>& times, const std::vector<double>& values);
   void UpdateUI(bool pad=true);
 
+  // The window of samples being plotted, contiguous and oldest first
+  // The pointers are only good until the next append, read them under the same lock the appends are made under
+  size_t GetNumberOfSamples() const;
+  const double* GetTimes() const;
+  const double* GetValues() const;
+
+  // Dashed traces drawn along with the live data, i.e. predicted outcomes
+  void AddGhost(const std::vector<double>& times, const std::vector<double>& values, const QColor& color);
+  void ClearGhosts();
+
+  size_t GetMemoryUsed() const;// bytes, the samples and ghosts (the view counts its own)
+
 private:
   class Data;
   Data* m_Data;
@@ -0,0 +1,186 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "RealtimeThread.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#ifdef __linux__
+  #include <alloca.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/mman.h>
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+#ifdef __linux__
+// Touch the stack we may grow into so the first deep call does not page fault mid step
+static void PrefaultStack(size_t bytes)
+{
+  volatile unsigned char* stack = static_cast<volatile unsigned char*>(alloca(bytes));
+  for (size_t i = 0; i < bytes; i += 4096)
+    stack[i] = 0;
+}
+#endif
+
+bool RealtimeThread::MakeRealtime(const RealtimeSettings& settings, std::vector<std::string>& report)
+{
+#ifdef __linux__
+  bool granted = true;
+  if (settings.CPU >= 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(settings.CPU, &cpus);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err == 0)
+      report.push_back("Pinned to CPU " + std::to_string(settings.CPU));
+    else
+    {
+      report.push_back("Unable to pin to CPU " + std::to_string(settings.CPU) + " : " + std::strerror(err));
+      granted = false;
+    }
+  }
+
+  bool fifo = false;
+  if (settings.Priority > 0)
+  {
+    sched_param param;
+    param.sched_priority = settings.Priority;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err == 0)
+    {
+      report.push_back("Running SCHED_FIFO at priority " + std::to_string(settings.Priority));
+      fifo = true;
+    }
+    else
+    {
+      report.push_back(std::string("Unable to use SCHED_FIFO : ") + std::strerror(err));
+      granted = false;
+    }
+  }
+  if (!fifo)
+  {// Linux keeps a nice value per thread
+    if (setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)), -10) == 0)
+      report.push_back("Raised the thread priority to nice -10");
+    else
+      report.push_back(std::string("Unable to raise the thread priority : ") + std::strerror(errno));
+  }
+
+  if (settings.LockMemory)
+  {
+    // Locking future mappings is only safe without a lock limit, otherwise later allocations can fail
+    rlimit limit;
+    int flags = MCL_CURRENT;
+    if (geteuid() == 0 || (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY))
+      flags |= MCL_FUTURE;
+    if (mlockall(flags) == 0)
+      report.push_back(flags & MCL_FUTURE ? "Locked current and future memory" : "Locked current memory");
+    else
+    {
+      report.push_back(std::string("Unable to lock memory : ") + std::strerror(errno));
+      granted = false;
+    }
+  }
+  if (settings.PrefaultStack_bytes > 0)
+    PrefaultStack(settings.PrefaultStack_bytes);
+  return granted;
+#else
+  report.push_back("Realtime scheduling is only supported on Linux");
+  return false;
+#endif
+}
+
+void RealtimeThread::MakeOrdinary()
+{
+#ifdef __linux__
+  sched_param param;
+  param.sched_priority = 0;
+  pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+  setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)), 0);
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  long n = sysconf(_SC_NPROCESSORS_CONF);
+  for (long c = 0; c < n && c < CPU_SETSIZE; c++)
+    CPU_SET(c, &cpus);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+}
+
+StepJitterHistogram::StepJitterHistogram(double bucket_us, size_t num_buckets) : Bucket_us(bucket_us), Counts(num_buckets + 1)
+{
+  Clear();
+}
+
+void StepJitterHistogram::Clear()
+{
+  for (std::atomic<size_t>& c : Counts)
+    c = 0;
+  Samples = 0;
+  Max_us = 0;
+}
+
+void StepJitterHistogram::Add(double late_us)
+{
+  if (late_us < 0)
+    late_us = 0;
+  size_t b = size_t(late_us / Bucket_us);
+  if (b >= Counts.size())
+    b = Counts.size() - 1;
+  Counts[b].fetch_add(1, std::memory_order_relaxed);
+  Samples.fetch_add(1, std::memory_order_relaxed);
+  if (late_us > Max_us.load(std::memory_order_relaxed))
+    Max_us.store(late_us, std::memory_order_relaxed);
+}
+
+size_t StepJitterHistogram::GetNumberOfSamples() const
+{
+  return Samples.load(std::memory_order_relaxed);
+}
+
+size_t StepJitterHistogram::GetNumberLaterThan(double us) const
+{
+  size_t n = 0;
+  for (size_t b = size_t(us / Bucket_us); b < Counts.size(); b++)
+    n += Counts[b].load(std::memory_order_relaxed);
+  return n;
+}
+
+double StepJitterHistogram::GetMax_us() const
+{
+  return Max_us.load(std::memory_order_relaxed);
+}
+
+double StepJitterHistogram::GetPercentile_us(double percent) const
+{
+  size_t total = 0;
+  for (const std::atomic<size_t>& c : Counts)
+    total += c.load(std::memory_order_relaxed);
+  if (total == 0)
+    return 0;
+  double target = total * percent / 100;
+  size_t n = 0;
+  for (size_t b = 0; b < Counts.size() - 1; b++)
+  {
+    n += Counts[b].load(std::memory_order_relaxed);
+    if (n >= target)
+      return std::min((b + 1) * Bucket_us, GetMax_us());
+  }
+  return GetMax_us();
+}
+
+std::string StepJitterHistogram::ToString() const
+{
+  std::stringstream ss;
+  ss.precision(0);
+  ss << std::fixed << "Step start jitter over " << GetNumberOfSamples() << " steps :"
+     << " p50 " << GetPercentile_us(50) << "us,"
+     << " p99 " << GetPercentile_us(99) << "us,"
+     << " p99.9 " << GetPercentile_us(99.9) << "us,"
+     << " max " << GetMax_us() << "us, "
+     << GetNumberLaterThan(1000) << " later than 1ms";
+  return ss.str();
+}
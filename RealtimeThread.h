@@ -0,0 +1,52 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+struct RealtimeSettings
+{
+  int    CPU = -1;      // Pin to this CPU, -1 leaves it to the scheduler
+  int    Priority = 80; // SCHED_FIFO priority (1-99), 0 only asks for a better nice value
+  bool   LockMemory = true;
+  size_t PrefaultStack_bytes = 512 * 1024;
+  double Spin_us = 200; // Busy wait the end of each sleep, sleeps alone wake up late
+};
+
+// Scheduling for threads with deadlines, i.e. the engine thread driving hardware in the loop.
+// Everything is best effort : whatever the OS does not permit is skipped and reported.
+// Only Linux is supported, elsewhere the report just says so.
+class RealtimeThread
+{
+public:
+  // Applies to the calling thread (and memory locking to the whole process)
+  // Returns true if everything asked for was granted, report says what was and was not
+  static bool MakeRealtime(const RealtimeSettings& settings, std::vector<std::string>& report);
+  // Back to normal scheduling on any CPU, for threads started by a realtime thread (they inherit its scheduling)
+  static void MakeOrdinary();
+};
+
+// How late each step started, in fixed width buckets with everything past the last bucket counted together.
+// Written by one thread and read by any, without locks
+class StepJitterHistogram
+{
+public:
+  StepJitterHistogram(double bucket_us = 50, size_t num_buckets = 200);
+
+  void Clear();
+  void Add(double late_us);
+
+  size_t GetNumberOfSamples() const;
+  size_t GetNumberLaterThan(double us) const;// Rounded to the bucket
+  double GetMax_us() const;
+  double GetPercentile_us(double percent) const;// Upper edge of the bucket
+  std::string ToString() const;
+
+private:
+  double                             Bucket_us;
+  std::vector<std::atomic<size_t>>   Counts;// Last one is the overflow
+  std::atomic<size_t>                Samples;
+  std::atomic<double>                Max_us;
+};
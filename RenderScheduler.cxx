@@ -0,0 +1,147 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "RenderScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+struct ScheduledView
+{
+  std::string            Name;
+  std::function<bool()>  NeedsRender;
+  std::function<void()>  Render;
+  int                    Priority = 0;
+  bool                   Dirty = false;
+  bool                   Interacting = false;
+  size_t                 Waited = 0;// Frames it has been dirty and not drawn
+  double                 Cost_s = 0;
+  size_t                 Renders = 0;
+  size_t                 Deferrals = 0;
+};
+
+class RenderScheduler::Data
+{
+public:
+  std::vector<ScheduledView> Views;
+  std::vector<size_t>        Order;
+  double                     Budget_s;
+
+  // Interaction first, then priority (raised by every frame spent waiting)
+  bool Before(size_t a, size_t b) const
+  {
+    const ScheduledView& va = Views[a];
+    const ScheduledView& vb = Views[b];
+    if (va.Interacting != vb.Interacting)
+      return va.Interacting;
+    return va.Priority + int(va.Waited) > vb.Priority + int(vb.Waited);
+  }
+};
+
+RenderScheduler::RenderScheduler(double budget_s)
+{
+  m_Data = new RenderScheduler::Data();
+  m_Data->Budget_s = budget_s;
+}
+
+RenderScheduler::~RenderScheduler()
+{
+  delete m_Data;
+}
+
+size_t RenderScheduler::AddView(const std::string& name, std::function<bool()> needs_render, std::function<void()> render, int priority)
+{
+  ScheduledView view;
+  view.Name = name;
+  view.NeedsRender = needs_render;
+  view.Render = render;
+  view.Priority = priority;
+  m_Data->Views.push_back(view);
+  return m_Data->Views.size() - 1;
+}
+
+void RenderScheduler::MarkDirty(size_t view)
+{
+  if (view < m_Data->Views.size())
+    m_Data->Views[view].Dirty = true;
+}
+
+bool RenderScheduler::IsDirty(size_t view) const
+{
+  return view < m_Data->Views.size() && m_Data->Views[view].Dirty;
+}
+
+void RenderScheduler::SetInteracting(size_t view, bool b)
+{
+  if (view < m_Data->Views.size())
+    m_Data->Views[view].Interacting = b;
+}
+
+void RenderScheduler::SetBudget_s(double budget_s)
+{
+  m_Data->Budget_s = budget_s;
+}
+
+double RenderScheduler::GetBudget_s() const
+{
+  return m_Data->Budget_s;
+}
+
+size_t RenderScheduler::Render()
+{
+  // The interactor draws the views being interacted with whether we do or not, leave room for that
+  double spent_s = 0;
+  m_Data->Order.clear();
+  for (size_t v = 0; v < m_Data->Views.size(); v++)
+  {
+    ScheduledView& view = m_Data->Views[v];
+    if (view.NeedsRender && view.NeedsRender())
+      view.Dirty = true;
+    if (view.Dirty)
+      m_Data->Order.push_back(v);
+    else if (view.Interacting)
+      spent_s += view.Cost_s;
+  }
+  std::stable_sort(m_Data->Order.begin(), m_Data->Order.end(), [this](size_t a, size_t b) { return m_Data->Before(a, b); });
+
+  size_t drawn = 0;
+  for (size_t v : m_Data->Order)
+  {
+    ScheduledView& view = m_Data->Views[v];
+    if (drawn > 0 && spent_s + view.Cost_s > m_Data->Budget_s)
+    {
+      view.Waited++;
+      view.Deferrals++;
+      continue;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    view.Render();
+    double cost_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    view.Cost_s = view.Renders == 0 ? cost_s : 0.8 * view.Cost_s + 0.2 * cost_s;
+    view.Renders++;
+    view.Dirty = false;
+    view.Waited = 0;
+    spent_s += cost_s;
+    drawn++;
+  }
+  return drawn;
+}
+
+const std::string& RenderScheduler::GetName(size_t view) const
+{
+  return m_Data->Views[view].Name;
+}
+
+double RenderScheduler::GetRenderCost_s(size_t view) const
+{
+  return m_Data->Views[view].Cost_s;
+}
+
+size_t RenderScheduler::GetNumberOfRenders(size_t view) const
+{
+  return m_Data->Views[view].Renders;
+}
+
+size_t RenderScheduler::GetNumberOfDeferrals(size_t view) const
+{
+  return m_Data->Views[view].Deferrals;
+}
@@ -0,0 +1,42 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Draws only the views that changed, once per UI refresh and within a time budget.
+// Each view says whether it needs drawing (i.e. new samples in a visible chart, a new color in the 3D scene),
+// the dirty ones are drawn most important first until the budget is spent. Views that do not fit stay dirty
+// and move up a place every frame they wait, so they are late but never starved.
+// A view the user is interacting with goes first, and the renders it is doing on its own come out of the budget.
+// Only for use on the GUI thread.
+class RenderScheduler
+{
+public:
+  RenderScheduler(double budget_s = 0.015);
+  virtual ~RenderScheduler();
+
+  // needs_render is asked every frame (it can be empty if the view is only ever marked dirty)
+  // Views with a higher priority are drawn first
+  size_t AddView(const std::string& name, std::function<bool()> needs_render, std::function<void()> render, int priority = 0);
+  void MarkDirty(size_t view);
+  bool IsDirty(size_t view) const;
+  void SetInteracting(size_t view, bool b);
+
+  void SetBudget_s(double budget_s);
+  double GetBudget_s() const;
+
+  // Returns how many views were drawn, at least one dirty view is drawn every frame
+  size_t Render();
+
+  const std::string& GetName(size_t view) const;
+  double GetRenderCost_s(size_t view) const;// Averaged
+  size_t GetNumberOfRenders(size_t view) const;
+  size_t GetNumberOfDeferrals(size_t view) const;// Frames it was dirty but did not fit
+
+private:
+  class Data;
+  Data* m_Data;
+};
@@ -0,0 +1,231 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "ResultsCSVLoader.h"
+
+#include <QFile>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+class ResultsCSVLoader::Data
+{
+public:
+  QFile                    File;
+  const char*              Begin = nullptr;// First data row
+  const char*              End = nullptr;
+  std::vector<std::string> Columns;
+
+  // Parse all complete lines in [begin,end) into columns
+  void Parse(const char* begin, const char* end, std::vector<std::vector<double>>& columns) const
+  {
+    size_t numColumns = Columns.size();
+    columns.resize(numColumns);
+    // Guess the row count from the size of the first line so we don't keep reallocating
+    const char* eol = (const char*)memchr(begin, '\n', end - begin);
+    if (eol != nullptr && eol > begin)
+    {
+      size_t rows = size_t(end - begin) / size_t(eol - begin + 1) + 1;
+      for (std::vector<double>& col : columns)
+        col.reserve(col.size() + rows);
+    }
+    const char* c = begin;
+    while (c < end)
+    {
+      if (*c == '\n' || *c == '\r')
+      {// Blank line
+        c++;
+        continue;
+      }
+      for (size_t col = 0; col < numColumns; col++)
+      {
+        columns[col].push_back(ParseDouble(c, end));
+        // Skip to the next field
+        while (c < end && *c != ',' && *c != '\n')
+          c++;
+        if (c < end && *c == ',')
+          c++;
+      }
+      while (c < end && *c != '\n')
+        c++;
+      c++;
+    }
+  }
+};
+
+ResultsCSVLoader::ResultsCSVLoader()
+{
+  m_Data = new ResultsCSVLoader::Data();
+}
+
+ResultsCSVLoader::~ResultsCSVLoader()
+{
+  Close();
+  delete m_Data;
+}
+
+const std::vector<std::string>& ResultsCSVLoader::GetColumnNames() const
+{
+  return m_Data->Columns;
+}
+
+bool ResultsCSVLoader::Open(const std::string& filename)
+{
+  Close();
+  m_Data->File.setFileName(QString(filename.c_str()));
+  if (!m_Data->File.open(QIODevice::ReadOnly) || m_Data->File.size() == 0)
+    return false;
+  const char* map = (const char*)m_Data->File.map(0, m_Data->File.size());
+  if (map == nullptr)
+    return false;
+  m_Data->End = map + m_Data->File.size();
+
+  // Header
+  const char* c = map;
+  std::string name;
+  while (c < m_Data->End && *c != '\n')
+  {
+    if (*c == ',')
+    {
+      m_Data->Columns.push_back(name);
+      name.clear();
+    }
+    else if (*c != '\r')
+      name.push_back(*c);
+    c++;
+  }
+  if (!name.empty())
+    m_Data->Columns.push_back(name);
+  m_Data->Begin = c < m_Data->End ? c + 1 : c;
+  return !m_Data->Columns.empty();
+}
+
+void ResultsCSVLoader::Close()
+{
+  m_Data->File.close();// Also unmaps
+  m_Data->Begin = nullptr;
+  m_Data->End = nullptr;
+  m_Data->Columns.clear();
+}
+
+bool ResultsCSVLoader::LoadPreview(std::vector<std::vector<double>>& columns, size_t max_bytes) const
+{
+  if (m_Data->Begin == nullptr)
+    return false;
+  columns.clear();
+  const char* end = m_Data->Begin + std::min(max_bytes, size_t(m_Data->End - m_Data->Begin));
+  // Stop at the end of the last complete line
+  while (end < m_Data->End && end > m_Data->Begin && *(end - 1) != '\n')
+    end--;
+  m_Data->Parse(m_Data->Begin, end, columns);
+  return true;
+}
+
+bool ResultsCSVLoader::Load(std::vector<std::vector<double>>& columns, size_t num_threads) const
+{
+  if (m_Data->Begin == nullptr)
+    return false;
+  columns.clear();
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t size = m_Data->End - m_Data->Begin;
+  // Not worth spinning up threads for small files
+  if (size < 1024 * 1024)
+    num_threads = 1;
+
+  // Line aligned chunk boundaries
+  std::vector<const char*> bounds;
+  bounds.push_back(m_Data->Begin);
+  for (size_t t = 1; t < num_threads; t++)
+  {
+    const char* b = std::max(bounds.back(), m_Data->Begin + size * t / num_threads);
+    const char* eol = (const char*)memchr(b, '\n', m_Data->End - b);
+    if (eol == nullptr)
+      break;
+    bounds.push_back(eol + 1);
+  }
+  bounds.push_back(m_Data->End);
+
+  std::vector<std::vector<std::vector<double>>> chunks(bounds.size() - 1);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < chunks.size(); t++)
+    threads.push_back(std::thread([this, &bounds, &chunks, t]() { m_Data->Parse(bounds[t], bounds[t + 1], chunks[t]); }));
+  m_Data->Parse(bounds[0], bounds[1], chunks[0]);
+  for (std::thread& t : threads)
+    t.join();
+
+  // Stitch the chunks back together in order
+  columns.resize(m_Data->Columns.size());
+  for (size_t col = 0; col < columns.size(); col++)
+  {
+    size_t rows = 0;
+    for (const std::vector<std::vector<double>>& chunk : chunks)
+      rows += chunk[col].size();
+    columns[col].reserve(rows);
+    for (const std::vector<std::vector<double>>& chunk : chunks)
+      columns[col].insert(columns[col].end(), chunk[col].begin(), chunk[col].end());
+  }
+  return true;
+}
+
+// Straight line parse of the plain decimal numbers the engine writes,
+// anything unusual (nan, inf, very long mantissas) falls back on strtod
+double ResultsCSVLoader::ParseDouble(const char*& c, const char* end)
+{
+  static const double Pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+  const char* start = c;
+  while (c < end && *c == ' ')
+    c++;
+  bool negative = false;
+  if (c < end && (*c == '-' || *c == '+'))
+    negative = *c++ == '-';
+
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  while (c < end && unsigned(*c - '0') < 10)
+  {
+    mantissa = mantissa * 10 + unsigned(*c++ - '0');
+    digits++;
+  }
+  if (c < end && *c == '.')
+  {
+    c++;
+    while (c < end && unsigned(*c - '0') < 10)
+    {
+      mantissa = mantissa * 10 + unsigned(*c++ - '0');
+      digits++;
+      exponent--;
+    }
+  }
+  if (digits == 0 || digits > 18)
+  {// Not something we handle, let the library deal with it
+    char buffer[64];
+    size_t len = 0;
+    c = start;
+    while (c < end && *c != ',' && *c != '\n' && *c != '\r' && len < sizeof(buffer) - 1)
+      buffer[len++] = *c++;
+    buffer[len] = '\0';
+    return len == 0 ? std::numeric_limits<double>::quiet_NaN() : std::strtod(buffer, nullptr);
+  }
+  if (c < end && (*c == 'e' || *c == 'E'))
+  {
+    c++;
+    bool negativeExp = false;
+    if (c < end && (*c == '-' || *c == '+'))
+      negativeExp = *c++ == '-';
+    int e = 0;
+    while (c < end && unsigned(*c - '0') < 10)
+      e = e * 10 + (*c++ - '0');
+    exponent += negativeExp ? -e : e;
+  }
+  double value = double(mantissa);
+  if (exponent < 0)
+    value = exponent >= -22 ? value / Pow10[-exponent] : value * std::pow(10.0, exponent);
+  else if (exponent > 0)
+    value = exponent <= 22 ? value * Pow10[exponent] : value * std::pow(10.0, exponent);
+  return negative ? -value : value;
+}
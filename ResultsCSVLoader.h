@@ -0,0 +1,31 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Loads a Pulse results csv file (as written by the engine tracker).
+// The file is memory mapped and split into line aligned chunks that are parsed in parallel.
+// A preview of the first rows can be parsed on its own so something can be shown before the full parse is done.
+class ResultsCSVLoader
+{
+public:
+  ResultsCSVLoader();
+  virtual ~ResultsCSVLoader();
+
+  bool Open(const std::string& filename);// Maps the file and reads the header
+  void Close();
+
+  const std::vector<std::string>& GetColumnNames() const;
+  // Parse rows from the start of the file, up to about max_bytes worth of them
+  bool LoadPreview(std::vector<std::vector<double>>& columns, size_t max_bytes=1024*1024) const;
+  // Parse the whole file, 0 threads = all cores
+  bool Load(std::vector<std::vector<double>>& columns, size_t num_threads=0) const;
+
+  static double ParseDouble(const char*& c, const char* end);
+
+private:
+  class Data;
+  Data* m_Data;
+};
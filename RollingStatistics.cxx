@@ -0,0 +1,261 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "RollingStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <stdint.h>
+
+// Sliding accumulators slowly collect rounding error, so every so many samples
+// they are recomputed from the samples still in the window
+static const size_t ResyncInterval = 8192;
+
+struct StatsWindow
+{
+  double   Length_s;
+  uint64_t Tail = 0;// Oldest sample in the window
+  size_t   SinceResync = 0;
+  double   MeanT = 0;
+  double   M2T = 0;
+  std::vector<double> MeanX;// Per signal
+  std::vector<double> M2X;
+  std::vector<double> CTX;  // Co-moment of time and value, for the slope
+  std::vector<std::deque<uint64_t>> MaxQueue;// Sample numbers, values decreasing from the front
+  std::vector<std::deque<uint64_t>> MinQueue;
+};
+
+class RollingStatistics::Data
+{
+public:
+  std::vector<double>      Windows_s;
+  size_t                   NumSignals = 0;
+  // Samples still in the longest window, sample n is row n % capacity
+  std::vector<double>      Times;
+  std::vector<double>      Values;
+  size_t                   Capacity = 0;
+  uint64_t                 Next = 0;
+  std::vector<StatsWindow> Windows;
+
+  double Time(uint64_t n) const { return Times[size_t(n % Capacity)]; }
+  const double* Row(uint64_t n) const { return &Values[size_t(n % Capacity) * NumSignals]; }
+
+  void Grow()
+  {
+    uint64_t oldest = Next;
+    for (const StatsWindow& w : Windows)
+      oldest = std::min(oldest, w.Tail);
+    if (Capacity > 0 && Next - oldest < Capacity)
+      return;
+    size_t capacity = std::max(size_t(1024), Capacity * 2);
+    std::vector<double> times(capacity);
+    std::vector<double> values(capacity * NumSignals);
+    for (uint64_t n = oldest; n < Next; n++)
+    {
+      times[size_t(n % capacity)] = Time(n);
+      std::copy(Row(n), Row(n) + NumSignals, &values[size_t(n % capacity) * NumSignals]);
+    }
+    Times.swap(times);
+    Values.swap(values);
+    Capacity = capacity;
+  }
+
+  void Add(StatsWindow& w, uint64_t n)
+  {
+    double count = double(n + 1 - w.Tail);
+    double t = Time(n);
+    const double* x = Row(n);
+    double dt = t - w.MeanT;
+    w.MeanT += dt / count;
+    w.M2T += dt * (t - w.MeanT);
+    double* mx = w.MeanX.data();
+    double* m2 = w.M2X.data();
+    double* c = w.CTX.data();
+    for (size_t j = 0; j < NumSignals; j++)
+    {
+      double dx = x[j] - mx[j];
+      mx[j] += dx / count;
+      m2[j] += dx * (x[j] - mx[j]);
+      c[j] += dt * (x[j] - mx[j]);
+    }
+    for (size_t j = 0; j < NumSignals; j++)
+    {
+      std::deque<uint64_t>& maxq = w.MaxQueue[j];
+      while (!maxq.empty() && Row(maxq.back())[j] <= x[j])
+        maxq.pop_back();
+      maxq.push_back(n);
+      std::deque<uint64_t>& minq = w.MinQueue[j];
+      while (!minq.empty() && Row(minq.back())[j] >= x[j])
+        minq.pop_back();
+      minq.push_back(n);
+    }
+  }
+
+  // Take the oldest sample out of the window
+  void Remove(StatsWindow& w)
+  {
+    uint64_t n = w.Tail++;
+    double count = double(Next - w.Tail);
+    double t = Time(n);
+    const double* x = Row(n);
+    double* mx = w.MeanX.data();
+    double* m2 = w.M2X.data();
+    double* c = w.CTX.data();
+    if (count == 0)
+    {
+      w.MeanT = w.M2T = 0;
+      std::fill(w.MeanX.begin(), w.MeanX.end(), 0.);
+      std::fill(w.M2X.begin(), w.M2X.end(), 0.);
+      std::fill(w.CTX.begin(), w.CTX.end(), 0.);
+    }
+    else
+    {
+      double meanT = w.MeanT - (t - w.MeanT) / count;
+      w.M2T -= (t - meanT) * (t - w.MeanT);
+      w.MeanT = meanT;
+      double dt = t - meanT;
+      for (size_t j = 0; j < NumSignals; j++)
+      {
+        double meanX = mx[j] - (x[j] - mx[j]) / count;
+        m2[j] -= (x[j] - meanX) * (x[j] - mx[j]);
+        c[j] -= dt * (x[j] - mx[j]);
+        mx[j] = meanX;
+      }
+    }
+    for (size_t j = 0; j < NumSignals; j++)
+    {
+      if (!w.MaxQueue[j].empty() && w.MaxQueue[j].front() == n)
+        w.MaxQueue[j].pop_front();
+      if (!w.MinQueue[j].empty() && w.MinQueue[j].front() == n)
+        w.MinQueue[j].pop_front();
+    }
+  }
+
+  void Resync(StatsWindow& w)
+  {
+    double count = double(Next - w.Tail);
+    w.MeanT = 0;
+    std::fill(w.MeanX.begin(), w.MeanX.end(), 0.);
+    for (uint64_t n = w.Tail; n < Next; n++)
+    {
+      w.MeanT += Time(n);
+      const double* x = Row(n);
+      for (size_t j = 0; j < NumSignals; j++)
+        w.MeanX[j] += x[j];
+    }
+    w.MeanT /= count;
+    for (size_t j = 0; j < NumSignals; j++)
+      w.MeanX[j] /= count;
+    w.M2T = 0;
+    std::fill(w.M2X.begin(), w.M2X.end(), 0.);
+    std::fill(w.CTX.begin(), w.CTX.end(), 0.);
+    for (uint64_t n = w.Tail; n < Next; n++)
+    {
+      double dt = Time(n) - w.MeanT;
+      w.M2T += dt * dt;
+      const double* x = Row(n);
+      for (size_t j = 0; j < NumSignals; j++)
+      {
+        double dx = x[j] - w.MeanX[j];
+        w.M2X[j] += dx * dx;
+        w.CTX[j] += dt * dx;
+      }
+    }
+    w.SinceResync = 0;
+  }
+};
+
+RollingStatistics::RollingStatistics(const std::vector<double>& windows_s)
+{
+  m_Data = new RollingStatistics::Data();
+  m_Data->Windows_s = windows_s;
+  SetNumberOfSignals(0);
+}
+
+RollingStatistics::~RollingStatistics()
+{
+  delete m_Data;
+}
+
+void RollingStatistics::SetNumberOfSignals(size_t n)
+{
+  m_Data->NumSignals = n;
+  Clear();
+}
+
+size_t RollingStatistics::GetNumberOfSignals() const
+{
+  return m_Data->NumSignals;
+}
+
+const std::vector<double>& RollingStatistics::GetWindows() const
+{
+  return m_Data->Windows_s;
+}
+
+void RollingStatistics::Clear()
+{
+  size_t n = m_Data->NumSignals;
+  m_Data->Times.clear();
+  m_Data->Values.clear();
+  m_Data->Capacity = 0;
+  m_Data->Next = 0;
+  m_Data->Windows.clear();
+  for (double length_s : m_Data->Windows_s)
+  {
+    StatsWindow w;
+    w.Length_s = length_s;
+    w.MeanX.resize(n);
+    w.M2X.resize(n);
+    w.CTX.resize(n);
+    w.MaxQueue.resize(n);
+    w.MinQueue.resize(n);
+    m_Data->Windows.push_back(w);
+  }
+}
+
+void RollingStatistics::Push(double time_s, const double* values)
+{
+  Data& d = *m_Data;
+  d.Grow();
+  uint64_t n = d.Next++;
+  d.Times[size_t(n % d.Capacity)] = time_s;
+  std::copy(values, values + d.NumSignals, &d.Values[size_t(n % d.Capacity) * d.NumSignals]);
+  for (StatsWindow& w : d.Windows)
+  {
+    d.Add(w, n);
+    while (d.Time(w.Tail) < time_s - w.Length_s)
+      d.Remove(w);
+    if (++w.SinceResync >= ResyncInterval)
+      d.Resync(w);
+  }
+}
+
+bool RollingStatistics::GetStatistics(size_t signal, size_t window, RollingStats& stats) const
+{
+  const Data& d = *m_Data;
+  if (signal >= d.NumSignals || window >= d.Windows.size())
+    return false;
+  const StatsWindow& w = d.Windows[window];
+  stats.NumSamples = size_t(d.Next - w.Tail);
+  if (stats.NumSamples == 0)
+    return false;
+  stats.Mean = w.MeanX[signal];
+  stats.StdDev = stats.NumSamples > 1 ? std::sqrt(std::max(0., w.M2X[signal] / double(stats.NumSamples - 1))) : 0;
+  stats.Max = d.Row(w.MaxQueue[signal].front())[signal];
+  stats.Min = d.Row(w.MinQueue[signal].front())[signal];
+  stats.Slope = w.M2T > 0 ? w.CTX[signal] / w.M2T : 0;
+  return true;
+}
+
+size_t RollingStatistics::GetMemoryUsed() const
+{
+  size_t bytes = (m_Data->Times.capacity() + m_Data->Values.capacity()) * sizeof(double);
+  for (const StatsWindow& w : m_Data->Windows)
+  {
+    bytes += (w.MeanX.capacity() + w.M2X.capacity() + w.CTX.capacity()) * sizeof(double);
+    for (size_t s = 0; s < w.MaxQueue.size(); s++)// Deques allocate in 512 byte blocks
+      bytes += 2 * (sizeof(std::deque<uint64_t>) + 512) + (w.MaxQueue[s].size() + w.MinQueue[s].size()) * sizeof(uint64_t);
+  }
+  return bytes;
+}
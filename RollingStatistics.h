@@ -0,0 +1,44 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct RollingStats
+{
+  size_t NumSamples = 0;
+  double Mean = 0;
+  double StdDev = 0;
+  double Min = 0;
+  double Max = 0;
+  double Slope = 0;// Least squares, per second
+};
+
+// Windowed mean, standard deviation, min/max and slope of many signals sampled together.
+// Every Push is O(1) per signal per window : samples entering and leaving a window update
+// Welford style accumulators, and min/max come from monotonic queues.
+// Accumulators are stored per window as contiguous arrays across signals so each update is a flat loop.
+class RollingStatistics
+{
+public:
+  RollingStatistics(const std::vector<double>& windows_s = { 10, 60, 300 });
+  virtual ~RollingStatistics();
+
+  // Clears any samples
+  void SetNumberOfSignals(size_t n);
+  size_t GetNumberOfSignals() const;
+  const std::vector<double>& GetWindows() const;
+  void Clear();
+
+  // values holds one sample for every signal, time must not go backwards
+  void Push(double time_s, const double* values);
+
+  bool GetStatistics(size_t signal, size_t window, RollingStats& stats) const;
+
+  size_t GetMemoryUsed() const;// bytes, approximate for the min/max queues
+
+private:
+  class Data;
+  Data* m_Data;
+};
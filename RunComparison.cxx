@@ -0,0 +1,158 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "RunComparison.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+void GridInterpolator::Build(const std::vector<double>& grid, const double* times, size_t n, double offset_s)
+{
+  size_t g = grid.size();
+  Lo.assign(g, 0);
+  Hi.assign(g, 0);
+  Weight.assign(g, std::numeric_limits<double>::quiet_NaN());
+  Begin = End = 0;
+  if (n == 0 || g == 0)
+    return;
+  // Only the samples under the grid are walked, a run can be hours long and the grid a few seconds of it
+  double first = grid[0] + offset_s;
+  size_t j = std::upper_bound(times, times + n, first) - times;
+  j = j > 0 ? j - 1 : 0;
+  Begin = g;
+  for (size_t i = 0; i < g; i++)
+  {
+    double t = grid[i] + offset_s;
+    if (t < times[0] || t > times[n - 1])
+      continue;
+    while (j + 1 < n && times[j + 1] < t)
+      j++;
+    size_t k = j + 1 < n ? j + 1 : j;
+    double dt = times[k] - times[j];
+    Lo[i] = uint32_t(j);
+    Hi[i] = uint32_t(k);
+    Weight[i] = dt > 0 ? (t - times[j]) / dt : 0;
+    if (i < Begin)
+      Begin = i;
+    End = i + 1;
+  }
+  if (Begin > End)
+    Begin = End = 0;
+}
+
+void GridInterpolator::Apply(const double* values, double* out) const
+{
+  const uint32_t* lo = Lo.data();
+  const uint32_t* hi = Hi.data();
+  const double* w = Weight.data();
+  size_t g = Weight.size();
+  for (size_t i = 0; i < g; i++)
+  {
+    double a = values[lo[i]];
+    out[i] = a + w[i] * (values[hi[i]] - a);
+  }
+}
+
+size_t GridInterpolator::GetMemoryUsed() const
+{
+  return (Lo.capacity() + Hi.capacity()) * sizeof(uint32_t) + Weight.capacity() * sizeof(double);
+}
+
+std::string RunComparison::GetKey(const std::string& signal)
+{
+  // Pulse csv headers are HeartRate(1/min), our titles are HeartRate (1/min)
+  std::string key;
+  for (char c : signal)
+    if (!std::isspace((unsigned char)c))
+      key += c;
+  return key;
+}
+
+bool RunComparison::AddRun(const std::string& name, std::vector<std::vector<double>>& columns, const std::vector<std::string>& names)
+{
+  if (columns.size() < 2 || columns.size() != names.size() || columns[0].empty())
+    return false;
+  for (const std::vector<double>& column : columns)
+    if (column.size() != columns[0].size())
+      return false;
+  Runs.push_back(Run());
+  Run& run = Runs.back();
+  run.Name = name;
+  run.Columns.swap(columns);
+  // Line the runs up on their first sample
+  std::vector<double>& times = run.Columns[0];
+  double start_s = times[0];
+  for (double& t : times)
+    t -= start_s;
+  for (size_t c = 1; c < names.size(); c++)
+    run.Signals[GetKey(names[c])] = c;
+  if (!Grid.empty())
+    run.Lookup.Build(Grid, times.data(), times.size());
+  return true;
+}
+
+void RunComparison::Clear()
+{
+  Runs.clear();
+  Grid.clear();
+}
+
+size_t RunComparison::GetNumberOfRuns() const
+{
+  return Runs.size();
+}
+
+const std::string& RunComparison::GetRunName(size_t run) const
+{
+  return Runs[run].Name;
+}
+
+bool RunComparison::SetGrid(double start_s, double end_s, size_t n)
+{
+  if (n < 2)
+    n = 2;
+  if (Grid.size() == n && Grid.front() == start_s && Grid.back() == end_s)
+    return false;
+  Grid.resize(n);
+  double step_s = (end_s - start_s) / (n - 1);
+  for (size_t i = 0; i < n; i++)
+    Grid[i] = start_s + i * step_s;
+  Grid[n - 1] = end_s;
+  for (Run& run : Runs)
+    run.Lookup.Build(Grid, run.Columns[0].data(), run.Columns[0].size());
+  return true;
+}
+
+const std::vector<double>& RunComparison::GetGrid() const
+{
+  return Grid;
+}
+
+bool RunComparison::Resample(size_t run, const std::string& signal, std::vector<double>& out) const
+{
+  const Run& r = Runs[run];
+  auto itr = r.Signals.find(GetKey(signal));
+  if (itr == r.Signals.end() || Grid.empty())
+    return false;
+  out.resize(Grid.size());
+  r.Lookup.Apply(r.Columns[itr->second].data(), out.data());
+  return true;
+}
+
+void RunComparison::GetCoverage(size_t run, size_t& begin, size_t& end) const
+{
+  begin = Runs[run].Lookup.GetBegin();
+  end = Runs[run].Lookup.GetEnd();
+}
+
+size_t RunComparison::GetMemoryUsed() const
+{
+  size_t bytes = Grid.capacity() * sizeof(double) + Runs.capacity() * sizeof(Run);
+  for (const Run& run : Runs)
+  {
+    for (const std::vector<double>& column : run.Columns)
+      bytes += column.capacity() * sizeof(double);
+    bytes += run.Lookup.GetMemoryUsed();
+  }
+  return bytes;
+}
@@ -0,0 +1,74 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Where each point of a time grid falls between the samples of one time axis.
+// Building it is the only searching done, applying it to any signal on that time axis is
+// a straight pass of multiply adds the compiler can vectorize (no branches, outside points come out NaN).
+class GridInterpolator
+{
+public:
+  // Grid points are sample times minus offset_s, both the grid and the times must be increasing
+  void Build(const std::vector<double>& grid, const double* times, size_t n, double offset_s = 0);
+  // values has a value per sample time given to Build, out a value per grid point
+  void Apply(const double* values, double* out) const;
+
+  // The grid points inside the samples, [begin, end)
+  size_t GetBegin() const { return Begin; }
+  size_t GetEnd() const { return End; }
+
+  size_t GetMemoryUsed() const;// bytes
+
+private:
+  std::vector<uint32_t> Lo;
+  std::vector<uint32_t> Hi;
+  std::vector<double>   Weight;
+  size_t                Begin = 0;
+  size_t                End = 0;
+};
+
+// Recorded runs of the same data requests lined up by the time since each run started,
+// i.e. the same scenario with a tourniquet at 60s in one and 120s in another.
+// All runs are resampled onto one grid, the lookups into each run's time axis are made once per grid
+// and shared by every signal, so asking for another signal costs no more searching.
+class RunComparison
+{
+public:
+  // Column 0 is time, names has a name per column. The columns are moved into the run
+  bool AddRun(const std::string& name, std::vector<std::vector<double>>& columns, const std::vector<std::string>& names);
+  void Clear();
+
+  size_t GetNumberOfRuns() const;
+  const std::string& GetRunName(size_t run) const;
+
+  // A grid of n points from start_s to end_s after the start of the runs
+  // The lookups are only rebuilt when the grid changes, returns true if it did
+  bool SetGrid(double start_s, double end_s, size_t n);
+  const std::vector<double>& GetGrid() const;
+
+  // The signal of a run on the grid, NaN where the run has no data
+  // Signals are matched by name, ignoring white space. Returns false if the run does not have the signal
+  bool Resample(size_t run, const std::string& signal, std::vector<double>& out) const;
+  // Grid points the run covers, [begin, end)
+  void GetCoverage(size_t run, size_t& begin, size_t& end) const;
+
+  static std::string GetKey(const std::string& signal);
+
+  size_t GetMemoryUsed() const;// bytes, the recorded runs and their lookups
+
+private:
+  struct Run
+  {
+    std::string                      Name;
+    std::vector<std::vector<double>> Columns;
+    std::map<std::string, size_t>    Signals;// Key to column
+    GridInterpolator                 Lookup;
+  };
+  std::vector<Run>    Runs;
+  std::vector<double> Grid;
+};
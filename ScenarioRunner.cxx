@@ -0,0 +1,139 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "ScenarioRunner.h"
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "cdm/CommonDataModel.h"
+#include "PulsePhysiologyEngine.h"
+#include "cdm/scenario/SEScenario.h"
+#include "cdm/scenario/SEAction.h"
+#include "cdm/scenario/SEAdvanceTime.h"
+#include "cdm/scenario/SEDataRequestManager.h"
+#include "cdm/properties/SEScalarTime.h"
+
+struct TimedAction
+{
+  double          Time_s;// Since the scenario started
+  const SEAction* Action;
+};
+
+class ScenarioRunner::Controls
+{
+public:
+  Controls(QPulse& qp) : Pulse(qp) {}
+  QPulse&                      Pulse;
+  std::unique_ptr<SEScenario>  Scenario;// Owns the actions
+  std::vector<TimedAction>     Timeline;
+  size_t                       Next = 0;
+  double                       Start_s = 0;// Engine time the scenario started at
+  double                       Duration_s = 0;
+  bool                         Finished = false;
+
+  // First action that has not happened yet at this engine time
+  void Seek(double time_s)
+  {
+    double step_s = Pulse.GetTimeStep_s();
+    Next = 0;
+    while (Next < Timeline.size() && Start_s + Timeline[Next].Time_s < time_s - step_s / 2)
+      Next++;
+    Finished = Next == Timeline.size() && time_s - Start_s >= Duration_s;
+  }
+};
+
+ScenarioRunner::ScenarioRunner(QPulse& qp)
+{
+  m_Controls = new Controls(qp);
+}
+
+ScenarioRunner::~ScenarioRunner()
+{
+  delete m_Controls;
+}
+
+void ScenarioRunner::Clear()
+{
+  m_Controls->Timeline.clear();
+  m_Controls->Scenario.reset();
+  m_Controls->Next = 0;
+  m_Controls->Start_s = 0;
+  m_Controls->Duration_s = 0;
+  m_Controls->Finished = false;
+}
+
+double ScenarioRunner::GetDuration_s() const
+{
+  return m_Controls->Duration_s;
+}
+
+bool ScenarioRunner::Load(const std::string& filename, PhysiologyEngine& pulse, SEDataRequestManager& drMgr)
+{
+  Clear();
+  LogWidget& log = m_Controls->Pulse.GetLogBox();
+  m_Controls->Scenario.reset(new SEScenario(pulse.GetSubstanceManager()));
+  if (!m_Controls->Scenario->LoadFile(filename))
+  {
+    log.Append(QString("Unable to read scenario ") + filename.c_str(), LogSeverity::Error);
+    Clear();
+    return false;
+  }
+  if (!m_Controls->Scenario->HasEngineStateFile())
+  {
+    log.Append(QString("Scenario ") + filename.c_str() + " starts from a patient file, only scenarios starting from a state file can be loaded", LogSeverity::Error);
+    Clear();
+    return false;
+  }
+  if (!pulse.LoadStateFile(m_Controls->Scenario->GetEngineStateFile()))
+  {
+    log.Append(QString("Unable to load scenario state ") + m_Controls->Scenario->GetEngineStateFile().c_str(), LogSeverity::Error);
+    Clear();
+    return false;
+  }
+  drMgr.Copy(m_Controls->Scenario->GetDataRequestManager(), pulse.GetSubstanceManager());
+
+  double time_s = 0;
+  for (const SEAction* a : m_Controls->Scenario->GetActions())
+  {
+    const SEAdvanceTime* advance = dynamic_cast<const SEAdvanceTime*>(a);
+    if (advance != nullptr)
+      time_s += advance->GetTime(TimeUnit::s);
+    else
+      m_Controls->Timeline.push_back({ time_s, a });
+  }
+  m_Controls->Duration_s = time_s;
+  m_Controls->Start_s = pulse.GetSimulationTime(TimeUnit::s);
+  m_Controls->Seek(m_Controls->Start_s);
+
+  std::stringstream ss;
+  ss << "Loaded scenario " << m_Controls->Scenario->GetName() << " : " << m_Controls->Timeline.size()
+     << " actions over " << time_s << "s";
+  log.Append(ss.str().c_str());
+  if (m_Controls->Scenario->HasDescription())
+    log.Append(m_Controls->Scenario->GetDescription().c_str());
+  return true;
+}
+
+void ScenarioRunner::ProcessPhysiology(PhysiologyEngine& pulse)
+{
+  if (m_Controls->Finished)
+    return;
+  double time_s = pulse.GetSimulationTime(TimeUnit::s);
+  double step_s = m_Controls->Pulse.GetTimeStep_s();
+  // Actions at the same time are applied together, in scenario order
+  while (m_Controls->Next < m_Controls->Timeline.size() &&
+         m_Controls->Start_s + m_Controls->Timeline[m_Controls->Next].Time_s < time_s + step_s / 2)
+    pulse.ProcessAction(*m_Controls->Timeline[m_Controls->Next++].Action);
+  if (m_Controls->Next == m_Controls->Timeline.size() && time_s - m_Controls->Start_s >= m_Controls->Duration_s - step_s / 2)
+  {
+    m_Controls->Finished = true;
+    pulse.GetLogger()->Info("Scenario complete, the patient keeps running");
+  }
+}
+
+void ScenarioRunner::PulseStateLoaded(PhysiologyEngine& pulse)
+{
+  // Rewound, anything after the checkpoint has to happen again
+  m_Controls->Seek(pulse.GetSimulationTime(TimeUnit::s));
+}
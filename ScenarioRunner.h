@@ -0,0 +1,32 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include "QPulse.h"
+
+// Plays a Pulse scenario file on the interactive engine.
+// The actions are put on a timeline (each advance time in the scenario moves it along),
+// and each action is handed to the engine on the step its time comes up, as long as the engine is running.
+// Scenarios starting from a patient file need stabilizing first, only scenarios starting from a state file are supported.
+class ScenarioRunner : public PulseListener
+{
+public:
+  ScenarioRunner(QPulse& qp);
+  virtual ~ScenarioRunner();
+
+  // Loads the state the scenario starts from, queues its actions, and adds its data requests to drMgr
+  bool Load(const std::string& filename, PhysiologyEngine& pulse, SEDataRequestManager& drMgr);
+  void Clear();
+
+  // Scenario time of the last action or advance time
+  double GetDuration_s() const;
+
+  void ProcessPhysiology(PhysiologyEngine& pulse);
+  void PulseStateLoaded(PhysiologyEngine& pulse);
+  bool IsPulseDriver() const { return true; }
+
+private:
+  class Controls;
+  Controls* m_Controls;
+};
@@ -0,0 +1,493 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "SignalHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <stdint.h>
+
+// Spilled blocks (of one signal) kept after a query read them, a chart only reads a few blocks of a level
+static const size_t CacheEntries = 16;
+
+struct HistoryLevel
+{
+  size_t   Width;// Values per signal in a record, the raw sample or its min, max and mean
+  uint64_t Count = 0;// Records
+  std::vector<double>   BlockStart_s;// Of every block, spilled or not
+  std::vector<uint64_t> Offsets;// Of the spilled blocks in the spill file, always the oldest blocks
+  std::deque<std::vector<double>> Resident;// The newest blocks, the last one is being filled
+  // The record of the level above being built
+  size_t              Pending = 0;
+  double              PendingTime_s = 0;
+  std::vector<double> Min;
+  std::vector<double> Max;
+  std::vector<double> Sum;
+};
+
+struct CachedColumns
+{
+  size_t              Level;
+  size_t              Block;
+  size_t              Signal;
+  std::vector<double> Values;// The times of the block, then the columns of the signal
+};
+
+class SignalHistory::Data
+{
+public:
+  size_t                    BlockSize;
+  size_t                    Fanout;
+  size_t                    ResidentBlocks;
+  size_t                    NumSignals = 0;
+  std::string               Filename;
+  mutable std::fstream      File;
+  bool                      Spilling = false;
+  uint64_t                  FileSize = 0;
+  std::deque<HistoryLevel>  Levels;// A deque, so adding a level leaves the others where they are
+  double                    Start_s = 0;
+  double                    End_s = 0;
+  mutable std::list<CachedColumns> Cache;// Most recently used first
+
+  size_t BlockDoubles(const HistoryLevel& level) const { return BlockSize * (1 + NumSignals * level.Width); }
+  size_t FirstResident(const HistoryLevel& level) const { return level.Offsets.size(); }
+  size_t Records(const HistoryLevel& level, size_t b) const
+  {
+    return size_t(std::min(uint64_t(BlockSize), level.Count - uint64_t(b) * BlockSize));
+  }
+
+  void AddLevel()
+  {
+    HistoryLevel level;
+    level.Width = Levels.empty() ? 1 : 3;
+    level.Min.resize(NumSignals);
+    level.Max.resize(NumSignals);
+    level.Sum.resize(NumSignals);
+    Levels.push_back(level);
+  }
+
+  void Reset()
+  {
+    Levels.clear();
+    Cache.clear();
+    AddLevel();
+    Start_s = 0;
+    End_s = 0;
+    FileSize = 0;
+    if (!Filename.empty())
+    {
+      File.close();
+      File.clear();
+      File.open(Filename, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    }
+    Spilling = File.is_open();
+  }
+
+  void Read(uint64_t offset, double* values, size_t n) const
+  {
+    File.seekg(std::streamoff(offset));
+    File.read(reinterpret_cast<char*>(values), n * sizeof(double));
+    if (!File)
+    {
+      File.clear();
+      std::fill(values, values + n, std::numeric_limits<double>::quiet_NaN());
+    }
+  }
+
+  // Blocks past the resident ones are appended to the spill file, they are full as only the last block is being filled
+  void Spill(HistoryLevel& level)
+  {
+    while (Spilling && level.Resident.size() > ResidentBlocks)
+    {
+      const std::vector<double>& block = level.Resident.front();
+      File.seekp(std::streamoff(FileSize));
+      File.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(double));
+      if (!File)
+      {// i.e. out of disk, what is spilled stays readable and the rest stays in memory
+        File.clear();
+        Spilling = false;
+        return;
+      }
+      level.Offsets.push_back(FileSize);
+      FileSize += block.size() * sizeof(double);
+      level.Resident.pop_front();
+    }
+  }
+
+  // The whole block, from memory or the spill file
+  const double* GetBlock(const HistoryLevel& level, size_t b, std::vector<double>& scratch) const
+  {
+    size_t first = FirstResident(level);
+    if (b >= first)
+      return level.Resident[b - first].data();
+    scratch.resize(BlockDoubles(level));
+    Read(level.Offsets[b], scratch.data(), scratch.size());
+    return scratch.data();
+  }
+
+  // The times of a block and the columns of one signal in it, spilled blocks are read without the other signals
+  const double* GetColumns(size_t l, size_t b, size_t signal, const double*& times) const
+  {
+    const HistoryLevel& level = Levels[l];
+    size_t first = FirstResident(level);
+    if (b >= first)
+    {
+      times = level.Resident[b - first].data();
+      return times + (1 + signal * level.Width) * BlockSize;
+    }
+    std::list<CachedColumns>::iterator c = Cache.begin();
+    while (c != Cache.end() && (c->Level != l || c->Block != b || c->Signal != signal))
+      ++c;
+    if (c != Cache.end())
+    {
+      Cache.splice(Cache.begin(), Cache, c);
+      times = Cache.front().Values.data();
+      return times + BlockSize;
+    }
+    if (Cache.size() < CacheEntries)
+      Cache.push_front(CachedColumns());
+    else// Reuse the least recently used
+      Cache.splice(Cache.begin(), Cache, std::prev(Cache.end()));
+    CachedColumns& entry = Cache.front();
+    entry.Level = l;
+    entry.Block = b;
+    entry.Signal = signal;
+    entry.Values.resize(BlockSize * (1 + level.Width));
+    Read(level.Offsets[b], entry.Values.data(), BlockSize);
+    Read(level.Offsets[b] + (1 + signal * level.Width) * BlockSize * sizeof(double), entry.Values.data() + BlockSize, level.Width * BlockSize);
+    times = entry.Values.data();
+    return times + BlockSize;
+  }
+
+  void Fold(HistoryLevel& level, double time_s, const double* mins, const double* maxs, const double* means)
+  {
+    if (level.Pending++ == 0)
+    {
+      level.PendingTime_s = time_s;
+      std::copy(mins, mins + NumSignals, level.Min.begin());
+      std::copy(maxs, maxs + NumSignals, level.Max.begin());
+      std::copy(means, means + NumSignals, level.Sum.begin());
+      return;
+    }
+    for (size_t s = 0; s < NumSignals; s++)
+    {
+      if (mins[s] < level.Min[s])
+        level.Min[s] = mins[s];
+      if (maxs[s] > level.Max[s])
+        level.Max[s] = maxs[s];
+      level.Sum[s] += means[s];
+    }
+  }
+
+  void Append(size_t l, double time_s, const double* mins, const double* maxs, const double* means)
+  {
+    HistoryLevel& level = Levels[l];
+    size_t r = size_t(level.Count % BlockSize);
+    if (r == 0)
+    {
+      level.BlockStart_s.push_back(time_s);
+      level.Resident.push_back(std::vector<double>(BlockDoubles(level)));
+      Spill(level);
+    }
+    double* block = level.Resident.back().data();
+    block[r] = time_s;
+    for (size_t s = 0; s < NumSignals; s++)
+    {
+      double* columns = block + (1 + s * level.Width) * BlockSize + r;
+      if (level.Width == 1)
+        columns[0] = means[s];
+      else
+      {
+        columns[0] = mins[s];
+        columns[BlockSize] = maxs[s];
+        columns[2 * BlockSize] = means[s];
+      }
+    }
+    level.Count++;
+
+    Fold(level, time_s, mins, maxs, means);
+    if (level.Pending < Fanout)
+      return;
+    level.Pending = 0;
+    if (l + 1 == Levels.size())
+      AddLevel();
+    // Every record in the level above covers the same number of samples, so the mean of means is the mean
+    for (size_t s = 0; s < NumSignals; s++)
+      level.Sum[s] /= Fanout;
+    Append(l + 1, level.PendingTime_s, level.Min.data(), level.Max.data(), level.Sum.data());
+  }
+
+  // Records past keep are dropped, their bytes stay in the spill file (it is only ever appended to)
+  void Shrink(HistoryLevel& level, uint64_t keep)
+  {
+    if (keep >= level.Count)
+      return;
+    size_t blocks = size_t((keep + BlockSize - 1) / BlockSize);
+    size_t first = FirstResident(level);
+    if (blocks > first)
+      level.Resident.resize(blocks - first);
+    else
+    {// Back into the spilled blocks, a partial one is read back in to carry on filling
+      level.Resident.clear();
+      bool partial = keep % BlockSize != 0;
+      if (partial)
+      {
+        level.Resident.push_back(std::vector<double>(BlockDoubles(level)));
+        Read(level.Offsets[blocks - 1], level.Resident.back().data(), level.Resident.back().size());
+      }
+      level.Offsets.resize(partial ? blocks - 1 : blocks);
+    }
+    level.BlockStart_s.resize(blocks);
+    level.Count = keep;
+  }
+
+  // The record of the level above being built, from the records of this level not in the level above
+  void Rebuild(size_t l)
+  {
+    HistoryLevel& level = Levels[l];
+    uint64_t begin = l + 1 < Levels.size() ? Levels[l + 1].Count * Fanout : 0;
+    level.Pending = 0;
+    std::vector<double> scratch;
+    std::vector<double> mins(NumSignals), maxs(NumSignals), means(NumSignals);
+    const double* block = nullptr;
+    size_t loaded = size_t(-1);
+    for (uint64_t k = begin; k < level.Count; k++)
+    {
+      size_t b = size_t(k / BlockSize);
+      size_t r = size_t(k % BlockSize);
+      if (b != loaded)
+      {
+        block = GetBlock(level, b, scratch);
+        loaded = b;
+      }
+      for (size_t s = 0; s < NumSignals; s++)
+      {
+        const double* columns = block + (1 + s * level.Width) * BlockSize + r;
+        mins[s] = columns[0];
+        maxs[s] = level.Width == 1 ? columns[0] : columns[BlockSize];
+        means[s] = level.Width == 1 ? columns[0] : columns[2 * BlockSize];
+      }
+      Fold(level, block[r], mins.data(), maxs.data(), means.data());
+    }
+  }
+
+  // Where time_s falls in the raw samples, interpolated within its block so nothing is read
+  double EstimateSample(double time_s) const
+  {
+    const HistoryLevel& raw = Levels[0];
+    if (raw.Count == 0 || time_s <= Start_s)
+      return 0;
+    if (time_s >= End_s)
+      return double(raw.Count);
+    size_t b = std::upper_bound(raw.BlockStart_s.begin(), raw.BlockStart_s.end(), time_s) - raw.BlockStart_s.begin() - 1;
+    double start = raw.BlockStart_s[b];
+    double end = b + 1 < raw.BlockStart_s.size() ? raw.BlockStart_s[b + 1] : End_s;
+    double fraction = end > start ? (time_s - start) / (end - start) : 0;
+    return double(b) * BlockSize + fraction * Records(raw, b);
+  }
+
+  // The samples newer than the last record of level l, as one partial record
+  bool GetTail(size_t l, size_t signal, double& time_s, double& min, double& max, double& mean) const
+  {
+    bool any = false;
+    double sum = 0;
+    double weight = 0;
+    double samples = 1;// Per record of level j
+    for (size_t j = 0; j < l; j++, samples *= Fanout)
+    {
+      const HistoryLevel& level = Levels[j];
+      if (level.Pending == 0)
+        continue;
+      min = any ? std::min(min, level.Min[signal]) : level.Min[signal];
+      max = any ? std::max(max, level.Max[signal]) : level.Max[signal];
+      time_s = level.PendingTime_s;// Higher levels are pending on older samples
+      sum += level.Sum[signal] * samples;
+      weight += level.Pending * samples;
+      any = true;
+    }
+    if (any)
+      mean = sum / weight;
+    return any;
+  }
+};
+
+SignalHistory::SignalHistory(size_t block_size, size_t fanout, size_t resident_blocks)
+{
+  m_Data = new SignalHistory::Data();
+  m_Data->BlockSize = std::max(size_t(1), block_size);
+  m_Data->Fanout = std::max(size_t(2), fanout);
+  m_Data->ResidentBlocks = std::max(size_t(1), resident_blocks);
+  m_Data->Reset();
+}
+
+SignalHistory::~SignalHistory()
+{
+  Close();
+  delete m_Data;
+}
+
+bool SignalHistory::Open(const std::string& spill_file, size_t num_signals)
+{
+  Close();
+  m_Data->NumSignals = num_signals;
+  m_Data->Filename = spill_file;
+  m_Data->Reset();
+  return spill_file.empty() || m_Data->Spilling;
+}
+
+void SignalHistory::Close()
+{
+  if (m_Data->File.is_open())
+  {
+    m_Data->File.close();
+    std::remove(m_Data->Filename.c_str());
+  }
+  m_Data->Filename.clear();
+  m_Data->NumSignals = 0;
+  m_Data->Reset();
+}
+
+void SignalHistory::Clear()
+{
+  m_Data->Reset();
+}
+
+size_t SignalHistory::GetNumberOfSignals() const { return m_Data->NumSignals; }
+size_t SignalHistory::GetNumberOfSamples() const { return size_t(m_Data->Levels[0].Count); }
+size_t SignalHistory::GetNumberOfLevels() const { return m_Data->Levels.size(); }
+double SignalHistory::GetStartTime_s() const { return m_Data->Start_s; }
+double SignalHistory::GetEndTime_s() const { return m_Data->End_s; }
+size_t SignalHistory::GetSpilledBytes() const { return size_t(m_Data->FileSize); }
+
+void SignalHistory::Push(double time_s, const double* values)
+{
+  if (m_Data->NumSignals == 0)
+    return;
+  if (m_Data->Levels[0].Count == 0)
+    m_Data->Start_s = time_s;
+  m_Data->End_s = time_s;
+  m_Data->Append(0, time_s, values, values, values);
+}
+
+void SignalHistory::Truncate(double time_s)
+{
+  const HistoryLevel& raw = m_Data->Levels[0];
+  if (raw.Count == 0 || time_s > m_Data->End_s)
+    return;
+  // Raw samples before time_s
+  uint64_t keep = 0;
+  size_t b = std::lower_bound(raw.BlockStart_s.begin(), raw.BlockStart_s.end(), time_s) - raw.BlockStart_s.begin();
+  if (b > 0)
+  {
+    std::vector<double> scratch;
+    const double* times = m_Data->GetBlock(raw, b - 1, scratch);
+    size_t n = m_Data->Records(raw, b - 1);
+    keep = uint64_t(b - 1) * m_Data->BlockSize + (std::lower_bound(times, times + n, time_s) - times);
+  }
+  if (keep == 0)
+  {
+    Clear();
+    return;
+  }
+  // A record of a level is only kept if all of the records it was made from are
+  m_Data->Cache.clear();
+  for (size_t l = 0; l < m_Data->Levels.size(); l++, keep /= m_Data->Fanout)
+    m_Data->Shrink(m_Data->Levels[l], keep);
+  while (m_Data->Levels.size() > 1 && m_Data->Levels.back().Count == 0)
+    m_Data->Levels.pop_back();
+  for (size_t l = 0; l < m_Data->Levels.size(); l++)
+    m_Data->Rebuild(l);
+  m_Data->End_s = time_s;
+}
+
+size_t SignalHistory::Query(size_t signal, double start_s, double end_s, size_t max_points,
+                            std::vector<double>& times, std::vector<double>& mins, std::vector<double>& maxs, std::vector<double>& means) const
+{
+  times.clear();
+  mins.clear();
+  maxs.clear();
+  means.clear();
+  if (signal >= m_Data->NumSignals || m_Data->Levels[0].Count == 0 || max_points == 0 || end_s < start_s)
+    return 0;
+
+  // The coarsest level that still has a record for every point
+  double samples = m_Data->EstimateSample(end_s) - m_Data->EstimateSample(start_s);
+  size_t l = 0;
+  while (l + 1 < m_Data->Levels.size() && samples / std::pow(double(m_Data->Fanout), double(l + 1)) >= max_points)
+    l++;
+
+  const HistoryLevel& level = m_Data->Levels[l];
+  size_t B = m_Data->BlockSize;
+  size_t b = std::upper_bound(level.BlockStart_s.begin(), level.BlockStart_s.end(), start_s) - level.BlockStart_s.begin();
+  for (b = b > 0 ? b - 1 : 0; b < level.BlockStart_s.size() && level.BlockStart_s[b] <= end_s; b++)
+  {
+    const double* t;
+    const double* columns = m_Data->GetColumns(l, b, signal, t);
+    size_t n = m_Data->Records(level, b);
+    for (size_t r = 0; r < n && t[r] <= end_s; r++)
+    {
+      if (t[r] < start_s)
+        continue;
+      times.push_back(t[r]);
+      mins.push_back(columns[r]);
+      maxs.push_back(level.Width == 1 ? columns[r] : columns[B + r]);
+      means.push_back(level.Width == 1 ? columns[r] : columns[2 * B + r]);
+    }
+  }
+  double time_s, min, max, mean;
+  if (l > 0 && m_Data->GetTail(l, signal, time_s, min, max, mean) && time_s >= start_s && time_s <= end_s)
+  {
+    times.push_back(time_s);
+    mins.push_back(min);
+    maxs.push_back(max);
+    means.push_back(mean);
+  }
+
+  // Merge the records down to max_points buckets, in place as no bucket starts before its index
+  size_t n = times.size();
+  if (n <= max_points)
+    return l;
+  for (size_t p = 0; p < max_points; p++)
+  {
+    size_t begin = n * p / max_points;
+    size_t end = n * (p + 1) / max_points;
+    double lo = mins[begin];
+    double hi = maxs[begin];
+    double sum = means[begin];
+    for (size_t i = begin + 1; i < end; i++)
+    {
+      lo = std::min(lo, mins[i]);
+      hi = std::max(hi, maxs[i]);
+      sum += means[i];
+    }
+    times[p] = times[begin];
+    mins[p] = lo;
+    maxs[p] = hi;
+    means[p] = sum / (end - begin);
+  }
+  times.resize(max_points);
+  mins.resize(max_points);
+  maxs.resize(max_points);
+  means.resize(max_points);
+  return l;
+}
+
+size_t SignalHistory::GetMemoryUsed() const
+{
+  size_t doubles = 0;
+  for (const HistoryLevel& level : m_Data->Levels)
+  {
+    for (const std::vector<double>& block : level.Resident)
+      doubles += block.capacity();
+    doubles += level.BlockStart_s.capacity() + level.Offsets.capacity() +
+               level.Min.capacity() + level.Max.capacity() + level.Sum.capacity();
+  }
+  for (const CachedColumns& entry : m_Data->Cache)
+    doubles += entry.Values.capacity();
+  return doubles * sizeof(double);
+}
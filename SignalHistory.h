@@ -0,0 +1,53 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+// The whole session of many signals sampled together, in bounded memory, at every zoom level.
+// Level 0 holds the raw samples, each level above holds the min, max and mean of fanout records of the level below.
+// Every level is kept in blocks of records, only the newest few blocks of each level stay in memory,
+// older blocks are appended to a spill file and read back (one signal at a time) when a query needs them.
+// A query only reads the coarsest level that still has a record for every point asked for,
+// so showing hours of samples across a chart reads a few thousand records.
+//
+// Block layout, in memory and in the spill file :
+//   block size times, then per signal : block size values (level 0) or block size mins, maxs and means (levels above)
+//
+// Not thread safe, the owner serializes pushes and queries
+class SignalHistory
+{
+public:
+  SignalHistory(size_t block_size=1024, size_t fanout=16, size_t resident_blocks=2);
+  virtual ~SignalHistory();
+
+  // Clears any samples, an empty filename (or one that cannot be written) keeps every block in memory
+  bool Open(const std::string& spill_file, size_t num_signals);
+  // Clears any samples and deletes the spill file
+  void Close();
+  void Clear();
+
+  size_t GetNumberOfSignals() const;
+  size_t GetNumberOfSamples() const;
+  size_t GetNumberOfLevels() const;
+  double GetStartTime_s() const;
+  double GetEndTime_s() const;
+
+  // values holds one sample for every signal, time must not go backwards
+  void Push(double time_s, const double* values);
+  // Drop every sample at or after time_s, i.e. after rewinding the engine
+  void Truncate(double time_s);
+
+  // Up to max_points buckets of a signal between start_s and end_s, each with the time it starts and the min, max and mean of its samples
+  // Returns the level read, each of its records covering fanout^level samples
+  size_t Query(size_t signal, double start_s, double end_s, size_t max_points,
+               std::vector<double>& times, std::vector<double>& mins, std::vector<double>& maxs, std::vector<double>& means) const;
+
+  size_t GetMemoryUsed() const;// bytes, resident blocks and the read cache
+  size_t GetSpilledBytes() const;// Size of the spill file
+
+private:
+  class Data;
+  Data* m_Data;
+};
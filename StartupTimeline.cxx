@@ -0,0 +1,74 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "StartupTimeline.h"
+
+#include <QApplication>
+#include <QEvent>
+#include <QMutex>
+#include <QWidget>
+#include <chrono>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+static const std::chrono::steady_clock::time_point ProcessStart = std::chrono::steady_clock::now();
+static QMutex Mutex;
+static std::vector<std::pair<std::string, double>> Milestones;
+
+class FirstPaintWatcher : public QObject
+{
+public:
+  FirstPaintWatcher(QWidget& window, std::function<void()> painted) : Window(window), Painted(painted) {}
+
+  bool eventFilter(QObject* obj, QEvent* event)
+  {
+    if (event->type() == QEvent::Paint && obj->isWidgetType())
+    {
+      QWidget* w = static_cast<QWidget*>(obj);
+      if (w == &Window || Window.isAncestorOf(w))
+      {
+        qApp->removeEventFilter(this);
+        deleteLater();
+        Painted();
+      }
+    }
+    return false;
+  }
+
+  QWidget&              Window;
+  std::function<void()> Painted;
+};
+
+double StartupTimeline::GetElapsed_s()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - ProcessStart).count();
+}
+
+void StartupTimeline::Mark(const std::string& milestone)
+{
+  double elapsed_s = GetElapsed_s();
+  Mutex.lock();
+  Milestones.push_back(std::make_pair(milestone, elapsed_s));
+  Mutex.unlock();
+}
+
+std::string StartupTimeline::ToString()
+{
+  std::stringstream ss;
+  ss.precision(3);
+  ss << std::fixed << "Startup timeline (s since process start)";
+  double last_s = 0;
+  Mutex.lock();
+  for (const std::pair<std::string, double>& m : Milestones)
+  {
+    ss << "\n  " << m.second << "  (+" << m.second - last_s << ")  " << m.first;
+    last_s = m.second;
+  }
+  Mutex.unlock();
+  return ss.str();
+}
+
+void StartupTimeline::WatchFirstPaint(QWidget& window, std::function<void()> painted)
+{
+  qApp->installEventFilter(new FirstPaintWatcher(window, painted));
+}
@@ -0,0 +1,22 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <functional>
+#include <string>
+
+class QWidget;
+
+// Milestones of application startup, in seconds since the process started
+// (or as close as we can tell, static initialization of this library).
+// Mark them as they happen and dump the timeline whenever asked, so startup regressions are measurable.
+class StartupTimeline
+{
+public:
+  static void Mark(const std::string& milestone);
+  static double GetElapsed_s();
+  static std::string ToString();
+
+  // Calls painted once, the first time anything in the window paints
+  static void WatchFirstPaint(QWidget& window, std::function<void()> painted);
+};
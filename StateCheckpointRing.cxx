@@ -0,0 +1,181 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "StateCheckpointRing.h"
+
+static void WriteVarint(std::string& out, size_t v)
+{
+  while (v >= 0x80)
+  {
+    out.push_back(char((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  out.push_back(char(v));
+}
+
+static size_t ReadVarint(const std::string& in, size_t& pos)
+{
+  size_t v = 0;
+  int shift = 0;
+  while (pos < in.size())
+  {
+    unsigned char b = (unsigned char)in[pos++];
+    v |= size_t(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+      break;
+    shift += 7;
+  }
+  return v;
+}
+
+StateCheckpointRing::StateCheckpointRing(size_t max_checkpoints, size_t keyframe_interval)
+{
+  m_MaxCheckpoints = max_checkpoints < 1 ? 1 : max_checkpoints;
+  m_KeyframeInterval = keyframe_interval < 1 ? 1 : keyframe_interval;
+  Clear();
+}
+
+StateCheckpointRing::~StateCheckpointRing()
+{
+
+}
+
+void StateCheckpointRing::Clear()
+{
+  m_Checkpoints.clear();
+  m_Latest.clear();
+  m_SinceKeyframe = 0;
+  m_MemoryUsed = 0;
+}
+
+void StateCheckpointRing::SetMaxCheckpoints(size_t n)
+{
+  m_MaxCheckpoints = n < 1 ? 1 : n;
+  while (m_Checkpoints.size() > m_MaxCheckpoints)
+  {
+    std::string state;
+    m_MemoryUsed -= m_Checkpoints.front().Bytes.size();
+    if (m_Checkpoints.size() > 1 && !m_Checkpoints[1].Keyframe)
+    {// The next one depends on the one we are dropping, turn it into a keyframe
+      Decode(1, state);
+      m_MemoryUsed += state.size() - m_Checkpoints[1].Bytes.size();
+      m_Checkpoints[1].Bytes.swap(state);
+      m_Checkpoints[1].Keyframe = true;
+    }
+    m_Checkpoints.pop_front();
+  }
+}
+
+void StateCheckpointRing::Add(double time_s, const std::string& state)
+{
+  // Anything newer than this time is on a timeline we rewound away from
+  while (!m_Checkpoints.empty() && m_Checkpoints.back().Time_s >= time_s)
+  {
+    m_MemoryUsed -= m_Checkpoints.back().Bytes.size();
+    m_Checkpoints.pop_back();
+    if (m_Checkpoints.empty())
+      m_Latest.clear();
+    else
+      Decode(m_Checkpoints.size() - 1, m_Latest);
+    m_SinceKeyframe = 0;
+    for (size_t i = m_Checkpoints.size(); i > 0 && !m_Checkpoints[i - 1].Keyframe; i--)
+      m_SinceKeyframe++;
+  }
+
+  Checkpoint cp;
+  cp.Time_s = time_s;
+  cp.Size = state.size();
+  cp.Keyframe = m_Checkpoints.empty() || m_SinceKeyframe + 1 >= m_KeyframeInterval;
+  if (cp.Keyframe)
+  {
+    cp.Bytes = state;
+    m_SinceKeyframe = 0;
+  }
+  else
+  {
+    Encode(m_Latest, state, cp.Bytes);
+    m_SinceKeyframe++;
+  }
+  m_Latest = state;
+  m_MemoryUsed += cp.Bytes.size();
+  m_Checkpoints.push_back(cp);
+  SetMaxCheckpoints(m_MaxCheckpoints);
+}
+
+bool StateCheckpointRing::Restore(double time_s, double& checkpoint_time_s, std::string& state) const
+{
+  if (m_Checkpoints.empty() || m_Checkpoints.front().Time_s > time_s)
+    return false;
+  size_t idx = m_Checkpoints.size() - 1;
+  while (m_Checkpoints[idx].Time_s > time_s)
+    idx--;
+  checkpoint_time_s = m_Checkpoints[idx].Time_s;
+  Decode(idx, state);
+  return true;
+}
+
+size_t StateCheckpointRing::GetNumberOfCheckpoints() const { return m_Checkpoints.size(); }
+double StateCheckpointRing::GetEarliestTime_s() const { return m_Checkpoints.empty() ? 0 : m_Checkpoints.front().Time_s; }
+double StateCheckpointRing::GetLatestTime_s() const { return m_Checkpoints.empty() ? 0 : m_Checkpoints.back().Time_s; }
+size_t StateCheckpointRing::GetMemoryUsed() const { return m_MemoryUsed + m_Latest.size(); }
+
+void StateCheckpointRing::Decode(size_t idx, std::string& state) const
+{
+  size_t key = idx;
+  while (!m_Checkpoints[key].Keyframe)
+    key--;
+  state = m_Checkpoints[key].Bytes;
+  std::string next;
+  for (size_t i = key + 1; i <= idx; i++)
+  {
+    Decode(state, m_Checkpoints[i].Bytes, m_Checkpoints[i].Size, next);
+    state.swap(next);
+  }
+}
+
+// Delta layout is a sequence of (unchanged run length, changed run length, xor bytes of the changed run)
+void StateCheckpointRing::Encode(const std::string& previous, const std::string& current, std::string& delta)
+{
+  delta.clear();
+  size_t size = current.size();
+  size_t pos = 0;
+  while (pos < size)
+  {
+    size_t start = pos;
+    while (pos < size && pos < previous.size() && previous[pos] == current[pos])
+      pos++;
+    WriteVarint(delta, pos - start);
+
+    // Changed bytes run until we see a few unchanged ones in a row
+    start = pos;
+    size_t same = 0;
+    while (pos < size && same < 4)
+    {
+      if (pos < previous.size() && previous[pos] == current[pos])
+        same++;
+      else
+        same = 0;
+      pos++;
+    }
+    if (same == 4)
+      pos -= 4;
+    WriteVarint(delta, pos - start);
+    for (size_t i = start; i < pos; i++)
+      delta.push_back(i < previous.size() ? char(previous[i] ^ current[i]) : current[i]);
+  }
+}
+
+void StateCheckpointRing::Decode(const std::string& previous, const std::string& delta, size_t size, std::string& current)
+{
+  current.resize(size);
+  size_t in = 0;
+  size_t out = 0;
+  while (in < delta.size() && out < size)
+  {
+    size_t same = ReadVarint(delta, in);
+    for (size_t i = 0; i < same; i++, out++)
+      current[out] = previous[out];
+    size_t changed = ReadVarint(delta, in);
+    for (size_t i = 0; i < changed; i++, out++, in++)
+      current[out] = out < previous.size() ? char(previous[out] ^ delta[in]) : delta[in];
+  }
+}
@@ -0,0 +1,49 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <deque>
+#include <string>
+
+// Bounded ring of serialized engine states kept in memory.
+// Every checkpoint is stored as a delta against the one before it
+// (xor of the two byte streams, with runs of unchanged bytes collapsed),
+// with a full keyframe every few checkpoints so a restore never has to walk far.
+class StateCheckpointRing
+{
+public:
+  StateCheckpointRing(size_t max_checkpoints=360, size_t keyframe_interval=8);
+  virtual ~StateCheckpointRing();
+
+  void Clear();
+  void SetMaxCheckpoints(size_t n);
+
+  void Add(double time_s, const std::string& state);
+  // Find the latest checkpoint at or before time_s, return false if there is none
+  bool Restore(double time_s, double& checkpoint_time_s, std::string& state) const;
+
+  size_t GetNumberOfCheckpoints() const;
+  double GetEarliestTime_s() const;
+  double GetLatestTime_s() const;
+  size_t GetMemoryUsed() const;// bytes
+
+protected:
+  struct Checkpoint
+  {
+    double      Time_s;
+    bool        Keyframe;
+    size_t      Size;  // Size of the decoded state
+    std::string Bytes; // Full state for keyframes, encoded delta otherwise
+  };
+
+  static void Encode(const std::string& previous, const std::string& current, std::string& delta);
+  static void Decode(const std::string& previous, const std::string& delta, size_t size, std::string& current);
+  void Decode(size_t idx, std::string& state) const;
+
+  std::deque<Checkpoint> m_Checkpoints;
+  std::string            m_Latest;// Decoded copy of the newest checkpoint, the base of the next delta
+  size_t                 m_MaxCheckpoints;
+  size_t                 m_KeyframeInterval;
+  size_t                 m_SinceKeyframe;
+  size_t                 m_MemoryUsed;
+};
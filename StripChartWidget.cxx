@@ -0,0 +1,447 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "StripChartWidget.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QFontMetrics>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+static const char* VertexShader =
+  "attribute vec2 position;\n"
+  "attribute vec4 color;\n"
+  "uniform vec4 transform;\n"
+  "varying vec4 v_color;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_Position = vec4(position * transform.xy + transform.zw, 0.0, 1.0);\n"
+  "  v_color = color;\n"
+  "}\n";
+
+static const char* FragmentShader =
+  "#ifdef GL_ES\n"
+  "precision mediump float;\n"
+  "#endif\n"
+  "varying vec4 v_color;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = v_color;\n"
+  "}\n";
+
+// Keep x within this of the origin so it does not lose precision as a float
+static const double MaxOffset_s = 1000;
+// Dashes are this many segments on, then this many off
+static const size_t DashSegments = 3;
+
+struct StripVertex
+{
+  float         X;
+  float         Y;
+  unsigned char Color[4];
+};
+
+struct StripGhost
+{
+  std::vector<double> Times;
+  std::vector<double> Values;
+  QColor              Color;
+};
+
+static void SetVertex(StripVertex& v, double x, double y, const QColor& c)
+{
+  v.X = float(x);
+  v.Y = float(y);
+  v.Color[0] = (unsigned char)c.red();
+  v.Color[1] = (unsigned char)c.green();
+  v.Color[2] = (unsigned char)c.blue();
+  v.Color[3] = (unsigned char)c.alpha();
+}
+
+// Round a tick spacing to 1, 2 or 5 times a power of 10
+static double NiceStep(double range, int ticks)
+{
+  double raw = range / ticks;
+  if (!(raw > 0))
+    return 1;
+  double p = std::pow(10., std::floor(std::log10(raw)));
+  double f = raw / p;
+  return (f < 1.5 ? 1 : f < 3 ? 2 : f < 7 ? 5 : 10) * p;
+}
+
+// Live sample n is kept in slot n % Capacity, slot 0 is repeated at slot Capacity so the
+// segment from the last slot back around to the first can be drawn like any other.
+// Segment k joins slot k to slot k+1, and is collapsed to a point unless both of its samples are live.
+class StripChartWidget::Data
+{
+public:
+  Data() : VertexBuffer(QOpenGLBuffer::VertexBuffer), IndexBuffer(QOpenGLBuffer::IndexBuffer) {}
+
+  size_t               Capacity;
+  std::vector<double>  Times;
+  std::vector<double>  Values;
+  uint64_t             First = 0;
+  uint64_t             Next = 0;
+  double               Origin = 0;
+
+  std::vector<StripGhost> Ghosts;
+
+  QString              Title;
+  QColor               TraceColor = QColor(32, 159, 223);
+  QColor               Background = Qt::white;
+  bool                 AxesVisible = true;
+  double               MinX = 0;
+  double               MaxX = 1;
+  double               MinY = 0;
+  double               MaxY = 1;
+
+  // What is on the GPU
+  QOpenGLShaderProgram* Program = nullptr;
+  QOpenGLBuffer        VertexBuffer;
+  QOpenGLBuffer        IndexBuffer;
+  size_t               VertexBufferSize = 0;
+  size_t               IndexBufferSize = 0;
+  size_t               NumIndices = 0;
+  bool                 UploadAll = true;
+  bool                 UploadGhosts = true;
+  uint64_t             UploadFrom = 0;// Live samples from here on are not uploaded yet
+  std::vector<StripVertex> VertexScratch;
+  std::vector<GLuint>      IndexScratch;
+
+  size_t RingVertices() const { return Capacity + 1; }
+  size_t RingIndices() const { return 2 * Capacity; }
+
+  void Push(double t, double v)
+  {
+    size_t slot = size_t(Next % Capacity);
+    Times[slot] = t;
+    Values[slot] = v;
+    Next++;
+    if (Next - First > Capacity)
+      First = Next - Capacity;
+  }
+
+  void Rebase(double t)
+  {
+    if (std::fabs(t - Origin) < MaxOffset_s)
+      return;
+    Origin = t;
+    UploadAll = true;
+    UploadGhosts = true;
+  }
+
+  // Write the vertex and segment of one live slot into the scratch buffers at position i
+  void WriteSlot(size_t slot, size_t i)
+  {
+    uint64_t n = Next == 0 ? 0 : Next - 1 - (Next - 1 - slot) % Capacity;// The sample in this slot
+    bool live = Next > 0 && slot < Next && n >= First;
+    SetVertex(VertexScratch[i], live ? Times[slot] - Origin : 0, live ? Values[slot] : 0, TraceColor);
+    IndexScratch[2 * i] = GLuint(slot);
+    IndexScratch[2 * i + 1] = GLuint(live && n + 1 < Next ? slot + 1 : slot);
+  }
+
+  // Upload live slots [begin, end)
+  void UploadSlots(size_t begin, size_t end)
+  {
+    size_t count = end - begin;
+    VertexScratch.resize(count);
+    IndexScratch.resize(2 * count);
+    for (size_t s = begin; s < end; s++)
+      WriteSlot(s, s - begin);
+    VertexBuffer.write(int(begin * sizeof(StripVertex)), VertexScratch.data(), int(count * sizeof(StripVertex)));
+    IndexBuffer.write(int(2 * begin * sizeof(GLuint)), IndexScratch.data(), int(2 * count * sizeof(GLuint)));
+    if (begin == 0)
+      VertexBuffer.write(int(Capacity * sizeof(StripVertex)), VertexScratch.data(), int(sizeof(StripVertex)));
+  }
+
+  void UploadGhostTraces()
+  {
+    VertexScratch.clear();
+    IndexScratch.clear();
+    for (const StripGhost& ghost : Ghosts)
+    {
+      size_t base = RingVertices() + VertexScratch.size();
+      size_t n = std::min(ghost.Times.size(), ghost.Values.size());
+      for (size_t i = 0; i < n; i++)
+      {
+        VertexScratch.push_back(StripVertex());
+        SetVertex(VertexScratch.back(), ghost.Times[i] - Origin, ghost.Values[i], ghost.Color);
+      }
+      for (size_t i = 0; i + 1 < n; i++)
+      {
+        if ((i / DashSegments) % 2 != 0)
+          continue;
+        IndexScratch.push_back(GLuint(base + i));
+        IndexScratch.push_back(GLuint(base + i + 1));
+      }
+    }
+    if (!VertexScratch.empty())
+    {
+      VertexBuffer.write(int(RingVertices() * sizeof(StripVertex)), VertexScratch.data(), int(VertexScratch.size() * sizeof(StripVertex)));
+      IndexBuffer.write(int(RingIndices() * sizeof(GLuint)), IndexScratch.data(), int(IndexScratch.size() * sizeof(GLuint)));
+    }
+    NumIndices = RingIndices() + IndexScratch.size();
+    UploadGhosts = false;
+  }
+
+  // Called with the context current, only sends what changed since the last frame
+  void Upload()
+  {
+    size_t ghostVertices = 0;
+    size_t ghostIndices = 0;
+    for (const StripGhost& ghost : Ghosts)
+    {
+      size_t n = std::min(ghost.Times.size(), ghost.Values.size());
+      ghostVertices += n;
+      ghostIndices += n > 1 ? 2 * (n - 1) : 0;
+    }
+    size_t vertices = RingVertices() + ghostVertices;
+    size_t indices = RingIndices() + ghostIndices;
+    VertexBuffer.bind();
+    IndexBuffer.bind();
+    if (vertices > VertexBufferSize || indices > IndexBufferSize)
+    {// Grow with some room for the next ghost
+      VertexBufferSize = std::max(vertices, RingVertices() + 2 * ghostVertices);
+      IndexBufferSize = std::max(indices, RingIndices() + 2 * ghostIndices);
+      VertexBuffer.allocate(int(VertexBufferSize * sizeof(StripVertex)));
+      IndexBuffer.allocate(int(IndexBufferSize * sizeof(GLuint)));
+      UploadAll = true;
+      UploadGhosts = true;
+    }
+
+    if (UploadAll || Next - std::max(First, UploadFrom) >= Capacity)
+    {
+      UploadSlots(0, Capacity);
+      UploadAll = false;
+    }
+    else if (UploadFrom < Next)
+    {// The new samples, and the segment that now joins the previous newest sample to them
+      uint64_t from = std::max(First, UploadFrom > 0 ? UploadFrom - 1 : 0);
+      size_t begin = size_t(from % Capacity);
+      size_t end = size_t((Next - 1) % Capacity) + 1;
+      if (begin < end)
+        UploadSlots(begin, end);
+      else
+      {
+        UploadSlots(begin, Capacity);
+        UploadSlots(0, end);
+      }
+    }
+    UploadFrom = Next;
+    if (UploadGhosts)
+      UploadGhostTraces();
+  }
+};
+
+StripChartWidget::StripChartWidget(size_t capacity, QWidget *parent) : QOpenGLWidget(parent)
+{
+  m_Data = new StripChartWidget::Data();
+  m_Data->Capacity = std::max(size_t(2), capacity);
+  m_Data->Times.resize(m_Data->Capacity);
+  m_Data->Values.resize(m_Data->Capacity);
+}
+
+StripChartWidget::~StripChartWidget()
+{
+  if (m_Data->Program != nullptr)
+  {
+    makeCurrent();
+    m_Data->VertexBuffer.destroy();
+    m_Data->IndexBuffer.destroy();
+    delete m_Data->Program;
+    doneCurrent();
+  }
+  delete m_Data;
+}
+
+void StripChartWidget::SetTitle(const QString& title)
+{
+  m_Data->Title = title;
+  update();
+}
+
+void StripChartWidget::SetTraceColor(const QColor& color)
+{
+  m_Data->TraceColor = color;
+  m_Data->UploadAll = true;
+  update();
+}
+
+void StripChartWidget::SetBackgroundColor(const QColor& color)
+{
+  m_Data->Background = color;
+  update();
+}
+
+void StripChartWidget::SetAxesVisible(bool b)
+{
+  m_Data->AxesVisible = b;
+  update();
+}
+
+void StripChartWidget::SetRange(double min_x, double max_x, double min_y, double max_y)
+{
+  m_Data->MinX = min_x;
+  m_Data->MaxX = max_x > min_x ? max_x : min_x + 1;
+  m_Data->MinY = min_y;
+  m_Data->MaxY = max_y > min_y ? max_y : min_y + 1;
+  update();
+}
+
+void StripChartWidget::SetSamples(const double* times, const double* values, size_t n)
+{
+  m_Data->First = m_Data->Next = 0;
+  size_t skip = n > m_Data->Capacity ? n - m_Data->Capacity : 0;
+  for (size_t i = skip; i < n; i++)
+    m_Data->Push(times[i], values[i]);
+  m_Data->Origin = n > 0 ? times[skip] : 0;
+  m_Data->UploadAll = true;
+  m_Data->UploadGhosts = true;
+  update();
+}
+
+void StripChartWidget::AppendSamples(const double* times, const double* values, size_t n)
+{
+  if (n == 0)
+    return;
+  if (m_Data->Next == m_Data->First)
+    m_Data->Origin = times[0];
+  m_Data->Rebase(times[n - 1]);
+  for (size_t i = 0; i < n; i++)
+    m_Data->Push(times[i], values[i]);
+  update();
+}
+
+void StripChartWidget::AddGhost(const std::vector<double>& times, const std::vector<double>& values, const QColor& color)
+{
+  StripGhost ghost;
+  ghost.Times = times;
+  ghost.Values = values;
+  ghost.Color = color;
+  m_Data->Ghosts.push_back(ghost);
+  m_Data->UploadGhosts = true;
+  update();
+}
+
+void StripChartWidget::ClearGhosts()
+{
+  if (m_Data->Ghosts.empty())
+    return;
+  m_Data->Ghosts.clear();
+  m_Data->UploadGhosts = true;
+  update();
+}
+
+size_t StripChartWidget::GetMemoryUsed() const
+{
+  const Data& d = *m_Data;
+  size_t bytes = (d.Times.capacity() + d.Values.capacity()) * sizeof(double);
+  for (const StripGhost& ghost : d.Ghosts)
+    bytes += (ghost.Times.capacity() + ghost.Values.capacity()) * sizeof(double);
+  bytes += d.VertexScratch.capacity() * sizeof(StripVertex) + d.IndexScratch.capacity() * sizeof(GLuint);
+  bytes += d.VertexBufferSize * sizeof(StripVertex) + d.IndexBufferSize * sizeof(GLuint);
+  return bytes;
+}
+
+void StripChartWidget::initializeGL()
+{
+  initializeOpenGLFunctions();
+  // We can get a new context (i.e. when reparented), start over
+  delete m_Data->Program;
+  m_Data->Program = new QOpenGLShaderProgram();
+  m_Data->Program->addShaderFromSourceCode(QOpenGLShader::Vertex, VertexShader);
+  m_Data->Program->addShaderFromSourceCode(QOpenGLShader::Fragment, FragmentShader);
+  m_Data->Program->bindAttributeLocation("position", 0);
+  m_Data->Program->bindAttributeLocation("color", 1);
+  m_Data->Program->link();
+  m_Data->VertexBuffer.destroy();
+  m_Data->IndexBuffer.destroy();
+  m_Data->VertexBuffer.create();
+  m_Data->IndexBuffer.create();
+  m_Data->VertexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  m_Data->IndexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  m_Data->VertexBufferSize = 0;
+  m_Data->IndexBufferSize = 0;
+  m_Data->UploadAll = true;
+  m_Data->UploadGhosts = true;
+}
+
+void StripChartWidget::paintGL()
+{
+  Data& d = *m_Data;
+  QPainter painter(this);
+  painter.fillRect(rect(), d.Background);
+
+  QRectF plot = rect();
+  if (d.AxesVisible)
+  {
+    QFont font = painter.font();
+    font.setPointSize(9);
+    painter.setFont(font);
+    QFontMetrics metrics(font);
+    plot.adjust(60, metrics.height() * 2 + 4, -15, -metrics.height() - 8);
+    painter.setPen(Qt::black);
+    QFont titleFont = font;
+    titleFont.setBold(true);
+    titleFont.setPointSize(11);
+    painter.setFont(titleFont);
+    painter.drawText(QRectF(0, 4, width(), metrics.height() * 2), Qt::AlignHCenter | Qt::AlignVCenter, d.Title);
+    painter.setFont(font);
+
+    QPen grid(QColor(220, 220, 220));
+    double xStep = NiceStep(d.MaxX - d.MinX, 5);
+    for (double x = std::ceil(d.MinX / xStep) * xStep; x <= d.MaxX; x += xStep)
+    {
+      double px = plot.left() + (x - d.MinX) / (d.MaxX - d.MinX) * plot.width();
+      painter.setPen(grid);
+      painter.drawLine(QPointF(px, plot.top()), QPointF(px, plot.bottom()));
+      painter.setPen(Qt::darkGray);
+      painter.drawText(QRectF(px - 40, plot.bottom() + 4, 80, metrics.height()), Qt::AlignHCenter | Qt::AlignTop, QString::number(x, 'g', 5));
+    }
+    double yStep = NiceStep(d.MaxY - d.MinY, 5);
+    for (double y = std::ceil(d.MinY / yStep) * yStep; y <= d.MaxY; y += yStep)
+    {
+      double py = plot.bottom() - (y - d.MinY) / (d.MaxY - d.MinY) * plot.height();
+      painter.setPen(grid);
+      painter.drawLine(QPointF(plot.left(), py), QPointF(plot.right(), py));
+      painter.setPen(Qt::darkGray);
+      painter.drawText(QRectF(0, py - metrics.height() / 2., plot.left() - 6, metrics.height()), Qt::AlignRight | Qt::AlignVCenter, QString::number(y, 'g', 4));
+    }
+    painter.setPen(QColor(120, 120, 120));
+    painter.drawRect(plot);
+  }
+
+  painter.beginNativePainting();
+  d.Upload();
+  qreal dpr = devicePixelRatioF();
+  GLint x = GLint(plot.left() * dpr);
+  GLint y = GLint((height() - plot.bottom()) * dpr);
+  GLsizei w = GLsizei(plot.width() * dpr);
+  GLsizei h = GLsizei(plot.height() * dpr);
+  glViewport(x, y, w, h);
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(x, y, w, h);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glLineWidth(GLfloat(2 * dpr));
+
+  d.Program->bind();
+  float sx = float(2 / (d.MaxX - d.MinX));
+  float sy = float(2 / (d.MaxY - d.MinY));
+  d.Program->setUniformValue("transform", sx, sy, float(-1 - (d.MinX - d.Origin) * sx), float(-1 - d.MinY * sy));
+  d.Program->enableAttributeArray(0);
+  d.Program->enableAttributeArray(1);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(StripVertex), (const void*)0);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StripVertex), (const void*)(2 * sizeof(float)));
+  // Everything in one go, collapsed segments draw nothing
+  glDrawElements(GL_LINES, GLsizei(d.NumIndices), GL_UNSIGNED_INT, (const void*)0);
+  d.Program->disableAttributeArray(0);
+  d.Program->disableAttributeArray(1);
+  d.Program->release();
+  d.VertexBuffer.release();
+  d.IndexBuffer.release();
+  glDisable(GL_SCISSOR_TEST);
+  painter.endNativePainting();
+}
@@ -0,0 +1,46 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <vector>
+
+// A scrolling line chart drawn with plain OpenGL (2.0 / GLSL 1.10, so Mesa llvmpipe is fine).
+// The live trace is a ring of vertices in a buffer that lives as long as the widget,
+// appending only uploads the new samples (and the few line segment indices they touch).
+// The live trace and any ghost traces share one vertex and index buffer and are drawn with a single call,
+// the title, grid and axis labels are painted over it with QPainter.
+class StripChartWidget : public QOpenGLWidget, protected QOpenGLFunctions
+{
+  Q_OBJECT
+public:
+  StripChartWidget(size_t capacity, QWidget *parent = Q_NULLPTR);
+  virtual ~StripChartWidget();
+
+  void SetTitle(const QString& title);
+  void SetTraceColor(const QColor& color);
+  void SetBackgroundColor(const QColor& color);
+  // Title, grid and tick labels
+  void SetAxesVisible(bool b);
+  void SetRange(double min_x, double max_x, double min_y, double max_y);
+
+  // Replace the live trace with the last (up to capacity) samples
+  void SetSamples(const double* times, const double* values, size_t n);
+  // Add samples to the end of the live trace, dropping the oldest past capacity
+  void AppendSamples(const double* times, const double* values, size_t n);
+
+  // Dashed traces drawn with the live trace
+  void AddGhost(const std::vector<double>& times, const std::vector<double>& values, const QColor& color);
+  void ClearGhosts();
+
+  size_t GetMemoryUsed() const;// bytes, host copies and GPU buffers
+
+protected:
+  void initializeGL() override;
+  void paintGL() override;
+
+private:
+  class Data;
+  Data* m_Data;
+};
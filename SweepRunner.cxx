@@ -0,0 +1,298 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "SweepRunner.h"
+#include "MemoryAccounting.h"
+
+#include <QDir>
+#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "cdm/CommonDataModel.h"
+#include "PulsePhysiologyEngine.h"
+#include "cdm/system/physiology/SECardiovascularSystem.h"
+#include "cdm/patient/actions/SEHemorrhage.h"
+#include "cdm/patient/actions/SETensionPneumothorax.h"
+#include "cdm/patient/actions/SENeedleDecompression.h"
+#include "cdm/properties/SEScalarTime.h"
+#include "cdm/properties/SEScalar0To1.h"
+#include "cdm/properties/SEScalarPressure.h"
+#include "cdm/properties/SEScalarVolume.h"
+#include "cdm/properties/SEScalarVolumePerTime.h"
+
+struct SweepRun
+{
+  double      HemorrhageRate_mL_Per_min;
+  double      PneumothoraxSeverity;
+  double      InterventionDelay_s;
+  std::string Key;
+};
+
+class SweepRunner::Controls
+{
+public:
+  std::string               StateFile = "states/Soldier@0s.pba";
+  std::string               ResultsFile = "sweep_results.csv";
+  std::vector<double>       HemorrhageRates_mL_Per_min = { 50, 100, 150, 200, 250, 300, 350, 400, 450, 500 };
+  std::vector<double>       PneumothoraxSeverities = { 0.0, 0.3, 0.6, 0.9 };
+  std::vector<double>       InterventionDelays_s = { 60, 120, 300 };
+  double                    RunDuration_s = 900;
+  size_t                    NumThreads = 0;
+
+  std::vector<SweepRun>     Runs;// Runs left to do
+  std::vector<std::thread>  Workers;
+  std::atomic<size_t>       NextRun;
+  std::atomic<size_t>       ActiveWorkers;
+  std::atomic<int>          Completed;
+  std::atomic<int>          Failed;
+  std::atomic<bool>         Cancel;
+  int                       Total = 0;
+  QMutex                    ResultsMutex;
+  std::ofstream             Results;
+
+  void Join()
+  {
+    for (std::thread& t : Workers)
+    {
+      if (t.joinable())
+        t.join();
+    }
+    Workers.clear();
+  }
+};
+
+SweepRunner::SweepRunner(QObject* parent) : QObject(parent)
+{
+  m_Controls = new Controls();
+  m_Controls->NextRun = 0;
+  m_Controls->ActiveWorkers = 0;
+  m_Controls->Completed = 0;
+  m_Controls->Cancel = false;
+}
+
+SweepRunner::~SweepRunner()
+{
+  Stop();
+  delete m_Controls;
+}
+
+void SweepRunner::SetStateFile(const std::string& file) { m_Controls->StateFile = file; }
+void SweepRunner::SetResultsFile(const std::string& file) { m_Controls->ResultsFile = file; }
+const std::string& SweepRunner::GetResultsFile() const { return m_Controls->ResultsFile; }
+void SweepRunner::SetHemorrhageRates_mL_Per_min(const std::vector<double>& rates) { m_Controls->HemorrhageRates_mL_Per_min = rates; }
+void SweepRunner::SetPneumothoraxSeverities(const std::vector<double>& severities) { m_Controls->PneumothoraxSeverities = severities; }
+void SweepRunner::SetInterventionDelays_s(const std::vector<double>& delays) { m_Controls->InterventionDelays_s = delays; }
+void SweepRunner::SetRunDuration_s(double duration) { m_Controls->RunDuration_s = duration; }
+void SweepRunner::SetNumberOfThreads(size_t n) { m_Controls->NumThreads = n; }
+
+size_t SweepRunner::GetNumberOfRuns() const
+{
+  return m_Controls->HemorrhageRates_mL_Per_min.size() * m_Controls->PneumothoraxSeverities.size() * m_Controls->InterventionDelays_s.size();
+}
+
+size_t SweepRunner::GetNumberOfRunsLeft() const
+{
+  return m_Controls->Runs.size();
+}
+
+int SweepRunner::GetNumberOfFailedRuns() const
+{
+  return m_Controls->Failed;
+}
+
+bool SweepRunner::IsRunning() const
+{
+  return m_Controls->ActiveWorkers > 0;
+}
+
+static std::string RunKey(double rate, double severity, double delay)
+{
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3) << rate << "," << severity << "," << delay;
+  return ss.str();
+}
+
+bool SweepRunner::Start()
+{
+  if (IsRunning())
+    return false;
+  m_Controls->Join();
+
+  // Anything that did not fail in the results table is done, pick up where we left off
+  std::set<std::string> done;
+  bool haveHeader = false;
+  std::ifstream existing(m_Controls->ResultsFile);
+  std::string line;
+  while (std::getline(existing, line))
+  {
+    if (!haveHeader)
+    {
+      haveHeader = true;
+      continue;
+    }
+    // Key is the first 3 columns
+    size_t comma = 0;
+    for (int c = 0; c < 3 && comma != std::string::npos; c++)
+      comma = line.find(',', comma + 1);
+    if (comma != std::string::npos && line.compare(line.rfind(',') + 1, std::string::npos, "Failed") != 0)
+      done.insert(line.substr(0, comma));
+  }
+  existing.close();
+
+  m_Controls->Runs.clear();
+  for (double rate : m_Controls->HemorrhageRates_mL_Per_min)
+  {
+    for (double severity : m_Controls->PneumothoraxSeverities)
+    {
+      for (double delay : m_Controls->InterventionDelays_s)
+      {
+        SweepRun run;
+        run.HemorrhageRate_mL_Per_min = rate;
+        run.PneumothoraxSeverity = severity;
+        run.InterventionDelay_s = delay;
+        run.Key = RunKey(rate, severity, delay);
+        if (done.find(run.Key) == done.end())
+          m_Controls->Runs.push_back(run);
+      }
+    }
+  }
+  m_Controls->Total = (int)GetNumberOfRuns();
+  m_Controls->Completed = m_Controls->Total - (int)m_Controls->Runs.size();
+  m_Controls->Failed = 0;
+  if (m_Controls->Runs.empty())
+    return false;
+
+  QDir().mkpath("sweep");// Run logs
+  m_Controls->Results.open(m_Controls->ResultsFile, std::ios::app);
+  if (!m_Controls->Results.is_open())
+    return false;
+  if (!haveHeader)
+    m_Controls->Results << "HemorrhageRate(mL/min),PneumothoraxSeverity,InterventionDelay(s),"
+                        << "TimeToMAPBelow50mmHg(s),MinMAP(mmHg),FinalBloodVolume(mL),Status" << std::endl;
+
+  size_t numThreads = m_Controls->NumThreads;
+  if (numThreads == 0)
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  numThreads = std::min(numThreads, m_Controls->Runs.size());
+
+  m_Controls->Cancel = false;
+  m_Controls->NextRun = 0;
+  m_Controls->ActiveWorkers = numThreads;
+  for (size_t t = 0; t < numThreads; t++)
+  {
+    m_Controls->Workers.push_back(std::thread([this]()
+    {
+      MemoryAccounting::SetThreadHeap(MemoryAccounting::BackgroundEngineHeap);
+      Controls& c = *m_Controls;
+      size_t idx;
+      while (!c.Cancel && (idx = c.NextRun++) < c.Runs.size())
+      {
+        const SweepRun& run = c.Runs[idx];
+        double timeToMAP50_s = -1;
+        double minMAP_mmHg = std::numeric_limits<double>::max();
+        double bloodVolume_mL = 0;
+        std::string status = "Complete";
+
+        std::unique_ptr<PhysiologyEngine> pulse = CreatePulseEngine("sweep/" + run.Key + ".log");
+        pulse->GetLogger()->SetLogLevel(log4cpp::Priority::WARN);
+        try
+        {
+          if (!pulse->LoadStateFile(c.StateFile))
+            throw CommonDataModelException("Unable to load state file");
+
+          SEHemorrhage hemorrhage;
+          hemorrhage.GetRate().SetValue(run.HemorrhageRate_mL_Per_min, VolumePerTimeUnit::mL_Per_min);
+          hemorrhage.SetCompartment(pulse::VascularCompartment::RightLeg);
+          pulse->ProcessAction(hemorrhage);
+          if (run.PneumothoraxSeverity > 0)
+          {
+            SETensionPneumothorax pneumothorax;
+            pneumothorax.SetSide(cdm::eSide::Left);
+            pneumothorax.SetType(cdm::eGate::Closed);
+            pneumothorax.GetSeverity().SetValue(run.PneumothoraxSeverity);
+            pulse->ProcessAction(pneumothorax);
+          }
+
+          bool intervened = false;
+          double dt_s = pulse->GetTimeStep(TimeUnit::s);
+          double start_s = pulse->GetSimulationTime(TimeUnit::s);
+          double elapsed_s = 0;
+          while (elapsed_s < c.RunDuration_s && !c.Cancel)
+          {
+            if (!intervened && elapsed_s >= run.InterventionDelay_s)
+            {
+              intervened = true;
+              SEHemorrhage tourniquet;
+              tourniquet.GetRate().SetValue(0, VolumePerTimeUnit::mL_Per_min);
+              tourniquet.SetCompartment(pulse::VascularCompartment::RightLeg);
+              pulse->ProcessAction(tourniquet);
+              if (run.PneumothoraxSeverity > 0)
+              {
+                SENeedleDecompression needle;
+                needle.SetActive(true);
+                needle.SetSide(cdm::eSide::Left);
+                pulse->ProcessAction(needle);
+              }
+            }
+            pulse->AdvanceModelTime(dt_s, TimeUnit::s);
+            elapsed_s = pulse->GetSimulationTime(TimeUnit::s) - start_s;
+
+            double map_mmHg = pulse->GetCardiovascularSystem()->GetMeanArterialPressure(PressureUnit::mmHg);
+            if (map_mmHg < minMAP_mmHg)
+              minMAP_mmHg = map_mmHg;
+            if (timeToMAP50_s < 0 && map_mmHg < 50)
+              timeToMAP50_s = elapsed_s;
+          }
+          bloodVolume_mL = pulse->GetCardiovascularSystem()->GetBloodVolume(VolumeUnit::mL);
+          if (c.Cancel)
+            status = "Cancelled";
+        }
+        catch (CommonDataModelException ex)
+        {
+          status = "Failed";
+        }
+        catch (std::exception& ex)
+        {// i.e. protobuf errors, an exception out of this thread would terminate the Explorer
+          status = "Failed";
+        }
+        catch (...)
+        {
+          status = "Failed";
+        }
+        if (status == "Cancelled")
+          break;// Leave it out of the table so it is run again on resume
+
+        std::stringstream row;
+        row << run.Key << "," << timeToMAP50_s << "," << minMAP_mmHg << "," << bloodVolume_mL << "," << status;
+        c.ResultsMutex.lock();
+        c.Results << row.str() << std::endl;
+        c.ResultsMutex.unlock();
+        if (status == "Failed")
+          c.Failed++;
+        else
+          c.Completed++;
+        emit RunCompleted(QString(row.str().c_str()));
+      }
+      if (--c.ActiveWorkers == 0)
+      {
+        c.Results.close();
+        emit SweepFinished(c.Completed, c.Total);
+      }
+    }));
+  }
+  return true;
+}
+
+void SweepRunner::Stop()
+{
+  m_Controls->Cancel = true;
+  m_Controls->Join();
+}
@@ -0,0 +1,46 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <string>
+#include <vector>
+
+// Expands a MultiTrauma parameter grid (hemorrhage rate x pneumothorax severity x intervention delay)
+// into independent engine runs, each starting from the same cached state file.
+// Runs are spread across all cores and every finished run is appended to a single results table,
+// runs already present in that table are skipped, so an interrupted sweep resumes where it stopped.
+// Runs that failed are recorded too, but they are run again by the next Start.
+class SweepRunner : public QObject
+{
+  Q_OBJECT
+public:
+  SweepRunner(QObject* parent = Q_NULLPTR);
+  virtual ~SweepRunner();
+
+  void SetStateFile(const std::string& file);
+  void SetResultsFile(const std::string& file);
+  const std::string& GetResultsFile() const;
+  void SetHemorrhageRates_mL_Per_min(const std::vector<double>& rates);
+  void SetPneumothoraxSeverities(const std::vector<double>& severities);
+  void SetInterventionDelays_s(const std::vector<double>& delays);
+  void SetRunDuration_s(double duration);
+  void SetNumberOfThreads(size_t n);// 0 = all cores
+
+  size_t GetNumberOfRuns() const;
+  size_t GetNumberOfRunsLeft() const;// Not yet complete in the results table, as of the last Start
+  int GetNumberOfFailedRuns() const;// By the last Start, they are run again on the next one
+  bool IsRunning() const;
+
+  bool Start();// return false if already running, nothing left to run or the results file cannot be written
+  void Stop(); // Cancels outstanding runs, completed runs stay in the results file
+
+signals:
+  void RunCompleted(QString summary);
+  void SweepFinished(int completed, int total);
+
+private:
+  class Controls;
+  Controls* m_Controls;
+};
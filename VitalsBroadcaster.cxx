@@ -0,0 +1,245 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "VitalsBroadcaster.h"
+
+#include <QThread>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <algorithm>
+
+// Stop writing to a socket once this much is waiting in its kernel/Qt buffers
+static const qint64 MaxSocketBacklog = 64 * 1024;
+// If the fan-out thread cannot keep up, older samples are thrown away
+static const size_t MaxPendingSamples = 4096;
+
+class VitalsBroadcaster::Data
+{
+public:
+  std::vector<VitalsChannel> Channels;
+  size_t                     MaxQueued;
+  QMutex                     Mutex;// Publish can come from any thread
+  QThread*                   Thread = nullptr;
+  VitalsFanOut*              FanOut = nullptr;
+};
+
+VitalsBroadcaster::VitalsBroadcaster(const std::vector<VitalsChannel>& channels, size_t max_queued_frames)
+{
+  m_Data = new VitalsBroadcaster::Data();
+  m_Data->Channels = channels;
+  m_Data->MaxQueued = max_queued_frames < 1 ? 1 : max_queued_frames;
+}
+
+VitalsBroadcaster::~VitalsBroadcaster()
+{
+  Stop();
+  delete m_Data;
+}
+
+bool VitalsBroadcaster::IsRunning() const
+{
+  m_Data->Mutex.lock();
+  bool running = m_Data->FanOut != nullptr;
+  m_Data->Mutex.unlock();
+  return running;
+}
+
+int VitalsBroadcaster::GetPort() const
+{
+  m_Data->Mutex.lock();
+  int port = m_Data->FanOut == nullptr ? 0 : m_Data->FanOut->GetPort();
+  m_Data->Mutex.unlock();
+  return port;
+}
+
+int VitalsBroadcaster::GetNumberOfClients() const
+{
+  m_Data->Mutex.lock();
+  int clients = m_Data->FanOut == nullptr ? 0 : m_Data->FanOut->GetNumberOfClients();
+  m_Data->Mutex.unlock();
+  return clients;
+}
+
+bool VitalsBroadcaster::Start(int port, bool any_interface)
+{
+  if (m_Data->Thread != nullptr)
+    return true;
+  m_Data->Thread = new QThread();
+  VitalsFanOut* fanOut = new VitalsFanOut(m_Data->Channels, m_Data->MaxQueued);
+  fanOut->moveToThread(m_Data->Thread);
+  connect(fanOut, SIGNAL(ClientsChanged(int)), this, SIGNAL(ClientsChanged(int)));
+  m_Data->Thread->start();
+
+  bool ok = false;
+  QMetaObject::invokeMethod(fanOut, "Listen", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, ok), Q_ARG(int, port), Q_ARG(bool, any_interface));
+  m_Data->Mutex.lock();
+  m_Data->FanOut = fanOut;
+  m_Data->Mutex.unlock();
+  if (!ok)
+    Stop();
+  return ok;
+}
+
+void VitalsBroadcaster::Stop()
+{
+  if (m_Data->Thread == nullptr)
+    return;
+  m_Data->Mutex.lock();
+  VitalsFanOut* fanOut = m_Data->FanOut;
+  m_Data->FanOut = nullptr;
+  m_Data->Mutex.unlock();
+  QMetaObject::invokeMethod(fanOut, "Close", Qt::BlockingQueuedConnection);
+  m_Data->Thread->quit();
+  m_Data->Thread->wait();
+  delete fanOut;
+  delete m_Data->Thread;
+  m_Data->Thread = nullptr;
+}
+
+void VitalsBroadcaster::Publish(double time_s, const double* values)
+{
+  m_Data->Mutex.lock();
+  if (m_Data->FanOut != nullptr)
+    m_Data->FanOut->Push(time_s, values);
+  m_Data->Mutex.unlock();
+}
+
+VitalsFanOut::VitalsFanOut(const std::vector<VitalsChannel>& channels, size_t max_queued_frames) :
+  m_Encoder(channels), m_MaxQueued(max_queued_frames)
+{
+  m_Port = 0;
+  m_NumClients = 0;
+}
+
+VitalsFanOut::~VitalsFanOut()
+{
+  Close();
+}
+
+bool VitalsFanOut::Listen(int port, bool any_interface)
+{
+  m_Server = new QTcpServer(this);
+  connect(m_Server, SIGNAL(newConnection()), this, SLOT(NewConnection()));
+  if (!m_Server->listen(any_interface ? QHostAddress::Any : QHostAddress::LocalHost, quint16(port)))
+  {
+    delete m_Server;
+    m_Server = nullptr;
+    return false;
+  }
+  m_Port = m_Server->serverPort();
+  return true;
+}
+
+void VitalsFanOut::Close()
+{
+  for (Client* c : m_Clients)
+  {
+    c->Socket->disconnect(this);
+    c->Socket->abort();
+    delete c->Socket;
+    delete c;
+  }
+  m_Clients.clear();
+  m_NumClients = 0;
+  delete m_Server;
+  m_Server = nullptr;
+  m_Port = 0;
+}
+
+void VitalsFanOut::Push(double time_s, const double* values)
+{
+  if (m_NumClients == 0)
+    return;// Nobody to encode for, new clients start from a key frame anyway
+  size_t stride = m_Encoder.GetChannels().size() + 1;
+  m_Mutex.lock();
+  if (m_Pending.size() >= MaxPendingSamples * stride)
+    m_Pending.erase(m_Pending.begin(), m_Pending.begin() + stride);
+  m_Pending.push_back(time_s);
+  m_Pending.insert(m_Pending.end(), values, values + stride - 1);
+  bool schedule = !m_FlushScheduled;
+  m_FlushScheduled = true;
+  m_Mutex.unlock();
+  if (schedule)
+    QMetaObject::invokeMethod(this, "Flush", Qt::QueuedConnection);
+}
+
+void VitalsFanOut::Flush()
+{
+  std::vector<double> samples;
+  m_Mutex.lock();
+  samples.swap(m_Pending);
+  m_FlushScheduled = false;
+  m_Mutex.unlock();
+
+  size_t stride = m_Encoder.GetChannels().size() + 1;
+  for (size_t s = 0; s + stride <= samples.size(); s += stride)
+  {
+    // Encode once, every client gets the same bytes
+    m_Encoder.Next(samples[s], &samples[s + 1]);
+    QByteArray delta = m_Encoder.Delta();
+    QByteArray key;
+    for (Client* c : m_Clients)
+    {
+      if (c->NeedsKey || c->Queue.size() >= m_MaxQueued)
+      {// Anything still queued is stale, start them over from this frame
+        if (key.isEmpty())
+          key = m_Encoder.Key();
+        c->Queue.clear();
+        c->Queue.push_back(key);
+        c->NeedsKey = false;
+      }
+      else
+        c->Queue.push_back(delta);
+    }
+  }
+  for (Client* c : m_Clients)
+    Send(*c);
+}
+
+void VitalsFanOut::Send(Client& c)
+{
+  while (!c.Queue.empty() && c.Socket->bytesToWrite() < MaxSocketBacklog)
+  {
+    c.Socket->write(c.Queue.front());
+    c.Queue.pop_front();
+  }
+}
+
+void VitalsFanOut::NewConnection()
+{
+  while (m_Server->hasPendingConnections())
+  {
+    Client* c = new Client();
+    c->Socket = m_Server->nextPendingConnection();
+    c->Socket->setParent(nullptr);
+    c->Socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(c->Socket, SIGNAL(bytesWritten(qint64)), this, SLOT(ClientWritten()));
+    connect(c->Socket, SIGNAL(disconnected()), this, SLOT(ClientDisconnected()));
+    c->Socket->write(m_Encoder.Schema());
+    m_Clients.push_back(c);
+  }
+  m_NumClients = int(m_Clients.size());
+  emit ClientsChanged(m_NumClients);
+}
+
+void VitalsFanOut::ClientWritten()
+{
+  QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+  for (Client* c : m_Clients)
+  {
+    if (c->Socket == socket)
+      Send(*c);
+  }
+}
+
+void VitalsFanOut::ClientDisconnected()
+{
+  QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+  auto itr = std::find_if(m_Clients.begin(), m_Clients.end(), [socket](Client* c) { return c->Socket == socket; });
+  if (itr == m_Clients.end())
+    return;
+  (*itr)->Socket->deleteLater();
+  delete *itr;
+  m_Clients.erase(itr);
+  m_NumClients = int(m_Clients.size());
+  emit ClientsChanged(m_NumClients);
+}
@@ -0,0 +1,89 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QObject>
+#include <QMutex>
+#include <atomic>
+#include <deque>
+#include "VitalsStream.h"
+
+class QThread;
+class QTcpServer;
+class QTcpSocket;
+class VitalsFanOut;
+
+// Publishes vitals samples to any number of viewers over TCP, see VitalsStream.h for the wire format.
+// The publishing thread only queues the sample, a separate fan-out thread encodes each sample once
+// and hands the frames to every client. Each client has a bounded queue, a client that falls behind
+// has its queued (stale) frames dropped and is sent a key frame next, nothing ever waits on a slow client.
+class VitalsBroadcaster : public QObject
+{
+  Q_OBJECT
+public:
+  VitalsBroadcaster(const std::vector<VitalsChannel>& channels, size_t max_queued_frames=64);
+  virtual ~VitalsBroadcaster();
+
+  // 0 picks a free port, only this machine can connect unless any_interface (patient data goes out unencrypted)
+  bool Start(int port, bool any_interface=false);
+  void Stop();
+  bool IsRunning() const;
+  int GetPort() const;
+  int GetNumberOfClients() const;
+
+  // Safe from any thread, values must hold a value for every channel
+  void Publish(double time_s, const double* values);
+
+signals:
+  void ClientsChanged(int count);
+
+private:
+  class Data;
+  Data* m_Data;
+};
+
+// Lives on the fan-out thread, owns the server and all client sockets
+class VitalsFanOut : public QObject
+{
+  Q_OBJECT
+public:
+  VitalsFanOut(const std::vector<VitalsChannel>& channels, size_t max_queued_frames);
+  virtual ~VitalsFanOut();
+
+  void Push(double time_s, const double* values);// Any thread
+  int GetPort() const { return m_Port; }
+  int GetNumberOfClients() const { return m_NumClients; }
+
+signals:
+  void ClientsChanged(int count);
+
+public slots:
+  bool Listen(int port, bool any_interface);
+  void Close();
+  void Flush();
+
+protected slots:
+  void NewConnection();
+  void ClientWritten();
+  void ClientDisconnected();
+
+private:
+  struct Client
+  {
+    QTcpSocket*            Socket;
+    std::deque<QByteArray> Queue;
+    bool                   NeedsKey = true;
+  };
+  void Send(Client& c);
+
+  VitalsEncoder        m_Encoder;
+  size_t               m_MaxQueued;
+  QTcpServer*          m_Server = nullptr;
+  std::vector<Client*> m_Clients;
+  std::atomic<int>     m_Port;
+  std::atomic<int>     m_NumClients;
+
+  QMutex               m_Mutex;// Guards the pending samples
+  std::vector<double>  m_Pending;// time, then the values, per sample
+  bool                 m_FlushScheduled = false;
+};
@@ -2,12 +2,17 @@
 #include "ui_VitalsMonitor.h"
 #include <QMutex>
 #include <QLayout>
-#include <QGraphicsLayout>
+#include <QShowEvent>
 
 #include "QPulsePlot.h"
+#include "StripChartWidget.h"
+#include "AlarmRules.h"
+#include "DataRequestsWidget.h"
 
 #include "cdm/CommonDataModel.h"
 #include "PulsePhysiologyEngine.h"
+#include "cdm/engine/SEEngineTracker.h"
+#include "cdm/scenario/SEDataRequestManager.h"
 #include "cdm/utils/FileUtils.h"
 #include "cdm/substance/SESubstanceManager.h"
 #include "cdm/compartment/SECompartmentManager.h"
@@ -27,8 +32,8 @@
 class VitalsMonitorWidget::Controls : public Ui::VitalsMonitorWidget
 {
 public:
-  Controls(QTextEdit& log) : LogBox(log) {}
-  QTextEdit&  LogBox;
+  Controls(LogWidget& log) : LogBox(log) {}
+  LogWidget&  LogBox;
   double      HeartRate_bpm;
   double      ECG_III_mV;
   double      ArterialPressure_mmHg;
@@ -44,55 +49,124 @@ public:
   QPulsePlot* ArterialPressure_Plot;
   QPulsePlot* etCO2_Plot;
   SEGasSubstanceQuantity* CarinaCO2=nullptr;
+  bool        ChartsBuilt = false;
+  size_t      ChartDecimation = 1;// Append every this many samples to the charts
+  size_t      ChartSkipped = 0;
+  bool        Dirty = false;// New samples since the monitor was last drawn
+
+  AlarmRules  Alarms;
+  bool        AlarmsCompiled = false;
+  std::vector<double>         AlarmValues;// Vitals, then data requests
+  std::vector<SEDataRequest*> AlarmRequests;
+  std::vector<AlarmEvent>     AlarmEvents;
+
+  // Rules can watch any vital on the monitor, or any tracked data request by its graph title
+  void CompileAlarms(PhysiologyEngine& pulse)
+  {
+    std::vector<std::string> signals;
+    signals.push_back("HeartRate(1/min)");
+    signals.push_back("Lead3ElectricPotential(mV)");
+    signals.push_back("ArterialPressure(mmHg)");
+    signals.push_back("MeanArterialPressure(mmHg)");
+    signals.push_back("DiastolicArterialPressure(mmHg)");
+    signals.push_back("SystolicArterialPressure(mmHg)");
+    signals.push_back("OxygenSaturation");
+    signals.push_back("EndTidalCarbonDioxidePressure(mmHg)");
+    signals.push_back("RespirationRate(1/min)");
+    signals.push_back("CoreTemperature(degC)");
+    signals.push_back("CarinaCarbonDioxidePartialPressure(mmHg)");
+    AlarmRequests.clear();
+    for (SEDataRequest* dr : pulse.GetEngineTracker()->GetDataRequestManager().GetDataRequests())
+    {
+      if (!pulse.GetEngineTracker()->TrackRequest(*dr))
+        continue;
+      AlarmRequests.push_back(dr);
+      signals.push_back(::DataRequestsWidget::GetTitle(*dr));
+    }
+    AlarmValues.resize(signals.size());
+    Alarms.Compile(signals);
+    AlarmsCompiled = true;
+  }
+
+  void EvaluateAlarms(PhysiologyEngine& pulse, double time_s)
+  {
+    if (!AlarmsCompiled)
+    {// Recompiling drops the alarm state, let everyone know what went away
+      for (size_t r = 0; r < Alarms.GetNumberOfRules(); r++)
+      {
+        if (Alarms.IsActive(r))
+          AlarmEvents.push_back({ r, time_s, false });
+      }
+      CompileAlarms(pulse);
+    }
+    double* v = AlarmValues.data();
+    v[0] = HeartRate_bpm;
+    v[1] = ECG_III_mV;
+    v[2] = ArterialPressure_mmHg;
+    v[3] = MeanArterialPressure_mmHg;
+    v[4] = DiastolicPressure_mmHg;
+    v[5] = SystolicPressure_mmHg;
+    v[6] = OxygenSaturation;
+    v[7] = EndTidalCarbonDioxidePressure_mmHg;
+    v[8] = RespirationRate_bpm;
+    v[9] = Temperature_C;
+    v[10] = CarinaCO2->GetPartialPressure(PressureUnit::mmHg);
+    // The Data Requests widget pulls the tracker after us, so these can be a step behind
+    size_t i = 11;
+    for (SEDataRequest* dr : AlarmRequests)
+    {
+      if (dr->HasUnit())
+        v[i++] = pulse.GetEngineTracker()->GetScalar(*dr)->GetValue(*dr->GetUnit());
+      else
+        v[i++] = pulse.GetEngineTracker()->GetScalar(*dr)->GetValue();
+    }
+    Alarms.Evaluate(time_s, v);
+    Alarms.PopEvents(AlarmEvents);
+  }
 };
 
-VitalsMonitorWidget::VitalsMonitorWidget(QTextEdit& log, QWidget *parent, Qt::WindowFlags flags) : QDockWidget(parent,flags)
+VitalsMonitorWidget::VitalsMonitorWidget(LogWidget& log, QWidget *parent, Qt::WindowFlags flags) : QDockWidget(parent,flags)
 {
   m_Controls = new Controls(log);
   m_Controls->setupUi(this);
 
+  // The charts are made the first time the monitor is shown
   m_Controls->ECG_III_Plot = new QPulsePlot(500);
-  m_Controls->ECG_III_Plot->GetSeries().setColor(Qt::green);
-  m_Controls->ECG_III_Plot->GetChart().layout()->setContentsMargins(0, 0, 0, 0); 
-  m_Controls->ECG_III_Plot->GetChart().setBackgroundRoundness(0);
-  m_Controls->ECG_III_Plot->GetChart().setBackgroundBrush(QBrush(Qt::black));
-  m_Controls->ECG_III_Plot->GetChart().axisX()->setLinePenColor(Qt::black);
-  m_Controls->ECG_III_Plot->GetChart().axisY()->setLinePenColor(Qt::black);
-  m_Controls->ECG_III_Plot->GetChart().axisX()->setLabelsVisible(false);
-  m_Controls->ECG_III_Plot->GetChart().axisY()->setLabelsVisible(false);
-  m_Controls->ECG_III_Plot->GetChart().axisX()->setGridLineVisible(false);
-  m_Controls->ECG_III_Plot->GetChart().axisY()->setGridLineVisible(false);
   m_Controls->ECG_III_Plot->SetDataRange(-0.1, 0.9);
-
   m_Controls->ArterialPressure_Plot = new QPulsePlot(500);
-  m_Controls->ArterialPressure_Plot->GetSeries().setColor(Qt::red);
-  m_Controls->ArterialPressure_Plot->GetChart().layout()->setContentsMargins(0, 0, 0, 0);
-  m_Controls->ArterialPressure_Plot->GetChart().setBackgroundRoundness(0);
-  m_Controls->ArterialPressure_Plot->GetChart().setBackgroundBrush(QBrush(Qt::black));
-  m_Controls->ArterialPressure_Plot->GetChart().axisX()->setLinePenColor(Qt::black);
-  m_Controls->ArterialPressure_Plot->GetChart().axisY()->setLinePenColor(Qt::black);
-  m_Controls->ArterialPressure_Plot->GetChart().axisX()->setLabelsVisible(false);
-  m_Controls->ArterialPressure_Plot->GetChart().axisY()->setLabelsVisible(false);
-  m_Controls->ArterialPressure_Plot->GetChart().axisX()->setGridLineVisible(false);
-  m_Controls->ArterialPressure_Plot->GetChart().axisY()->setGridLineVisible(false);
   m_Controls->ArterialPressure_Plot->SetDataRange(70, 115);
-
   m_Controls->etCO2_Plot = new QPulsePlot(500);
-  m_Controls->etCO2_Plot->GetSeries().setColor(Qt::yellow);
-  m_Controls->etCO2_Plot->GetChart().layout()->setContentsMargins(0, 0, 0, 0);
-  m_Controls->etCO2_Plot->GetChart().setBackgroundRoundness(0);
-  m_Controls->etCO2_Plot->GetChart().setBackgroundBrush(QBrush(Qt::black));
-  m_Controls->etCO2_Plot->GetChart().axisX()->setLinePenColor(Qt::black);
-  m_Controls->etCO2_Plot->GetChart().axisY()->setLinePenColor(Qt::black);
-  m_Controls->etCO2_Plot->GetChart().axisX()->setLabelsVisible(false);
-  m_Controls->etCO2_Plot->GetChart().axisY()->setLabelsVisible(false);
-  m_Controls->etCO2_Plot->GetChart().axisX()->setGridLineVisible(false);
-  m_Controls->etCO2_Plot->GetChart().axisY()->setGridLineVisible(false);
   m_Controls->etCO2_Plot->SetDataRange(0.2, 30);
 
-  m_Controls->ECGGraphWidget->layout()->addWidget(&m_Controls->ECG_III_Plot->GetView());
-  m_Controls->ABPGraphWidget->layout()->addWidget(&m_Controls->ArterialPressure_Plot->GetView());
-  m_Controls->etCO2GraphWidget->layout()->addWidget(&m_Controls->etCO2_Plot->GetView());
+  std::vector<std::string> errors;
+  size_t rules = m_Controls->Alarms.LoadFile("data/alarms.txt", &errors);
+  for (const std::string& error : errors)
+    m_Controls->LogBox.Append(QString("Alarm rule ignored : ") + error.c_str(), LogSeverity::Warning);
+  if (rules == 0)
+    m_Controls->Alarms.LoadDefaults();
+  m_Controls->AlarmBanner->setText("");
+}
+
+static void BuildMonitorChart(QPulsePlot& plot, const QColor& color, QWidget& parent)
+{
+  plot.GetView().SetTraceColor(color);
+  plot.GetView().SetBackgroundColor(Qt::black);
+  plot.GetView().SetAxesVisible(false);
+  parent.layout()->addWidget(&plot.GetView());
+}
+
+void VitalsMonitorWidget::showEvent(QShowEvent* event)
+{
+  if (!m_Controls->ChartsBuilt)
+  {
+    m_Controls->Mutex.lock();
+    BuildMonitorChart(*m_Controls->ECG_III_Plot, Qt::green, *m_Controls->ECGGraphWidget);
+    BuildMonitorChart(*m_Controls->ArterialPressure_Plot, Qt::red, *m_Controls->ABPGraphWidget);
+    BuildMonitorChart(*m_Controls->etCO2_Plot, Qt::yellow, *m_Controls->etCO2GraphWidget);
+    m_Controls->ChartsBuilt = true;
+    m_Controls->Mutex.unlock();
+  }
+  QDockWidget::showEvent(event);
 }
 
 VitalsMonitorWidget::~VitalsMonitorWidget()
@@ -115,11 +189,23 @@ void VitalsMonitorWidget::Reset()
   m_Controls->etCO2_Plot->Reset();
 
   m_Controls->CarinaCO2 = nullptr;
+
+  m_Controls->Mutex.lock();
+  m_Controls->AlarmsCompiled = false;
+  m_Controls->Alarms.Reset();
+  m_Controls->AlarmEvents.clear();
+  m_Controls->AlarmBanner->setText("");
+  m_Controls->Mutex.unlock();
 }
 
 void VitalsMonitorWidget::ProcessPhysiology(PhysiologyEngine& pulse)
 {
-  // This is where we pull data from pulse, and push any actions to it
+  // Everything we show is taken every step in PulseStepped
+}
+
+void VitalsMonitorWidget::PulseStepped(PhysiologyEngine& pulse)
+{
+  // The waveforms and alarms want every step
   m_Controls->Mutex.lock();
 
   m_Controls->HeartRate_bpm = pulse.GetCardiovascularSystem()->GetHeartRate(FrequencyUnit::Per_min);
@@ -139,28 +225,107 @@ void VitalsMonitorWidget::ProcessPhysiology(PhysiologyEngine& pulse)
     m_Controls->CarinaCO2 = pulse.GetCompartments().GetGasCompartment(pulse::PulmonaryCompartment::Carina)->GetSubstanceQuantity(*CO2);
   }
   double time_s = pulse.GetSimulationTime(TimeUnit::s);
-  m_Controls->ECG_III_Plot->Append(time_s, m_Controls->ECG_III_mV);
-  m_Controls->ArterialPressure_Plot->Append(time_s, m_Controls->ArterialPressure_mmHg);
-  m_Controls->etCO2_Plot->Append(time_s, m_Controls->CarinaCO2->GetPartialPressure(PressureUnit::mmHg));
+  if (++m_Controls->ChartSkipped >= m_Controls->ChartDecimation)
+  {
+    m_Controls->ChartSkipped = 0;
+    m_Controls->ECG_III_Plot->Append(time_s, m_Controls->ECG_III_mV);
+    m_Controls->ArterialPressure_Plot->Append(time_s, m_Controls->ArterialPressure_mmHg);
+    m_Controls->etCO2_Plot->Append(time_s, m_Controls->CarinaCO2->GetPartialPressure(PressureUnit::mmHg));
+  }
+  m_Controls->Dirty = true;
+  // Alarms see every sample, no matter how far behind we are
+  m_Controls->EvaluateAlarms(pulse, time_s);
 
   m_Controls->Mutex.unlock();
 }
 
+void VitalsMonitorWidget::PulseStateLoaded(PhysiologyEngine& pulse)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->CarinaCO2 = nullptr;
+  m_Controls->AlarmsCompiled = false;
+  m_Controls->ECG_III_Plot->Clear();
+  m_Controls->ArterialPressure_Plot->Clear();
+  m_Controls->etCO2_Plot->Clear();
+  m_Controls->Mutex.unlock();
+}
+
+void VitalsMonitorWidget::PulseOverloadChanged(OverloadLevel level)
+{
+  m_Controls->Mutex.lock();
+  m_Controls->ChartDecimation = level >= OverloadLevel::DecimatedCharts ? 3 : 1;
+  m_Controls->Mutex.unlock();
+}
+
 void VitalsMonitorWidget::PulseUpdateUI()
 {
   // This is where we take the pulse data we pulled and push it to a UI widget
+  // Alarms always go to the log, even if the monitor is not up
+  m_Controls->Mutex.lock();
+  if (!m_Controls->AlarmEvents.empty())
+  {
+    for (const AlarmEvent& e : m_Controls->AlarmEvents)
+    {
+      QString name = m_Controls->Alarms.GetRuleName(e.Rule).c_str();
+      if (e.Raised)
+        m_Controls->LogBox.Append("Alarm : " + name + " at " + QString::number(e.Time_s, 'f', 1) + "s", LogSeverity::Warning);
+      else
+        m_Controls->LogBox.Append("Alarm cleared : " + name + " at " + QString::number(e.Time_s, 'f', 1) + "s");
+    }
+    m_Controls->AlarmEvents.clear();
+    QString banner;
+    for (size_t r = 0; r < m_Controls->Alarms.GetNumberOfRules(); r++)
+    {
+      if (m_Controls->Alarms.IsActive(r))
+        banner += QString(banner.isEmpty() ? "" : "  ") + m_Controls->Alarms.GetRuleName(r).c_str();
+    }
+    m_Controls->AlarmBanner->setText(banner);
+  }
+  m_Controls->Mutex.unlock();
+}
 
-    m_Controls->Mutex.lock();
-    m_Controls->HeartRateValue->setText(QString::number(int(m_Controls->HeartRate_bpm),'d',0));
-    m_Controls->BloodPressureValues->setText(QString::number(int(m_Controls->SystolicPressure_mmHg), 'd', 0)+"/"+QString::number(int(m_Controls->DiastolicPressure_mmHg), 'd', 0));
-    m_Controls->MeanBloodPressureValue->setText("("+QString::number(int(m_Controls->MeanArterialPressure_mmHg), 'd', 0)+")");
-    m_Controls->SpO2Value->setText(QString::number(int(m_Controls->OxygenSaturation*100), 'd', 0));
-    m_Controls->etCO2Value->setText(QString::number(int(m_Controls->EndTidalCarbonDioxidePressure_mmHg), 'd', 0));
-    m_Controls->RespiratoryRateValue->setText(QString::number(int(m_Controls->RespirationRate_bpm), 'd', 0));
-    m_Controls->TempeartureValue->setText(QString::number(m_Controls->Temperature_C, 'd', 1));
-    
-    m_Controls->ECG_III_Plot->UpdateUI(false); 
-    m_Controls->ArterialPressure_Plot->UpdateUI(false);
-    m_Controls->etCO2_Plot->UpdateUI(false);
-    m_Controls->Mutex.unlock();
+size_t VitalsMonitorWidget::GetSampleMemoryUsed() const
+{
+  m_Controls->Mutex.lock();
+  size_t bytes = m_Controls->ECG_III_Plot->GetMemoryUsed() + m_Controls->ArterialPressure_Plot->GetMemoryUsed() + m_Controls->etCO2_Plot->GetMemoryUsed();
+  m_Controls->Mutex.unlock();
+  return bytes;
+}
+
+size_t VitalsMonitorWidget::GetChartMemoryUsed() const
+{
+  size_t bytes = 0;
+  for (QPulsePlot* plot : { m_Controls->ECG_III_Plot, m_Controls->ArterialPressure_Plot, m_Controls->etCO2_Plot })
+    if (plot->HasView())
+      bytes += plot->GetView().GetMemoryUsed();
+  return bytes;
+}
+
+bool VitalsMonitorWidget::NeedsRender() const
+{
+  // Nothing to do while we are not on screen
+  if (!m_Controls->ChartsBuilt || !isVisible())
+    return false;
+  m_Controls->Mutex.lock();
+  bool dirty = m_Controls->Dirty;
+  m_Controls->Mutex.unlock();
+  return dirty;
+}
+
+void VitalsMonitorWidget::Render()
+{
+  m_Controls->Mutex.lock();
+  m_Controls->Dirty = false;
+  m_Controls->HeartRateValue->setText(QString::number(int(m_Controls->HeartRate_bpm),'d',0));
+  m_Controls->BloodPressureValues->setText(QString::number(int(m_Controls->SystolicPressure_mmHg), 'd', 0)+"/"+QString::number(int(m_Controls->DiastolicPressure_mmHg), 'd', 0));
+  m_Controls->MeanBloodPressureValue->setText("("+QString::number(int(m_Controls->MeanArterialPressure_mmHg), 'd', 0)+")");
+  m_Controls->SpO2Value->setText(QString::number(int(m_Controls->OxygenSaturation*100), 'd', 0));
+  m_Controls->etCO2Value->setText(QString::number(int(m_Controls->EndTidalCarbonDioxidePressure_mmHg), 'd', 0));
+  m_Controls->RespiratoryRateValue->setText(QString::number(int(m_Controls->RespirationRate_bpm), 'd', 0));
+  m_Controls->TempeartureValue->setText(QString::number(m_Controls->Temperature_C, 'd', 1));
+  
+  m_Controls->ECG_III_Plot->UpdateUI(false); 
+  m_Controls->ArterialPressure_Plot->UpdateUI(false);
+  m_Controls->etCO2_Plot->UpdateUI(false);
+  m_Controls->Mutex.unlock();
 }
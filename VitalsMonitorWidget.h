@@ -14,17 +14,29 @@ class VitalsMonitorWidget : public QDockWidget, public PulseListener
 {
   Q_OBJECT
 public:
-  VitalsMonitorWidget(QTextEdit& log, QWidget *parent = Q_NULLPTR, Qt::WindowFlags flags = Qt::WindowFlags());
+  VitalsMonitorWidget(LogWidget& log, QWidget *parent = Q_NULLPTR, Qt::WindowFlags flags = Qt::WindowFlags());
   virtual ~VitalsMonitorWidget();
 
   void Reset();
   void ProcessPhysiology(PhysiologyEngine& pulse);
+  void PulseStepped(PhysiologyEngine& pulse);
+  void PulseStateLoaded(PhysiologyEngine& pulse);
+  void PulseOverloadChanged(OverloadLevel level);
 
   void PulseUpdateUI();
+  // For the render scheduler, new samples to show
+  bool NeedsRender() const;
+  void Render();
+  // For the memory panel, in bytes
+  size_t GetSampleMemoryUsed() const;
+  size_t GetChartMemoryUsed() const;
 
 //signals:
 //protected slots:
 
+protected:
+  void showEvent(QShowEvent* event);
+
 private:
   class Controls;
   Controls* m_Controls;
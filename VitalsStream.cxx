@@ -0,0 +1,219 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "VitalsStream.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+static void WriteVarint(QByteArray& out, int64_t v)
+{
+  uint64_t z = (uint64_t(v) << 1) ^ uint64_t(v >> 63);// zigzag, small negatives stay small
+  while (z >= 0x80)
+  {
+    out.append(char((z & 0x7F) | 0x80));
+    z >>= 7;
+  }
+  out.append(char(z));
+}
+
+static bool ReadVarint(const char*& c, const char* end, int64_t& v)
+{
+  uint64_t z = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    if (c >= end)
+      return false;
+    uint8_t b = uint8_t(*c++);
+    z |= uint64_t(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+    {
+      v = int64_t(z >> 1) ^ -int64_t(z & 1);
+      return true;
+    }
+  }
+  return false;
+}
+
+template<typename T> static void WriteRaw(QByteArray& out, T v)
+{
+  out.append((const char*)&v, sizeof(T));
+}
+
+template<typename T> static bool ReadRaw(const char*& c, const char* end, T& v)
+{
+  if (end - c < (std::ptrdiff_t)sizeof(T))
+    return false;
+  std::memcpy(&v, c, sizeof(T));
+  c += sizeof(T);
+  return true;
+}
+
+// Put the length in front of a message started with BeginMessage
+static QByteArray BeginMessage(VitalsMessage type)
+{
+  QByteArray msg;
+  WriteRaw<uint32_t>(msg, 0);
+  WriteRaw<uint8_t>(msg, uint8_t(type));
+  return msg;
+}
+static void EndMessage(QByteArray& msg)
+{
+  uint32_t length = uint32_t(msg.size() - sizeof(uint32_t));
+  std::memcpy(msg.data(), &length, sizeof(length));
+}
+
+VitalsEncoder::VitalsEncoder(const std::vector<VitalsChannel>& channels) : m_Channels(channels)
+{
+  m_Current.resize(channels.size(), 0);
+  m_Previous.resize(channels.size(), 0);
+}
+
+QByteArray VitalsEncoder::Schema() const
+{
+  QByteArray msg = BeginMessage(VitalsMessage::Schema);
+  WriteRaw<uint16_t>(msg, uint16_t(m_Channels.size()));
+  for (const VitalsChannel& c : m_Channels)
+  {
+    WriteRaw<double>(msg, c.Scale);
+    std::string name = c.Name.substr(0, 255);
+    WriteRaw<uint8_t>(msg, uint8_t(name.size()));
+    msg.append(name.c_str(), int(name.size()));
+  }
+  EndMessage(msg);
+  return msg;
+}
+
+void VitalsEncoder::Next(double time_s, const double* values)
+{
+  m_HasPrevious = m_Sequence > 0;
+  m_Previous.swap(m_Current);
+  m_PreviousTime_ms = m_CurrentTime_ms;
+  m_CurrentTime_ms = (int64_t)std::llround(time_s * 1000);
+  for (size_t i = 0; i < m_Channels.size(); i++)
+    m_Current[i] = std::isfinite(values[i]) ? (int64_t)std::llround(values[i] * m_Channels[i].Scale) : 0;
+  m_Sequence++;
+}
+
+QByteArray VitalsEncoder::Key() const
+{
+  QByteArray msg = BeginMessage(VitalsMessage::Key);
+  WriteRaw<uint32_t>(msg, m_Sequence);
+  WriteVarint(msg, m_CurrentTime_ms);
+  for (int64_t v : m_Current)
+    WriteVarint(msg, v);
+  EndMessage(msg);
+  return msg;
+}
+
+QByteArray VitalsEncoder::Delta() const
+{
+  if (!m_HasPrevious)
+    return Key();
+  QByteArray msg = BeginMessage(VitalsMessage::Delta);
+  WriteRaw<uint32_t>(msg, m_Sequence);
+  WriteVarint(msg, m_CurrentTime_ms - m_PreviousTime_ms);
+  for (size_t i = 0; i < m_Current.size(); i++)
+    WriteVarint(msg, m_Current[i] - m_Previous[i]);
+  EndMessage(msg);
+  return msg;
+}
+
+bool VitalsDecoder::Read(const char* data, size_t size)
+{
+  m_Buffer.append(data, size);
+  size_t pos = 0;
+  while (m_Buffer.size() - pos >= sizeof(uint32_t) + 1)
+  {
+    uint32_t length;
+    std::memcpy(&length, m_Buffer.data() + pos, sizeof(length));
+    if (length == 0 || length > 1024 * 1024)
+      return false;
+    if (m_Buffer.size() - pos - sizeof(uint32_t) < length)
+      break;// Wait for the rest of it
+    const char* body = m_Buffer.data() + pos + sizeof(uint32_t);
+    if (!Decode(VitalsMessage(uint8_t(body[0])), body + 1, body + length))
+      return false;
+    pos += sizeof(uint32_t) + length;
+  }
+  m_Buffer.erase(0, pos);
+  return true;
+}
+
+bool VitalsDecoder::Decode(VitalsMessage type, const char* c, const char* end)
+{
+  if (type == VitalsMessage::Schema)
+  {
+    uint16_t n;
+    if (!ReadRaw(c, end, n))
+      return false;
+    m_Channels.clear();
+    for (uint16_t i = 0; i < n; i++)
+    {
+      VitalsChannel channel;
+      uint8_t len;
+      if (!ReadRaw(c, end, channel.Scale) || !ReadRaw(c, end, len) || end - c < len || channel.Scale <= 0)
+        return false;
+      channel.Name.assign(c, len);
+      c += len;
+      m_Channels.push_back(channel);
+    }
+    m_Base.assign(n, 0);
+    m_HasBase = false;
+    return true;
+  }
+  if (type != VitalsMessage::Key && type != VitalsMessage::Delta)
+    return false;
+  if (!HasSchema())
+    return false;
+
+  uint32_t sequence;
+  int64_t time_ms;
+  if (!ReadRaw(c, end, sequence) || !ReadVarint(c, end, time_ms))
+    return false;
+  std::vector<int64_t> values(m_Channels.size());
+  for (int64_t& v : values)
+  {
+    if (!ReadVarint(c, end, v))
+      return false;
+  }
+  if (c != end)
+    return false;
+
+  if (type == VitalsMessage::Key)
+  {
+    if (m_HasBase && sequence != m_Sequence + 1)
+      m_NumGaps++;
+    if (m_NumKeys + m_NumDeltas + m_NumUnusable > 0 && sequence != m_Sequence + 1)
+      m_NumResyncs++;
+    m_Base = values;
+    m_BaseTime_ms = time_ms;
+    m_HasBase = true;
+    m_NumKeys++;
+  }
+  else
+  {
+    if (!m_HasBase || sequence != m_Sequence + 1)
+    {// We missed the frame this is relative to, wait for a key
+      m_HasBase = false;
+      m_NumUnusable++;
+      m_Sequence = sequence;
+      return true;
+    }
+    for (size_t i = 0; i < values.size(); i++)
+      m_Base[i] += values[i];
+    m_BaseTime_ms += time_ms;
+    m_NumDeltas++;
+  }
+  m_Sequence = sequence;
+
+  VitalsFrame frame;
+  frame.Sequence = sequence;
+  frame.Key = type == VitalsMessage::Key;
+  frame.Time_s = m_BaseTime_ms / 1000.;
+  frame.Values.resize(m_Base.size());
+  for (size_t i = 0; i < m_Base.size(); i++)
+    frame.Values[i] = m_Base[i] / m_Channels[i].Scale;
+  m_Frames.push_back(frame);
+  return true;
+}
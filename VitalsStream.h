@@ -0,0 +1,93 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <QByteArray>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Wire format of the vitals broadcast (little endian)
+// Every message is : uint32 length of what follows, uint8 message type, body
+//   Schema : uint16 number of channels, per channel : double scale, uint8 name length, name
+//   Key    : uint32 sequence, zigzag varint time (ms), per channel zigzag varint of the quantized value
+//   Delta  : uint32 sequence, zigzag varint change in time (ms), per channel zigzag varint change in quantized value
+// Values are quantized as round(value*scale), a delta is always against the frame with the previous sequence
+enum class VitalsMessage : uint8_t { Schema = 0, Key = 1, Delta = 2 };
+
+struct VitalsChannel
+{
+  std::string Name;
+  double      Scale;// Quantization steps per unit
+};
+
+struct VitalsFrame
+{
+  uint32_t            Sequence = 0;
+  bool                Key = false;
+  double              Time_s = 0;
+  std::vector<double> Values;
+};
+
+class VitalsEncoder
+{
+public:
+  VitalsEncoder(const std::vector<VitalsChannel>& channels);
+  virtual ~VitalsEncoder() {}
+
+  const std::vector<VitalsChannel>& GetChannels() const { return m_Channels; }
+  QByteArray Schema() const;
+
+  // Quantize the next sample, Key and Delta then encode it
+  void Next(double time_s, const double* values);
+  QByteArray Key() const;
+  QByteArray Delta() const;// A key if there is no previous sample
+  uint32_t GetSequence() const { return m_Sequence; }
+
+private:
+  std::vector<VitalsChannel> m_Channels;
+  std::vector<int64_t>       m_Current;
+  std::vector<int64_t>       m_Previous;
+  int64_t                    m_CurrentTime_ms = 0;
+  int64_t                    m_PreviousTime_ms = 0;
+  uint32_t                   m_Sequence = 0;
+  bool                       m_HasPrevious = false;
+};
+
+class VitalsDecoder
+{
+public:
+  VitalsDecoder() {}
+  virtual ~VitalsDecoder() {}
+
+  // Add bytes as they come off the socket and decode all complete messages
+  // Returns false if the stream is corrupt
+  bool Read(const char* data, size_t size);
+
+  bool HasSchema() const { return !m_Channels.empty(); }
+  const std::vector<VitalsChannel>& GetChannels() const { return m_Channels; }
+  // Frames decoded so far, take what you need and clear it
+  std::vector<VitalsFrame>& GetFrames() { return m_Frames; }
+
+  size_t GetNumberOfKeyFrames() const { return m_NumKeys; }
+  size_t GetNumberOfDeltaFrames() const { return m_NumDeltas; }
+  size_t GetNumberOfGaps() const { return m_NumGaps; }// Frames the server dropped for us, seen as jumps in the sequence
+  size_t GetNumberOfUnusableDeltas() const { return m_NumUnusable; }// Deltas without the frame before them
+  size_t GetNumberOfResyncs() const { return m_NumResyncs; }// Key frames that picked the stream back up after frames were dropped
+
+private:
+  bool Decode(VitalsMessage type, const char* body, const char* end);
+
+  std::string                m_Buffer;
+  std::vector<VitalsChannel> m_Channels;
+  std::vector<VitalsFrame>   m_Frames;
+  std::vector<int64_t>       m_Base;
+  int64_t                    m_BaseTime_ms = 0;
+  uint32_t                   m_Sequence = 0;
+  bool                       m_HasBase = false;
+  size_t                     m_NumKeys = 0;
+  size_t                     m_NumDeltas = 0;
+  size_t                     m_NumGaps = 0;
+  size_t                     m_NumUnusable = 0;
+  size_t                     m_NumResyncs = 0;
+};
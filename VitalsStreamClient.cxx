@@ -0,0 +1,210 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include <QCoreApplication>
+#include <QTcpSocket>
+#include <QTimer>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include "VitalsBroadcaster.h"
+
+// Headless viewer for the Explorer vitals broadcast
+//   VitalsStreamClient <host> <port> [seconds]
+//     Connects to a running Explorer and prints the vitals once a second
+//   VitalsStreamClient --loopback [clients] [seconds]
+//     Starts a broadcaster in this process, publishes synthetic vitals as fast as it can to
+//     a number of clients (and one that never reads) on loopback and checks everything decoded
+//     matches what was published, and that the stalled client had frames dropped and picked back up on a key frame
+
+static void PrintFrame(const VitalsDecoder& decoder, const VitalsFrame& frame)
+{
+  std::cout << "t=" << frame.Time_s << "s";
+  for (size_t i = 0; i < frame.Values.size(); i++)
+    std::cout << "  " << decoder.GetChannels()[i].Name << "=" << frame.Values[i];
+  std::cout << std::endl;
+}
+
+static void PrintStats(const std::string& name, const VitalsDecoder& decoder, qint64 bytes)
+{
+  size_t frames = decoder.GetNumberOfKeyFrames() + decoder.GetNumberOfDeltaFrames();
+  std::cout << name << " : " << frames << " frames (" << decoder.GetNumberOfKeyFrames() << " key), "
+            << decoder.GetNumberOfGaps() << " gaps, " << decoder.GetNumberOfUnusableDeltas() << " unusable deltas, "
+            << decoder.GetNumberOfResyncs() << " resyncs, "
+            << (frames > 0 ? double(bytes) / frames : 0) << " bytes/frame" << std::endl;
+}
+
+static int Watch(const QString& host, int port, int seconds)
+{
+  QTcpSocket socket;
+  VitalsDecoder decoder;
+  qint64 bytes = 0;
+  bool ok = true;
+  socket.connectToHost(host, quint16(port));
+  if (!socket.waitForConnected(5000))
+  {
+    std::cerr << "Unable to connect to " << host.toStdString() << ":" << port << std::endl;
+    return 1;
+  }
+  QObject::connect(&socket, &QTcpSocket::readyRead, [&]()
+  {
+    QByteArray data = socket.readAll();
+    bytes += data.size();
+    if (!decoder.Read(data.constData(), data.size()))
+    {
+      std::cerr << "Corrupt stream" << std::endl;
+      ok = false;
+      QCoreApplication::exit(1);
+    }
+  });
+  QObject::connect(&socket, &QTcpSocket::disconnected, []() { QCoreApplication::exit(0); });
+  QTimer print;
+  QObject::connect(&print, &QTimer::timeout, [&]()
+  {
+    std::vector<VitalsFrame>& frames = decoder.GetFrames();
+    if (!frames.empty())
+      PrintFrame(decoder, frames.back());
+    frames.clear();
+  });
+  print.start(1000);
+  if (seconds > 0)
+    QTimer::singleShot(seconds * 1000, []() { QCoreApplication::exit(0); });
+  QCoreApplication::exec();
+  PrintStats("Received", decoder, bytes);
+  return ok && decoder.HasSchema() ? 0 : 1;
+}
+
+static int Loopback(int numClients, int seconds)
+{
+  std::vector<VitalsChannel> channels = { { "HeartRate", 100 }, { "ECG", 10000 }, { "ArterialPressure", 100 }, { "SpO2", 10000 } };
+  VitalsBroadcaster broadcaster(channels);
+  if (!broadcaster.Start(0))
+  {
+    std::cerr << "Unable to start the broadcaster" << std::endl;
+    return 1;
+  }
+  int port = broadcaster.GetPort();
+  std::cout << "Broadcasting on port " << port << " to " << numClients << " clients and 1 stalled client" << std::endl;
+
+  struct Viewer
+  {
+    QTcpSocket    Socket;
+    VitalsDecoder Decoder;
+    qint64        Bytes = 0;
+    size_t        Mismatches = 0;
+    bool          Corrupt = false;
+    bool          Stalled = false;
+  };
+  std::vector<Viewer*> viewers;
+  std::map<long long, std::vector<double>> published;// Quantized, by time in ms
+  for (int i = 0; i <= numClients; i++)
+  {
+    Viewer* v = new Viewer();
+    if (i == numClients)
+    {// Never drains, the server has to drop frames for it
+      v->Stalled = true;
+      v->Socket.setReadBufferSize(1);
+    }
+    v->Socket.connectToHost("127.0.0.1", quint16(port));
+    if (!v->Socket.waitForConnected(5000))
+    {
+      std::cerr << "Client " << i << " unable to connect" << std::endl;
+      return 1;
+    }
+    QObject::connect(&v->Socket, &QTcpSocket::readyRead, [v, &published, &channels]()
+    {
+      if (v->Stalled)
+        return;
+      QByteArray data = v->Socket.readAll();
+      v->Bytes += data.size();
+      if (!v->Decoder.Read(data.constData(), data.size()))
+        v->Corrupt = true;
+      for (const VitalsFrame& f : v->Decoder.GetFrames())
+      {
+        auto itr = published.find(std::llround(f.Time_s * 1000));
+        if (itr == published.end())
+        {
+          v->Mismatches++;
+          continue;
+        }
+        for (size_t c = 0; c < channels.size(); c++)
+        {
+          if (std::fabs(f.Values[c] - itr->second[c]) > 0.5 / channels[c].Scale + 1e-9)
+          {
+            v->Mismatches++;
+            break;
+          }
+        }
+      }
+      v->Decoder.GetFrames().clear();
+    });
+    viewers.push_back(v);
+  }
+  // Let the server see everyone before we start
+  while (broadcaster.GetNumberOfClients() < numClients + 1)
+    QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+
+  long long step = 0;
+  QTimer publish;
+  QObject::connect(&publish, &QTimer::timeout, [&]()
+  {
+    for (int i = 0; i < 20; i++, step++)
+    {
+      double t = step * 0.02;
+      double values[4] = { 72 + 5 * std::sin(t / 10), 0.4 * std::sin(t * 7.5), 90 + 25 * std::sin(t * 7.5), 0.97 };
+      std::vector<double>& q = published[std::llround(t * 1000)];
+      for (size_t c = 0; c < channels.size(); c++)
+        q.push_back(std::llround(values[c] * channels[c].Scale) / channels[c].Scale);
+      broadcaster.Publish(t, values);
+    }
+  });
+  publish.start(1);
+  QTimer::singleShot(seconds * 1000, [&]()
+  {
+    publish.stop();
+    // Let the stalled client catch up
+    viewers.back()->Stalled = false;
+    viewers.back()->Socket.setReadBufferSize(0);
+    emit viewers.back()->Socket.readyRead();
+    QTimer::singleShot(1000, []() { QCoreApplication::exit(0); });
+  });
+  QCoreApplication::exec();
+  broadcaster.Stop();
+
+  bool ok = true;
+  std::cout << "Published " << step << " samples" << std::endl;
+  for (size_t i = 0; i < viewers.size(); i++)
+  {
+    Viewer* v = viewers[i];
+    std::string name = i + 1 == viewers.size() ? "Stalled client" : "Client " + std::to_string(i);
+    PrintStats(name, v->Decoder, v->Bytes);
+    size_t frames = v->Decoder.GetNumberOfKeyFrames() + v->Decoder.GetNumberOfDeltaFrames();
+    if (v->Corrupt || v->Mismatches > 0 || frames == 0)
+    {
+      std::cerr << name << " FAILED : " << (v->Corrupt ? "corrupt stream, " : "") << v->Mismatches << " mismatched frames" << std::endl;
+      ok = false;
+    }
+    // The server has to have dropped frames for the stalled client, and resent a key frame for it to carry on from
+    if (i + 1 == viewers.size() && v->Decoder.GetNumberOfResyncs() == 0)
+    {
+      std::cerr << name << " FAILED : no frames were dropped and resynced from a key frame" << std::endl;
+      ok = false;
+    }
+    delete v;
+  }
+  std::cout << (ok ? "Loopback test passed" : "Loopback test failed") << std::endl;
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+  if (argc >= 2 && std::string(argv[1]) == "--loopback")
+    return Loopback(argc >= 3 ? std::atoi(argv[2]) : 16, argc >= 4 ? std::atoi(argv[3]) : 5);
+  if (argc < 3)
+  {
+    std::cerr << "Usage : " << argv[0] << " <host> <port> [seconds]" << std::endl;
+    std::cerr << "        " << argv[0] << " --loopback [clients] [seconds]" << std::endl;
+    return 1;
+  }
+  return Watch(argv[1], std::atoi(argv[2]), argc >= 4 ? std::atoi(argv[3]) : 0);
+}
@@ -0,0 +1,198 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#include "WhatIfPredictor.h"
+#include "RealtimeThread.h"
+#include "MemoryAccounting.h"
+
+#include <QMutex>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <google/protobuf/message.h>
+
+#include "cdm/CommonDataModel.h"
+#include "PulsePhysiologyEngine.h"
+#include "cdm/engine/SEEngineTracker.h"
+#include "cdm/scenario/SEDataRequestManager.h"
+#include "cdm/properties/SEScalarTime.h"
+
+class WhatIfPredictor::Data
+{
+public:
+  mutable QMutex     Mutex;
+  std::thread        Coordinator;
+  std::atomic<bool>  Running;
+  std::atomic<bool>  Cancel;
+  std::atomic<bool>  Failed;
+  bool               HasResult = false;
+  PulsePrediction    Result;
+  std::unique_ptr<google::protobuf::Message> Prototype;
+
+  void Join()
+  {
+    if (Coordinator.joinable())
+      Coordinator.join();
+  }
+};
+
+static bool RunBranch(const std::string& state, const google::protobuf::Message& prototype,
+                      const std::function<void(PhysiologyEngine&)>* intervention,
+                      double horizon_s, double sample_period_s, const std::atomic<bool>& cancel,
+                      std::vector<double>& times, std::vector<std::vector<double>>& values, const std::string& log)
+{
+  try
+  {
+    std::unique_ptr<PhysiologyEngine> pulse = CreatePulseEngine(log);
+    pulse->GetLogger()->SetLogLevel(log4cpp::Priority::WARN);
+    std::unique_ptr<google::protobuf::Message> msg(prototype.New());
+    if (!msg->ParseFromString(state) || !pulse->LoadState(*msg))
+      return false;
+
+    // The state carries the data request manager, so the branch tracks the same signals as the live engine
+    SEEngineTracker* tracker = pulse->GetEngineTracker();
+    const std::vector<SEDataRequest*>& requests = tracker->GetDataRequestManager().GetDataRequests();
+    for (SEDataRequest* dr : requests)
+      tracker->TrackRequest(*dr);
+    values.resize(requests.size());
+
+    if (intervention != nullptr)
+      (*intervention)(*pulse);
+    double dt_s = pulse->GetTimeStep(TimeUnit::s);
+    double start_s = pulse->GetSimulationTime(TimeUnit::s);
+    double next_sample_s = start_s;
+    double time_s = start_s;
+    while (time_s - start_s < horizon_s && !cancel)
+    {
+      pulse->AdvanceModelTime(dt_s, TimeUnit::s);
+      time_s = pulse->GetSimulationTime(TimeUnit::s);
+      if (time_s < next_sample_s)
+        continue;
+      next_sample_s += sample_period_s;
+      tracker->PullData();
+      times.push_back(time_s);
+      size_t i = 0;
+      for (SEDataRequest* dr : requests)
+      {
+        if (dr->HasUnit())
+          values[i++].push_back(tracker->GetScalar(*dr)->GetValue(*dr->GetUnit()));
+        else
+          values[i++].push_back(tracker->GetScalar(*dr)->GetValue());
+      }
+    }
+  }
+  catch (CommonDataModelException ex)
+  {
+    return false;
+  }
+  catch (std::exception& ex)
+  {// i.e. protobuf errors, an exception out of this thread would terminate the Explorer
+    return false;
+  }
+  catch (...)
+  {
+    return false;
+  }
+  return !cancel;
+}
+
+WhatIfPredictor::WhatIfPredictor()
+{
+  m_Data = new WhatIfPredictor::Data();
+  m_Data->Running = false;
+  m_Data->Cancel = false;
+  m_Data->Failed = false;
+}
+
+WhatIfPredictor::~WhatIfPredictor()
+{
+  Cancel();
+  delete m_Data;
+}
+
+bool WhatIfPredictor::IsRunning() const
+{
+  return m_Data->Running;
+}
+
+void WhatIfPredictor::Cancel()
+{
+  m_Data->Cancel = true;
+  m_Data->Join();
+  m_Data->Mutex.lock();
+  m_Data->HasResult = false;
+  m_Data->Mutex.unlock();
+}
+
+bool WhatIfPredictor::HasFailed() const
+{
+  return m_Data->Failed;
+}
+
+bool WhatIfPredictor::GetPrediction(PulsePrediction& p) const
+{
+  m_Data->Mutex.lock();
+  bool has = m_Data->HasResult;
+  if (has)
+    p = m_Data->Result;
+  m_Data->Mutex.unlock();
+  return has;
+}
+
+bool WhatIfPredictor::Start(const std::string& name, const std::string& state, google::protobuf::Message* prototype,
+                            std::function<void(PhysiologyEngine&)> intervention, double horizon_s, double sample_period_s,
+                            std::function<void()> finished)
+{
+  if (m_Data->Running)
+  {
+    delete prototype;
+    return false;
+  }
+  m_Data->Join();
+  m_Data->Prototype.reset(prototype);
+  m_Data->Cancel = false;
+  m_Data->Failed = false;
+  m_Data->Running = true;
+  m_Data->Coordinator = std::thread([this, name, state, intervention, horizon_s, sample_period_s, finished]()
+  {
+    // Started by the engine thread, which may be running realtime on its own core, keep out of its way
+    RealtimeThread::MakeOrdinary();
+    MemoryAccounting::SetThreadHeap(MemoryAccounting::BackgroundEngineHeap);
+    Data& d = *m_Data;
+    PulsePrediction p;
+    p.Name = name;
+    std::vector<double> intervention_times;
+    // The intervention branch gets its own core, the baseline runs here
+    bool intervention_ok = false;
+    std::thread branch([&]()
+    {
+      MemoryAccounting::SetThreadHeap(MemoryAccounting::BackgroundEngineHeap);
+      intervention_ok = RunBranch(state, *d.Prototype, &intervention, horizon_s, sample_period_s, d.Cancel,
+                                  intervention_times, p.Intervention, "WhatIfIntervention.log");
+    });
+    bool baseline_ok = RunBranch(state, *d.Prototype, nullptr, horizon_s, sample_period_s, d.Cancel,
+                                 p.Times_s, p.Baseline, "WhatIfBaseline.log");
+    branch.join();
+
+    if (baseline_ok && intervention_ok)
+    {
+      // Both branches sample on the same clock, but trim to be safe
+      size_t n = std::min(p.Times_s.size(), intervention_times.size());
+      p.Times_s.resize(n);
+      for (std::vector<double>& v : p.Baseline)
+        v.resize(std::min(v.size(), n));
+      for (std::vector<double>& v : p.Intervention)
+        v.resize(std::min(v.size(), n));
+      d.Mutex.lock();
+      d.Result = p;
+      d.HasResult = true;
+      d.Mutex.unlock();
+    }
+    else if (!d.Cancel)
+      d.Failed = true;
+    d.Running = false;
+    if (!d.Cancel && finished)
+      finished();
+  });
+  return true;
+}
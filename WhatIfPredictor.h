@@ -0,0 +1,45 @@
+/* Distributed under the Apache License, Version 2.0.
+See accompanying NOTICE file for details.*/
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PhysiologyEngine;
+namespace google { namespace protobuf { class Message; } }
+
+// Predicted traces of every tracked data request, for both branches of a fork
+struct PulsePrediction
+{
+  std::string                      Name;// Of the intervention
+  std::vector<double>              Times_s;
+  std::vector<std::vector<double>> Baseline;    // [request][sample] without the intervention
+  std::vector<std::vector<double>> Intervention;// [request][sample] with the intervention
+};
+
+// Runs a copy of the live engine state forward in background engines, one branch with and one without an intervention.
+// The branches run as fast as they can on their own threads, so the live engine keeps its pace.
+class WhatIfPredictor
+{
+public:
+  WhatIfPredictor();
+  virtual ~WhatIfPredictor();
+
+  // The state is a serialized engine state, prototype is used to deserialize it (we take ownership)
+  // Returns false if a prediction is already running
+  // finished is called when the prediction is done, or has failed, unless it was cancelled
+  bool Start(const std::string& name, const std::string& state, google::protobuf::Message* prototype,
+             std::function<void(PhysiologyEngine&)> intervention, double horizon_s, double sample_period_s,
+             std::function<void()> finished);
+  bool IsRunning() const;
+  void Cancel();
+
+  bool GetPrediction(PulsePrediction& p) const;// false if there is no finished prediction
+  bool HasFailed() const;// The last prediction could not be run, i.e. a branch threw
+
+private:
+  class Data;
+  Data* m_Data;
+};